@@ -4,8 +4,8 @@
 
 namespace sdl { namespace db { namespace bpool {
 
-page_bpool_alloc_unix::page_bpool_alloc_unix(const size_t size)
-    : m_alloc(get_alloc_size(size), vm_commited::false_) // may throw
+page_bpool_alloc_unix::page_bpool_alloc_unix(const size_t size, vm_hugepage const h, vm_populate const pf)
+    : m_alloc(get_alloc_size(size), vm_commited::false_, h, pf) // may throw
 {
     SDL_ASSERT(size <= capacity());
     SDL_ASSERT(size && !(size % pool_limits::page_size));
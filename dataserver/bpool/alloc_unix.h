@@ -16,7 +16,7 @@ public:
     static constexpr size_t get_alloc_size(const size_t size) {
         return round_up_div(size, (size_t)block_size) * block_size;
     }
-    explicit page_bpool_alloc_unix(size_t);
+    explicit page_bpool_alloc_unix(size_t, vm_hugepage = vm_hugepage::none, vm_populate = vm_populate::false_);
     bool is_open() const {
         return true;
     }
@@ -38,6 +38,9 @@ public:
     size_t commited_size() const {
         return m_alloc.commited_size();
     }
+    size_t hugepage_size() const { // commited memory backed by huge pages
+        return m_alloc.hugepage_used_size();
+    }
     bool can_alloc(const size_t size) const {
         SDL_ASSERT(size && !(size % block_size));
         return size <= unused_size();
@@ -46,9 +49,15 @@ public:
         return m_alloc.alloc_block();
     }
     void release(block_list_t &); // release/decommit memory
-    template <class fun_type>
-    bool defragment(fun_type && fun)  {
-        return m_alloc.defragment(fun);
+    template <class fun_type, class break_type>
+    size_t defragment(fun_type && fun, break_type && is_break)  {
+        return m_alloc.defragment(fun, is_break);
+    }
+    size_t mixed_arena_count() const {
+        return m_alloc.count_mixed_arena_list();
+    }
+    size_t free_arena_count() const {
+        return m_alloc.count_free_arena_list();
     }
     block32 get_block_id(char const * block_adr) const { // block must be allocated
         return m_alloc.get_block_id(block_adr);
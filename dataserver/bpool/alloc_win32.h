@@ -48,9 +48,15 @@ public:
     block32 get_block_id(char const *) const; // block must be allocated
     char * get_block(block32) const; // block must be allocated
     void release(block_list_t &); // release/decommit memory
-    template <class fun_type>
-    static bool defragment(fun_type &&) {
-        return false;
+    template <class fun_type, class break_type>
+    static size_t defragment(fun_type &&, break_type &&) {
+        return 0;
+    }
+    static size_t mixed_arena_count() {
+        return 0;
+    }
+    static size_t free_arena_count() {
+        return 0;
     }
 #if SDL_DEBUG || defined(SDL_TRACE_RELEASE)
     void trace();
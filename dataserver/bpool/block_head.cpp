@@ -7,7 +7,12 @@ namespace {
     A_STATIC_ASSERT_IS_POD(block_index);
     A_STATIC_ASSERT_IS_POD(block_head);
     static_assert(sizeof(block_index) == sizeof(uint32), "");
+    static_assert(sizeof(atomic_block_index) == sizeof(block_index), "");
+    static_assert(block_index::lock_page_mask(0) == 0x01000000, "");
+    static_assert(block_index::lock_page_mask(7) == 0x80000000, "");
     static_assert(pool_limits::max_block * pool_limits::block_size == terabyte<1>::value, "");
+    static_assert(pool_limits::max_filesize == terabyte<32>::value, "");
+    static_assert(pool_limits::max_file_block == 536870912, "");
     static_assert(sizeof(block_head) == page_head::reserved_size, "");
     static_assert(sizeof(block_head) == 32, "");
     static_assert(gigabyte<5>::value / pool_limits::block_size == 81920, "");
@@ -40,6 +45,45 @@ namespace {
     static_assert(gigabyte<5>::value / pool_limits::block_size / 8 / 8 == 1280, "");      // 1 bit per 8 blocks
 } // namespace
 
+block_index_map::block_index_map(size_t const block_count)
+    : m_size(block_count)
+    , m_segment((block_count + segment_size - 1) / segment_size)
+{
+    SDL_ASSERT(m_size <= pool_limits::max_file_block);
+}
+
+block_index_map::~block_index_map()
+{
+    for (auto & s : m_segment) {
+        delete[] s.load();
+    }
+}
+
+block_index_map::segment_ptr
+block_index_map::alloc_segment(size_t const i)
+{
+    SDL_ASSERT(i < m_segment.size());
+    const size_t count = a_min(size_t(segment_size), m_size - i * segment_size);
+    std::unique_ptr<atomic_block_index[]> p(new atomic_block_index[count]);
+    segment_ptr expected = nullptr;
+    if (m_segment[i].compare_exchange_strong(expected, p.get())) {
+        return p.release();
+    }
+    SDL_ASSERT(expected);
+    return expected; // allocated by other thread
+}
+
+size_t block_index_map::segment_count() const
+{
+    size_t count = 0;
+    for (auto const & s : m_segment) {
+        if (s.load()) {
+            ++count;
+        }
+    }
+    return count;
+}
+
 #if SDL_DEBUG
 namespace {
 struct uint24_8 { // 4 bytes
@@ -72,6 +116,16 @@ public:
             }
             SDL_ASSERT(T::last_block == test.value);
         }
+        {
+            block_index_map test(pool_limits::max_file_block);
+            SDL_ASSERT(!test.segment_count());
+            block_index_map const & ctest = test;
+            SDL_ASSERT(!ctest[pool_limits::max_file_block - 1].blockId());
+            SDL_ASSERT(!test.segment_count());
+            test[pool_limits::max_file_block - 1].set_blockId(1);
+            SDL_ASSERT(ctest[pool_limits::max_file_block - 1].blockId() == 1);
+            SDL_ASSERT(test.segment_count() == 1);
+        }
         SDL_TRACE_FUNCTION;
     }
 };
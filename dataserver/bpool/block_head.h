@@ -7,24 +7,22 @@
 #include "dataserver/system/page_head.h"
 #include "dataserver/common/array_enum.h"
 #include "dataserver/spatial/interval_set.h"
+#include <atomic>
 
 namespace sdl { namespace db { namespace bpool {
-namespace unit {
-    struct threadIndex{};
-}
-typedef quantity<unit::threadIndex, size_t> threadIndex;
-
 using page32 = pageFileID::page32;
 
 struct pool_limits final : is_static {
-    enum { max_thread = 64 };                                       // 64-bit mask
+    enum { max_thread = 1 << 16 };                                  // sanity limit of registered threads
     enum { block_page_num = 8 };                                    // 1 extent
     enum { page_size = page_head::page_size };                      // 8 KB = 8192 byte = 2^13
     enum { block_size = page_size * block_page_num };               // 64 KB = 65536 byte = 2^16
-    static constexpr size64_t max_block = size_t(1) << 24;            // 2^24 = 16,777,216 => 16777216 * 64 KB = 2^40 (1 terabyte)
-    static constexpr size64_t max_page = max_block * block_page_num;  // 2^27 = 134,217,728
+    static constexpr size64_t max_block = size_t(1) << 24;            // 2^24 = 16,777,216 => 16777216 * 64 KB = 2^40 (1 terabyte of pool memory)
     static constexpr size64_t last_block = max_block - 1;
-    static constexpr size64_t max_filesize = terabyte<1>::value;
+    static constexpr size64_t max_pool_size = max_block * block_size; // block_index::blockId address space
+    static constexpr size64_t max_page = size64_t(1) << 32;           // 2^32 = 4,294,967,296 (pageFileID::page32)
+    static constexpr size64_t max_file_block = max_page / block_page_num; // 2^29 = 536,870,912
+    static constexpr size64_t max_filesize = max_page * page_size;    // 2^45 (32 terabyte)
 };
 
 #pragma pack(push, 1) 
@@ -35,7 +33,7 @@ struct block_index final {
     using block32 = uint32;
     static constexpr block32 invalid_block32 = block32(-1);
     struct data_type {
-        unsigned int blockId : 24;      // 1 terabyte address space 
+        unsigned int blockId : 24;      // 1 terabyte of pool memory
         unsigned int pageLock : 8;      // bitmask
     };
     union {
@@ -57,16 +55,22 @@ struct block_index final {
         d.pageLock = 0xFF;
     }
     bool can_free_unused() const;
+    static constexpr uint32 lock_page_mask(size_t i) {
+        return uint32(1) << (24 + i);
+    }
 };   
 
 inline constexpr size_t page_bit(pageIndex pageId) {
     return pageId.value() & 7; // = pageId.value() % 8;
 }
 
+enum class block_list_id : uint8 { none, lock, unlock, hot, free, fixed };
+
 class page_bpool;
 struct block_head final { // 32 bytes
-    using thread64 = uint64;
-    thread64 pageLockThread;        // 64 threads mask
+    using count64 = uint64;
+    static constexpr count64 fixed_lock = count64(1) << 63;
+    count64 pageLockCount;          // number of threads which locked the page (atomic access)
     uint32 prevBlock;
     uint32 nextBlock;
     uint32 realBlock;               // real MDF block
@@ -76,10 +80,22 @@ struct block_head final { // 32 bytes
     unsigned int reserve24 : 24;      
 #endif
     unsigned int fixedBlock : 8;    // block is fixed in memory
-    uint64 reserve64;
-    bool is_lock_thread(size_t) const;
-    void set_lock_thread(size_t);
-    thread64 clr_lock_thread(size_t); // return new pageLockThread
+    uint32 readAhead;               // read-ahead stream which loaded the block (first page only, atomic access)
+    uint8 pageAccess;               // pages locked since block was loaded (first page only, atomic access)
+    uint8 hotBlock;                 // block was re-referenced, see database_cfg::replacement_policy (first page only, atomic access)
+    block_list_id blockList;        // list which holds the block (first page only)
+    uint8 reserve8;
+    count64 lock_count() const;
+    count64 add_lock_if_locked(); // lock page without stripe mutex if page is locked or fixed, return old pageLockCount
+    bool release_lock_if_shared(); // unlock page without stripe mutex if page is locked by other thread(s)
+    void add_lock(); // stripe mutex must be locked
+    count64 release_lock(); // stripe mutex must be locked, return new pageLockCount
+    void set_fixed_lock(); // page of fixed block
+    uint32 read_ahead() const; // first page only
+    void clr_read_ahead(); // first page only
+    void set_access(size_t); // first page only, marks block re-referenced if page was accessed before
+    void clr_access(); // first page only
+    bool is_hot() const; // first page only
     void set_zero() {
         memset_zero(*this);
     }
@@ -107,6 +123,81 @@ struct block_head final { // 32 bytes
 
 #pragma pack(pop)
 
+class atomic_block_index final : noncopyable { // block_index with lock-free access
+    using block32 = block_index::block32;
+    std::atomic<uint32> m_value;
+public:
+    atomic_block_index() noexcept : m_value(0) {}
+    block_index load() const {
+        block_index b;
+        b.value = m_value.load();
+        return b;
+    }
+    block32 blockId() const {
+        return load().blockId();
+    }
+    uint8 pageLock() const {
+        return load().pageLock();
+    }
+    bool is_lock_page(size_t i) const {
+        return load().is_lock_page(i);
+    }
+    static constexpr uint32 reserved_value = block_index::pageLockMask; // blockId = 0: block is being loaded
+    bool is_reserved() const {
+        return m_value.load() == reserved_value;
+    }
+    bool try_reserve(); // block is not loaded, reserve it to load from file
+    void cancel_reserve();
+    void init_block(block32, size_t); // publish reserved block with locked page
+    void init_block_unlocked(block32); // publish reserved block without locked page
+    void set_blockId(block32); // keep pageLock
+    bool try_clr_blockId(block32); // false if page of block was locked concurrently
+    bool try_reserve_move(block32); // reserve unlocked block while it is moved, see init_block_unlocked
+    bool try_lock_page(block32, size_t); // lock page of resident block, false if block was released or moved
+    uint8 set_lock_page(size_t); // return old pageLock
+    uint8 clr_lock_page(size_t); // return new pageLock
+    void set_lock_page_all() {
+        m_value |= block_index::pageLockMask;
+    }
+};
+
+// atomic_block_index of each file block. Segments are allocated on first access, 
+// so metadata of huge file is allocated only for touched regions.
+class block_index_map final : noncopyable {
+    enum { segment_power = 16 };
+    enum { segment_size = 1 << segment_power }; // 64K blocks = 4 GB of file, 256 KB of metadata
+    using segment_ptr = atomic_block_index *;
+public:
+    explicit block_index_map(size_t block_count);
+    ~block_index_map();
+    size_t size() const {
+        return m_size;
+    }
+    bool empty() const {
+        return !m_size;
+    }
+    atomic_block_index & operator[](size_t const i) {
+        SDL_ASSERT(i < m_size);
+        if (segment_ptr const p = m_segment[i >> segment_power].load(std::memory_order_acquire)) {
+            return p[i & (segment_size - 1)];
+        }
+        return alloc_segment(i >> segment_power)[i & (segment_size - 1)];
+    }
+    atomic_block_index const & operator[](size_t const i) const { // block is not loaded if segment is not allocated
+        SDL_ASSERT(i < m_size);
+        if (segment_ptr const p = m_segment[i >> segment_power].load(std::memory_order_acquire)) {
+            return p[i & (segment_size - 1)];
+        }
+        return m_empty;
+    }
+    size_t segment_count() const; // allocated segments
+private:
+    segment_ptr alloc_segment(size_t);
+    const size_t m_size;
+    std::vector<std::atomic<segment_ptr>> m_segment;
+    const atomic_block_index m_empty;
+};
+
 using interval_block32 = interval_set<block_index::block32>;
 
 }}} // sdl
@@ -36,16 +36,140 @@ inline bool block_index::can_free_unused() const { // block is loaded and not lo
 }
 //-----------------------------------------------------------------
 
-inline bool block_head::is_lock_thread(size_t const i) const {
-    return bitmask<thread64>::is_bit(pageLockThread, i);
+inline bool atomic_block_index::try_reserve() {
+    uint32 old = 0;
+    return m_value.compare_exchange_strong(old, reserved_value);
 }
-inline void block_head::set_lock_thread(size_t const i) {
-    bitmask<thread64>::set_bit(pageLockThread, i);
+inline void atomic_block_index::cancel_reserve() {
+    SDL_ASSERT(is_reserved());
+    m_value = 0;
 }
-inline block_head::thread64
-block_head::clr_lock_thread(size_t const i) {
-    bitmask<thread64>::clr_bit(pageLockThread, i);
-    return pageLockThread;
+inline void atomic_block_index::init_block(block32 const v, size_t const i) {
+    SDL_ASSERT(v && (v < pool_limits::max_block));
+    SDL_ASSERT(i < 8);
+    SDL_ASSERT(is_reserved() && "block is not loaded");
+    m_value = v | block_index::lock_page_mask(i);
+}
+inline void atomic_block_index::init_block_unlocked(block32 const v) {
+    SDL_ASSERT(v && (v < pool_limits::max_block));
+    SDL_ASSERT(is_reserved() && "block is not loaded");
+    m_value = v;
+}
+inline void atomic_block_index::set_blockId(block32 const v) {
+    SDL_ASSERT(v < pool_limits::max_block);
+    uint32 old = m_value.load();
+    while (!m_value.compare_exchange_weak(old, (old & block_index::pageLockMask) | v)) {}
+}
+inline bool atomic_block_index::try_clr_blockId(block32 const v) {
+    SDL_ASSERT(v && (v < pool_limits::max_block));
+    uint32 old = v;
+    return m_value.compare_exchange_strong(old, 0);
+}
+inline bool atomic_block_index::try_reserve_move(block32 const v) {
+    SDL_ASSERT(v && (v < pool_limits::max_block));
+    uint32 old = v;
+    return m_value.compare_exchange_strong(old, reserved_value);
+}
+inline bool atomic_block_index::try_lock_page(block32 const v, size_t const i) {
+    SDL_ASSERT(v && (i < 8));
+    const uint32 mask = block_index::lock_page_mask(i);
+    uint32 old = m_value.load();
+    while (((old & block_index::blockIdMask) == v) && !(old & mask)) {
+        if (m_value.compare_exchange_weak(old, old | mask)) {
+            return true;
+        }
+    }
+    return false; // block was released or moved, or page was locked concurrently
+}
+inline uint8 atomic_block_index::set_lock_page(size_t const i) {
+    SDL_ASSERT(i < 8);
+    return static_cast<uint8>(m_value.fetch_or(block_index::lock_page_mask(i)) >> 24);
+}
+inline uint8 atomic_block_index::clr_lock_page(size_t const i) {
+    SDL_ASSERT(i < 8);
+    const uint32 mask = block_index::lock_page_mask(i);
+    return static_cast<uint8>((m_value.fetch_and(~mask) & ~mask) >> 24);
+}
+
+//-----------------------------------------------------------------
+
+namespace block_head_ { // pageLockCount can be changed without page_bpool mutex
+    using atomic_count64 = std::atomic<block_head::count64>;
+    static_assert(sizeof(atomic_count64) == sizeof(block_head::count64), "");
+    inline atomic_count64 & atomic_lock_count(block_head::count64 & v) {
+        return reinterpret_cast<atomic_count64 &>(v);
+    }
+    inline atomic_count64 const & atomic_lock_count(block_head::count64 const & v) {
+        return reinterpret_cast<atomic_count64 const &>(v);
+    }
+    template<class T> // readAhead, pageAccess and hotBlock are read by lock_page_fast
+    inline std::atomic<T> & atomic_field(T & v) {
+        static_assert(sizeof(std::atomic<T>) == sizeof(T), "");
+        return reinterpret_cast<std::atomic<T> &>(v);
+    }
+    template<class T>
+    inline std::atomic<T> const & atomic_field(T const & v) {
+        static_assert(sizeof(std::atomic<T>) == sizeof(T), "");
+        return reinterpret_cast<std::atomic<T> const &>(v);
+    }
+}
+
+inline block_head::count64
+block_head::lock_count() const {
+    return block_head_::atomic_lock_count(pageLockCount).load();
+}
+inline block_head::count64
+block_head::add_lock_if_locked() {
+    auto & count = block_head_::atomic_lock_count(pageLockCount);
+    count64 old = count.load();
+    while (old && !(old & fixed_lock)) { // page of fixed block is not counted
+        if (count.compare_exchange_weak(old, old + 1)) {
+            break;
+        }
+    }
+    return old; // if zero, page is not locked, use stripe mutex
+}
+inline bool block_head::release_lock_if_shared() {
+    auto & count = block_head_::atomic_lock_count(pageLockCount);
+    count64 old = count.load();
+    while ((old > 1) && !(old & fixed_lock)) {
+        if (count.compare_exchange_weak(old, old - 1)) {
+            return true;
+        }
+    }
+    return false; // last lock, use stripe mutex
+}
+inline void block_head::add_lock() {
+    block_head_::atomic_lock_count(pageLockCount).fetch_add(1);
+}
+inline block_head::count64
+block_head::release_lock() {
+    const count64 old = block_head_::atomic_lock_count(pageLockCount).fetch_sub(1);
+    SDL_ASSERT(old & ~fixed_lock);
+    return old - 1;
+}
+inline void block_head::set_fixed_lock() {
+    block_head_::atomic_lock_count(pageLockCount).fetch_or(fixed_lock);
+}
+inline uint32 block_head::read_ahead() const {
+    return block_head_::atomic_field(readAhead).load(std::memory_order_relaxed);
+}
+inline void block_head::clr_read_ahead() {
+    block_head_::atomic_field(readAhead).store(0, std::memory_order_relaxed);
+}
+inline void block_head::set_access(size_t const i) {
+    SDL_ASSERT(i < 8);
+    const uint8 bit = uint8(1) << i;
+    if (block_head_::atomic_field(pageAccess).fetch_or(bit, std::memory_order_relaxed) & bit) {
+        block_head_::atomic_field(hotBlock).store(1, std::memory_order_relaxed);
+    }
+}
+inline void block_head::clr_access() {
+    block_head_::atomic_field(hotBlock).store(0, std::memory_order_relaxed);
+    block_head_::atomic_field(pageAccess).store(0, std::memory_order_relaxed);
+}
+inline bool block_head::is_hot() const {
+    return block_head_::atomic_field(hotBlock).load(std::memory_order_relaxed) != 0;
 }
 
 //-----------------------------------------------------------------
@@ -60,6 +60,7 @@ size_t block_list_t::length() const // O(N)
         ++count;
         p = m_p.first_block_head(p)->nextBlock;
     }
+    SDL_ASSERT(count == m_count);
     return count;
 }
 
@@ -88,6 +89,8 @@ bool block_list_t::remove(block_head * const item, block32 const blockId)
     }
     SDL_ASSERT(find_block(blockId));
     SDL_ASSERT(m_block_tail);
+    SDL_ASSERT(m_count);
+    --m_count;
     if (m_block_list == blockId) {
         SDL_ASSERT(!item->prevBlock);
         m_block_list = item->nextBlock; // can be 0
@@ -167,6 +170,9 @@ size_t block_list_t::truncate(block_list_t & dest, size_t const block_count)
         SDL_ASSERT(empty());
     }
     SDL_ASSERT(p_head && p_tail);
+    SDL_ASSERT(count <= m_count);
+    m_count -= count;
+    dest.m_count += count;
     if (dest.empty()) {
         dest.m_block_list = p_head;
         dest.m_block_tail = p_tail;
@@ -205,8 +211,10 @@ bool block_list_t::append(block_list_t && src)
         SDL_ASSERT(m_block_tail != src.m_block_tail);
         m_block_tail = src.m_block_tail;
     }
+    m_count += src.m_count;
     src.m_block_list = null;
     src.m_block_tail = null;
+    src.m_count = 0;
     SDL_ASSERT(!empty() && src.empty());
     return true;
 }
@@ -217,6 +225,8 @@ block_list_t::pop_head() {
     block32 const blockId = m_block_list;
     block_head * const p = m_p.first_block_head(blockId);
     SDL_ASSERT(!p->prevBlock);
+    SDL_ASSERT(m_count);
+    --m_count;
     if (p->nextBlock) {
         block_head * const next = m_p.first_block_head(p->nextBlock);
         SDL_ASSERT(next->prevBlock == blockId);
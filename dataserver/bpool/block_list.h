@@ -27,12 +27,17 @@ class block_list_t : noncopyable {
 public:
     enum { null = 0 };
     using value_type = block32;
-    explicit block_list_t(page_bpool_friend && p, const char * const s = "")
+    explicit block_list_t(page_bpool_friend && p, const char * const s = "",
+        block_list_id const id = block_list_id::none)
         : m_p(p)
+        , m_id(id)
 #if SDL_DEBUG
         , m_name(s)
 #endif
     {}
+    block_list_id id() const { // stored in block_head::blockList by insert
+        return m_id;
+    }
     block32 head() const {
         return m_block_list;
     }
@@ -49,6 +54,10 @@ public:
     void clear() {
         m_block_list = null;
         m_block_tail = null;
+        m_count = 0;
+    }
+    size_t size() const { // O(1)
+        return m_count;
     }
     size_t length() const; // O(N)
     using block_head_Id = std::pair<block_head *, block32>;
@@ -68,9 +77,11 @@ public:
     void for_each_insert(interval_block32 &) const;
 private:
     page_bpool_friend const m_p;
+    block_list_id const m_id;
     SDL_DEBUG_HPP(const char * const m_name;)
     block32 m_block_list = 0; // head
     block32 m_block_tail = 0;
+    size_t m_count = 0; // number of blocks
 };
 
 template<class fun_type> break_or_continue
@@ -27,6 +27,8 @@ inline void block_list_t::insert(block_head * const item, block32 const blockId)
     }
     SDL_ASSERT(item->prevBlock == null);
     m_block_list = blockId;
+    item->blockList = m_id;
+    ++m_count;
     SDL_ASSERT(!empty());
     SDL_ASSERT_DEBUG_2(assert_list());
 }
@@ -2,6 +2,29 @@
 //
 #include "dataserver/bpool/file.h"
 
+#if defined(SDL_OS_UNIX) || defined(SDL_OS_APPLE)
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <stdlib.h>
+#include <thread>
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SDL_BPOOL_IO_URING  1
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+#endif
+#endif
+
+#if !defined(SDL_BPOOL_IO_URING)
+#define SDL_BPOOL_IO_URING  0
+#endif
+
 namespace sdl { namespace db { namespace bpool {
 
 #if defined(SDL_OS_WIN32)
@@ -34,14 +57,10 @@ namespace {
 #pragma pack(pop)
 } // namespace
 
-PagePoolFile_win32::PagePoolFile_win32(const std::string & fname)
+PagePoolFile_win32::PagePoolFile_win32(const std::string & fname, bool const direct_io)
+    : m_direct_io(direct_io)
 {
-#define SDL_OS_WIN32_FILE_NO_BUFFERING  0 
-#if SDL_OS_WIN32_FILE_NO_BUFFERING
-    SDL_TRACE(__FUNCTION__, " NO_BUFFERING"); // slow
-#else
-    SDL_TRACE(__FUNCTION__, " WITH BUFFERING");
-#endif
+    SDL_TRACE(__FUNCTION__, m_direct_io ? " NO_BUFFERING" : " WITH BUFFERING");
     SDL_ASSERT(!fname.empty());
     if (!fname.empty()) {
         hFile = ::CreateFileA(fname.c_str(), // lpFileName
@@ -49,11 +68,7 @@ PagePoolFile_win32::PagePoolFile_win32(const std::string & fname)
             FILE_SHARE_READ,            // dwShareMode
             nullptr,                    // lpSecurityAttributes
             OPEN_EXISTING,              // dwCreationDisposition
-#if SDL_OS_WIN32_FILE_NO_BUFFERING
-            FILE_FLAG_NO_BUFFERING|FILE_ATTRIBUTE_READONLY,
-#else
-            FILE_ATTRIBUTE_READONLY,    // WITH BUFFERING
-#endif
+            m_direct_io ? (FILE_FLAG_NO_BUFFERING|FILE_ATTRIBUTE_READONLY) : FILE_ATTRIBUTE_READONLY,
             nullptr);                   // hTemplateFile
         SDL_ASSERT(hFile != INVALID_HANDLE_VALUE);
         if (hFile != INVALID_HANDLE_VALUE) {
@@ -63,7 +78,6 @@ PagePoolFile_win32::PagePoolFile_win32(const std::string & fname)
     }
     throw_error_if_not_t<PagePoolFile_win32>(is_open() && m_filesize,
         "CreateFileA failed");
-#undef SDL_OS_WIN32_FILE_NO_BUFFERING
 }
 
 PagePoolFile_win32::~PagePoolFile_win32() {
@@ -137,4 +151,415 @@ void PagePoolFile_win32::read(char * lpBuffer, const size_t offset, size_t size)
 
 #endif // #if defined(SDL_OS_WIN32)
 
-}}} // sdl
\ No newline at end of file
+#if defined(SDL_OS_UNIX) || defined(SDL_OS_APPLE)
+
+#if SDL_BPOOL_IO_URING
+
+// Minimal io_uring (without liburing): batch of IORING_OP_READV, waits for all completions.
+class PagePoolFile_unix::io_uring_t : noncopyable {
+public:
+    enum { queue_depth = 64 };
+    static std::unique_ptr<io_uring_t> create(); // nullptr if io_uring is not supported
+    ~io_uring_t();
+    bool read(int fd, read_request const *, size_t count); // false if request failed
+    bool failed() const { // io_uring_enter failed, ring is not used any more
+        return m_failed;
+    }
+private:
+    io_uring_t() = default;
+    bool init();
+    size_t submit(int fd, read_request const *, size_t count); // returns number of submitted requests
+    size_t reap(read_request const *, bool & result); // returns number of completions
+    void drain(size_t count); // waits for submitted requests without io_uring_enter
+private:
+    std::atomic<bool> m_failed{ false };
+    int m_ring_fd = -1;
+    void * m_sq_ptr = MAP_FAILED;
+    size_t m_sq_size = 0;
+    void * m_cq_ptr = MAP_FAILED;
+    size_t m_cq_size = 0;
+    io_uring_sqe * m_sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+    size_t m_sqes_size = 0;
+    unsigned * m_sq_tail = nullptr;
+    unsigned * m_sq_mask = nullptr;
+    unsigned * m_sq_array = nullptr;
+    unsigned * m_cq_head = nullptr;
+    unsigned * m_cq_tail = nullptr;
+    unsigned * m_cq_mask = nullptr;
+    io_uring_cqe * m_cqes = nullptr;
+    unsigned m_entries = 0;
+    std::vector<iovec> m_iov;
+};
+
+std::unique_ptr<PagePoolFile_unix::io_uring_t>
+PagePoolFile_unix::io_uring_t::create()
+{
+    std::unique_ptr<io_uring_t> p(new io_uring_t);
+    if (p->init()) {
+        return p;
+    }
+    return{};
+}
+
+bool PagePoolFile_unix::io_uring_t::init()
+{
+    io_uring_params params;
+    memset_zero(params);
+    m_ring_fd = static_cast<int>(::syscall(__NR_io_uring_setup, queue_depth, &params));
+    if (m_ring_fd < 0) {
+        SDL_TRACE("io_uring_setup failed, errno = ", errno);
+        return false;
+    }
+    m_entries = params.sq_entries;
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single_mmap) {
+        m_sq_size = m_cq_size = a_max(m_sq_size, m_cq_size);
+    }
+    m_sq_ptr = ::mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) {
+        return false;
+    }
+    if (single_mmap) {
+        m_cq_ptr = m_sq_ptr;
+    }
+    else {
+        m_cq_ptr = ::mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+        if (m_cq_ptr == MAP_FAILED) {
+            return false;
+        }
+    }
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe *>(::mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES));
+    if (m_sqes == MAP_FAILED) {
+        return false;
+    }
+    char * const sq = static_cast<char *>(m_sq_ptr);
+    char * const cq = static_cast<char *>(m_cq_ptr);
+    m_sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_sq_mask = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    m_cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_cq_mask = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+    m_iov.resize(m_entries);
+    SDL_TRACE("io_uring entries = ", m_entries);
+    return true;
+}
+
+PagePoolFile_unix::io_uring_t::~io_uring_t()
+{
+    if (m_sqes != MAP_FAILED) {
+        ::munmap(m_sqes, m_sqes_size);
+    }
+    if ((m_cq_ptr != MAP_FAILED) && (m_cq_ptr != m_sq_ptr)) {
+        ::munmap(m_cq_ptr, m_cq_size);
+    }
+    if (m_sq_ptr != MAP_FAILED) {
+        ::munmap(m_sq_ptr, m_sq_size);
+    }
+    if (m_ring_fd >= 0) {
+        ::close(m_ring_fd);
+    }
+}
+
+size_t PagePoolFile_unix::io_uring_t::submit(int const fd, read_request const * const req, size_t const count)
+{
+    const size_t n = a_min(count, size_t(m_entries));
+    unsigned tail = *m_sq_tail; // only this thread writes sq tail
+    for (size_t i = 0; i < n; ++i) {
+        const unsigned index = tail & *m_sq_mask;
+        m_iov[i].iov_base = req[i].dest;
+        m_iov[i].iov_len = req[i].size;
+        io_uring_sqe & sqe = m_sqes[index];
+        memset_zero(sqe);
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64>(&m_iov[i]);
+        sqe.len = 1;
+        sqe.off = req[i].offset;
+        sqe.user_data = i;
+        m_sq_array[index] = index;
+        ++tail;
+    }
+    __atomic_store_n(m_sq_tail, tail, __ATOMIC_RELEASE);
+    return n;
+}
+
+size_t PagePoolFile_unix::io_uring_t::reap(read_request const * const req, bool & result)
+{
+    unsigned head = *m_cq_head; // only this thread writes cq head
+    const unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    size_t done = 0;
+    for (; head != tail; ++head, ++done) {
+        io_uring_cqe const & cqe = m_cqes[head & *m_cq_mask];
+        if (req && (cqe.res != static_cast<int>(req[cqe.user_data].size))) {
+            result = false; // error or short read, repeated by caller
+        }
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+    return done;
+}
+
+// requests already in kernel keep writing into caller buffers, so they are waited for (bounded) before 
+// caller falls back to preadv; completions are posted to cq ring without io_uring_enter
+void PagePoolFile_unix::io_uring_t::drain(size_t count)
+{
+    enum { max_wait_ms = 1000 };
+    bool result = true;
+    for (size_t i = 0; count && (i < max_wait_ms); ++i) {
+        count -= a_min(reap(nullptr, result), count);
+        if (count) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    SDL_WARNING(!count);
+}
+
+bool PagePoolFile_unix::io_uring_t::read(int const fd, read_request const * req, size_t count)
+{
+    if (m_failed) {
+        return false;
+    }
+    while (count) {
+        const size_t n = submit(fd, req, count);
+        size_t done = 0;
+        unsigned to_submit = static_cast<unsigned>(n);
+        bool result = true;
+        while (done < n) {
+            const int ret = static_cast<int>(::syscall(__NR_io_uring_enter, m_ring_fd, 
+                to_submit, static_cast<unsigned>(n - done), IORING_ENTER_GETEVENTS, nullptr, 0));
+            if (ret >= 0) {
+                to_submit -= a_min(static_cast<unsigned>(ret), to_submit); // number of submitted requests
+            }
+            else if ((errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY)) { // EBUSY: cq ring is full, reap below
+                SDL_TRACE("io_uring_enter failed, errno = ", errno);
+                m_failed = true; // unsubmitted entries stay in sq ring, so ring is abandoned
+                drain(n - to_submit - done);
+                return false;
+            }
+            done += reap(req, result);
+        }
+        if (!result) {
+            return false;
+        }
+        req += n;
+        count -= n;
+    }
+    return true;
+}
+
+#else // SDL_BPOOL_IO_URING
+
+class PagePoolFile_unix::io_uring_t : noncopyable {
+public:
+    static std::unique_ptr<io_uring_t> create() {
+        return{};
+    }
+    bool read(int, read_request const *, size_t) {
+        return false;
+    }
+    bool failed() const {
+        return true;
+    }
+};
+
+#endif // SDL_BPOOL_IO_URING
+
+PagePoolFile_unix::PagePoolFile_unix(const std::string & fname, bool const direct_io)
+{
+    SDL_ASSERT(!fname.empty());
+#if defined(O_DIRECT)
+    if (direct_io) {
+        m_fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC | O_DIRECT);
+        if (m_fd != -1) {
+            m_direct_io = true;
+        }
+        else { // e.g. tmpfs does not support O_DIRECT
+            SDL_TRACE("O_DIRECT failed, errno = ", errno);
+        }
+    }
+#endif
+    if (m_fd == -1) {
+        m_fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+#if defined(F_NOCACHE)
+        if (direct_io && (m_fd != -1)) {
+            m_direct_io = (::fcntl(m_fd, F_NOCACHE, 1) != -1);
+        }
+#endif
+    }
+    SDL_ASSERT(m_direct_io || !direct_io);
+    if (m_fd != -1) {
+        struct stat st;
+        if (!::fstat(m_fd, &st)) {
+            m_filesize = static_cast<size_t>(st.st_size);
+        }
+        m_ring = io_uring_t::create();
+    }
+}
+
+bool PagePoolFile_unix::use_io_uring() const
+{
+    return m_ring && !m_ring->failed();
+}
+
+PagePoolFile_unix::~PagePoolFile_unix()
+{
+    m_ring.reset();
+    if (m_fd != -1) {
+        ::close(m_fd);
+    }
+}
+
+bool PagePoolFile_unix::is_aligned(read_request const * const req, size_t const count) const
+{
+    if (m_direct_io) {
+        for (size_t i = 0; i < count; ++i) {
+            if (!(is_aligned(reinterpret_cast<size_t>(req[i].dest)) && 
+                  is_aligned(req[i].offset) && 
+                  is_aligned(req[i].size))) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void PagePoolFile_unix::pread_bounce(char * const dest, size_t const offset, size_t const size)
+{
+    SDL_ASSERT(m_direct_io);
+    SDL_ASSERT(is_aligned(offset) && is_aligned(size));
+    void * buf = nullptr;
+    if (::posix_memalign(&buf, direct_align, size)) {
+        throw_error_t<PagePoolFile_unix>("posix_memalign failed");
+    }
+    std::unique_ptr<void, void(*)(void *)> const guard(buf, ::free);
+    char * p = static_cast<char *>(buf);
+    size_t pos = offset;
+    size_t left = size;
+    while (left) {
+        const ssize_t n = ::pread(m_fd, p, left, static_cast<off_t>(pos));
+        if (n > 0) {
+            p += n;
+            pos += n;
+            left -= n;
+        }
+        else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        else {
+            throw_error_t<PagePoolFile_unix>("pread failed");
+        }
+    }
+    memcpy(dest, buf, size);
+}
+
+void PagePoolFile_unix::pread_all(char * dest, size_t offset, size_t size)
+{
+    if (m_direct_io && !is_aligned(reinterpret_cast<size_t>(dest))) {
+        pread_bounce(dest, offset, size);
+        return;
+    }
+    while (size) {
+        const ssize_t n = ::pread(m_fd, dest, size, static_cast<off_t>(offset));
+        if (n > 0) {
+            dest += n;
+            offset += n;
+            size -= n;
+        }
+        else if ((n < 0) && (errno == EINTR)) {
+            continue;
+        }
+        else {
+            throw_error_t<PagePoolFile_unix>("pread failed");
+        }
+    }
+}
+
+void PagePoolFile_unix::preadv_all(read_request const * const req, size_t const count)
+{
+    SDL_ASSERT(count);
+    enum { max_iov = 64 };
+    size_t offset = req[0].offset;
+    for (size_t first = 0; first < count; ) {
+        iovec iov[max_iov];
+        size_t const n = a_min(count - first, size_t(max_iov));
+        size_t size = 0;
+        for (size_t i = 0; i < n; ++i) {
+            read_request const & r = req[first + i];
+            SDL_ASSERT(r.offset == offset + size);
+            iov[i].iov_base = r.dest;
+            iov[i].iov_len = r.size;
+            size += r.size;
+        }
+        const ssize_t res = ::preadv(m_fd, iov, static_cast<int>(n), static_cast<off_t>(offset));
+        if ((res >= 0) && (static_cast<size_t>(res) == size)) {
+            offset += size;
+            first += n;
+            continue;
+        }
+        if ((res < 0) && (errno != EINTR)) {
+            throw_error_t<PagePoolFile_unix>("preadv failed");
+        }
+        for (size_t i = 0; i < n; ++i) { // short read: repeat by single requests
+            read_request const & r = req[first + i];
+            pread_all(r.dest, r.offset, r.size);
+        }
+        offset += size;
+        first += n;
+    }
+}
+
+void PagePoolFile_unix::read(char * const dest, size_t const offset, size_t const size)
+{
+    SDL_ASSERT(dest);
+    SDL_ASSERT(size && !(size % page_head::page_size));
+    SDL_ASSERT(offset + size <= filesize());
+    file_stats_timer const timer(m_stats, 1, size);
+    pread_all(dest, offset, size);
+}
+
+void PagePoolFile_unix::read(read_request const * const req, size_t const count)
+{
+    if (!count) {
+        return;
+    }
+    size_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) {
+        SDL_ASSERT(req[i].dest);
+        SDL_ASSERT(req[i].size && !(req[i].size % page_head::page_size));
+        SDL_ASSERT(req[i].offset + req[i].size <= filesize());
+        bytes += req[i].size;
+    }
+    file_stats_timer const timer(m_stats, count, bytes);
+    if (!is_aligned(req, count)) { // direct_io into unaligned memory
+        for (size_t i = 0; i < count; ++i) {
+            pread_all(req[i].dest, req[i].offset, req[i].size);
+        }
+        return;
+    }
+    if ((count > 1) && use_io_uring()) {
+        std::lock_guard<std::mutex> lock(m_ring_mutex);
+        if (m_ring->read(m_fd, req, count)) {
+            return;
+        }
+    }
+    size_t first = 0; // fallback: merge adjacent requests
+    for (size_t i = 1; i <= count; ++i) {
+        if ((i == count) || (req[i].offset != req[i - 1].offset + req[i - 1].size)) {
+            if (i - first > 1) {
+                preadv_all(req + first, i - first);
+            }
+            else {
+                pread_all(req[first].dest, req[first].offset, req[first].size);
+            }
+            first = i;
+        }
+    }
+}
+
+#endif // SDL_OS_UNIX || SDL_OS_APPLE
+
+}}} // sdl
@@ -10,13 +10,93 @@
 #include <windows.h>
 #endif
 #include <fstream>
+#include <atomic>
+#include <mutex>
+#include <chrono>
 
 namespace sdl { namespace db { namespace bpool {
 
+struct read_request { // read into memory block
+    char * dest;
+    size_t offset; // in file
+    size_t size;
+};
+
+class file_stats_t : noncopyable { // lock-free counters of file reads
+public:
+    enum { hist_size = 16 }; // read latency histogram: hist[i] counts reads of [2^(i-1), 2^i) microseconds
+    struct value_type {
+        size_t read_count = 0;
+        size_t read_bytes = 0;
+        size_t read_time = 0; // microseconds
+        size_t max_time = 0; // microseconds
+        size_t hist[hist_size] = {};
+    };
+    file_stats_t(): m_read_count(0), m_read_bytes(0), m_read_time(0), m_max_time(0) {
+        for (auto & h : m_hist) {
+            h = 0;
+        }
+    }
+    void add(size_t count, size_t bytes, size_t microseconds);
+    value_type get() const;
+    static size_t hist_index(size_t microseconds);
+private:
+    std::atomic<size_t> m_read_count;
+    std::atomic<size_t> m_read_bytes;
+    std::atomic<size_t> m_read_time;
+    std::atomic<size_t> m_max_time;
+    std::atomic<size_t> m_hist[hist_size];
+};
+
+inline size_t file_stats_t::hist_index(size_t microseconds) {
+    size_t i = 0;
+    while (microseconds && (i < hist_size - 1)) {
+        microseconds >>= 1;
+        ++i;
+    }
+    return i;
+}
+
+inline void file_stats_t::add(size_t const count, size_t const bytes, size_t const microseconds) {
+    m_read_count.fetch_add(count, std::memory_order_relaxed);
+    m_read_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    m_read_time.fetch_add(microseconds, std::memory_order_relaxed);
+    m_hist[hist_index(microseconds)].fetch_add(1, std::memory_order_relaxed);
+    size_t old = m_max_time.load();
+    while ((old < microseconds) && !m_max_time.compare_exchange_weak(old, microseconds)) {}
+}
+
+inline file_stats_t::value_type file_stats_t::get() const {
+    value_type v;
+    v.read_count = m_read_count;
+    v.read_bytes = m_read_bytes;
+    v.read_time = m_read_time;
+    v.max_time = m_max_time;
+    for (size_t i = 0; i < hist_size; ++i) {
+        v.hist[i] = m_hist[i];
+    }
+    return v;
+}
+
+class file_stats_timer : noncopyable { // adds read latency to file_stats_t
+    using clock_type = std::chrono::steady_clock;
+    file_stats_t & m_stats;
+    size_t const m_count;
+    size_t const m_bytes;
+    clock_type::time_point const m_start;
+public:
+    file_stats_timer(file_stats_t & s, size_t count, size_t bytes)
+        : m_stats(s), m_count(count), m_bytes(bytes), m_start(clock_type::now()) {}
+    ~file_stats_timer() {
+        const auto d = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - m_start);
+        m_stats.add(m_count, m_bytes, static_cast<size_t>(d.count()));
+    }
+};
+
 #if defined(SDL_OS_WIN32)
 class PagePoolFile_win32 : noncopyable {
 public:
-    explicit PagePoolFile_win32(const std::string & fname);
+    explicit PagePoolFile_win32(const std::string & fname, bool direct_io = false);
     ~PagePoolFile_win32();
     size_t filesize() const { 
         return m_filesize;
@@ -28,20 +108,73 @@ public:
        read(dest, 0, filesize());
     }
     void read(char * dest, size_t offset, size_t size);
+    bool direct_io() const {
+        return m_direct_io;
+    }
 private:
     size_t seek_beg(size_t offset);
     size_t seek_end();
 private:
     size_t m_filesize = 0;
+    bool m_direct_io = false; // FILE_FLAG_NO_BUFFERING
     HANDLE hFile = INVALID_HANDLE_VALUE;
     SDL_DEBUG_HPP(size_t m_seekpos = 0;)
 };
 
 #endif // SDL_OS_WIN32
 
+#if defined(SDL_OS_UNIX) || defined(SDL_OS_APPLE)
+
+// Thread-safe reader: pread/preadv without shared file position.
+// Vectored requests are submitted as one io_uring batch if kernel supports it.
+// With direct_io the file is opened with O_DIRECT (F_NOCACHE on Apple), so blocks read into pool 
+// memory are not cached by OS a second time; pool blocks are 64 KB aligned, other buffers are read via bounce buffer.
+class PagePoolFile_unix : noncopyable {
+public:
+    enum { direct_align = 4096 }; // O_DIRECT alignment of memory, offset and size
+    explicit PagePoolFile_unix(const std::string & fname, bool direct_io = false);
+    ~PagePoolFile_unix();
+    size_t filesize() const { 
+        return m_filesize;
+    }
+    bool is_open() const {
+       return m_fd != -1;
+    }
+    void read_all(char * dest) {
+        read(dest, 0, filesize());
+    }
+    void read(char * dest, size_t offset, size_t size);
+    void read(read_request const *, size_t count); // requests with adjacent offsets are merged
+    file_stats_t::value_type stats() const {
+        return m_stats.get();
+    }
+    bool use_io_uring() const; // false if io_uring is not supported or failed
+    bool direct_io() const {
+        return m_direct_io;
+    }
+private:
+    static bool is_aligned(size_t const x) {
+        return !(x % direct_align);
+    }
+    bool is_aligned(read_request const *, size_t count) const; // true if buffered or requests meet direct_align
+    void pread_all(char * dest, size_t offset, size_t size);
+    void pread_bounce(char * dest, size_t offset, size_t size); // direct_io into unaligned memory
+    void preadv_all(read_request const *, size_t count); // adjacent requests
+private:
+    class io_uring_t;
+    int m_fd = -1;
+    size_t m_filesize = 0;
+    bool m_direct_io = false;
+    file_stats_t m_stats;
+    std::mutex m_ring_mutex; // io_uring is used by one thread at a time
+    std::unique_ptr<io_uring_t> m_ring;
+};
+
+#endif // SDL_OS_UNIX || SDL_OS_APPLE
+
 class PagePoolFile_s : noncopyable {
 public:
-    explicit PagePoolFile_s(const std::string & fname);
+    explicit PagePoolFile_s(const std::string & fname, bool direct_io = false);
     size_t filesize() const { 
         return m_filesize;
     }
@@ -50,12 +183,24 @@ public:
     }
     void read_all(char * dest);
     void read(char * dest, size_t offset, size_t size);
+    void read(read_request const *, size_t count);
+    file_stats_t::value_type stats() const {
+        return m_stats.get();
+    }
+    static constexpr bool use_io_uring() {
+        return false;
+    }
+    static constexpr bool direct_io() { // not supported, see page_bpool_file
+        return false;
+    }
 private:
     size_t m_filesize = 0;
+    std::mutex m_mutex; // guards file position
     std::ifstream m_file;
+    file_stats_t m_stats;
 };
 
-inline PagePoolFile_s::PagePoolFile_s(const std::string & fname)
+inline PagePoolFile_s::PagePoolFile_s(const std::string & fname, bool)
     : m_file(fname, std::ifstream::in | std::ifstream::binary) {
     if (m_file.is_open()) {
         m_file.seekg(0, std::ios_base::end);
@@ -65,23 +210,31 @@ inline PagePoolFile_s::PagePoolFile_s(const std::string & fname)
 }
 
 inline void PagePoolFile_s::read_all(char * const dest){
-    SDL_ASSERT(dest);
-    m_file.seekg(0, std::ios_base::beg);
-    m_file.read(dest, filesize());
+    read(dest, 0, filesize());
 }
 
 inline void PagePoolFile_s::read(char * const dest, const size_t offset, const size_t size) {
     SDL_ASSERT(dest);
     SDL_ASSERT(size && !(size % page_head::page_size));
     SDL_ASSERT(offset + size <= filesize());
+    file_stats_timer const timer(m_stats, 1, size);
+    std::lock_guard<std::mutex> lock(m_mutex);
     m_file.seekg(offset, std::ios_base::beg);
     m_file.read(dest, size);
 }
 
-#if 0 // defined(SDL_OS_WIN32)
+inline void PagePoolFile_s::read(read_request const * const req, const size_t count) {
+    for (size_t i = 0; i < count; ++i) {
+        read(req[i].dest, req[i].offset, req[i].size);
+    }
+}
+
+#if 0 // defined(SDL_OS_WIN32): PagePoolFile_win32 is not thread-safe (shared file position), direct_io is ignored on Windows
 using PagePoolFile = PagePoolFile_win32;
+#elif defined(SDL_OS_UNIX) || defined(SDL_OS_APPLE)
+using PagePoolFile = PagePoolFile_unix;
 #else
-using PagePoolFile = PagePoolFile_s; // faster ?
+using PagePoolFile = PagePoolFile_s;
 #endif
 
 }}} // sdl
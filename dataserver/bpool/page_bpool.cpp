@@ -21,12 +21,15 @@ pool_info_t::pool_info_t(const size_t s)
 
 //---------------------------------------------------
 
-page_bpool_file::page_bpool_file(const std::string & fname)
-    : m_file(fname) 
+page_bpool_file::page_bpool_file(const std::string & fname, bool const direct_io)
+    : m_file(fname, direct_io) 
 {
     throw_error_if_not_t<base_page_bpool>(m_file.is_open() && m_file.filesize(), "bad file");
     throw_error_if_not_t<base_page_bpool>(valid_filesize(m_file.filesize()), "bad filesize");
     throw_error_if_not_t<base_page_bpool>(m_file.filesize() <= pool_limits::max_filesize, "max_filesize");
+    if (direct_io && !m_file.direct_io()) {
+        SDL_TRACE("direct_io is not supported, file is read through OS page cache");
+    }
 }
 
 bool page_bpool_file::valid_filesize(const size_t filesize) {
@@ -61,41 +64,94 @@ page_bpool_friend::first_block_head(block32 const blockId) const {
 //------------------------------------------------------
 
 base_page_bpool::base_page_bpool(const std::string & fname, database_cfg const & cfg)
-    : page_bpool_file(fname)
+    : page_bpool_file(fname, cfg.direct_io)
     , info(filesize())
 {
     SDL_ASSERT(cfg.min_memory <= cfg.max_memory);
-    m_min_pool_size = a_min(cfg.min_memory, info.filesize);
+    m_min_pool_size = a_min(cfg.min_memory, alloc_capacity());
     if (cfg.max_memory) {
-        m_max_pool_size = a_min_max(cfg.max_memory, m_min_pool_size, info.filesize);
+        m_max_pool_size = a_min_max(cfg.max_memory, m_min_pool_size, alloc_capacity());
     }
     else {
-        m_max_pool_size = info.filesize;
+        m_max_pool_size = alloc_capacity();
     }
     SDL_ASSERT(m_min_pool_size <= m_max_pool_size);
     SDL_ASSERT(m_max_pool_size <= info.filesize);
 }
 
+size_t base_page_bpool::alloc_capacity() const
+{
+    return a_min(info.filesize, size_t(pool_limits::max_pool_size));
+}
+
+thread_local page_bpool const * page_bpool::t_fixed_scope = nullptr;
+
+page_bpool::fixed_scope::fixed_scope(page_bpool const * const p)
+    : m_prev(t_fixed_scope)
+{
+    if (p) {
+        t_fixed_scope = p;
+    }
+}
+
+page_bpool::fixed_scope::~fixed_scope()
+{
+    t_fixed_scope = m_prev;
+}
+
 page_bpool::page_bpool(const std::string & fname, database_cfg const & cfg)
     : base_page_bpool(fname, cfg)
     , init_thread_id(std::this_thread::get_id())
+    , m_mutex_waiters(0)
     , m_block(info.block_count)
-    , m_thread_id(info.filesize)
-    , m_alloc(info.filesize)
-    , m_lock_block_list(this, "lock")
-    , m_unlock_block_list(this, "unlock")
-    , m_free_block_list(this, "free")
-    , m_fixed_block_list(this, "fixed")
+    , m_thread_id(info.filesize, [this](thread_id const id) {
+        this->unlock_thread(id, removef::true_); // called from exiting thread
+    })
+    , m_alloc(alloc_capacity(), alloc_hugepage(cfg), cfg.prefault ? vm_populate::true_ : vm_populate::false_)
+    , m_lock_block_list(this, "lock", block_list_id::lock)
+    , m_unlock_block_list(this, "unlock", block_list_id::unlock)
+    , m_hot_block_list(this, "hot", block_list_id::hot)
+    , m_free_block_list(this, "free", block_list_id::free)
+    , m_fixed_block_list(this, "fixed", block_list_id::fixed)
+    , m_free_block_count(0)
+    , m_hot_block_max(hot_block_max(cfg, max_pool_size()))
+    , m_replacement(cfg.replacement)
+    , m_checksum(cfg.checksum)
+    , m_block_verified((cfg.checksum == database_cfg::checksum_policy::first_load) ? (info.block_count + 31) / 32 : 0)
     , m_td(this, cfg)
+    , m_read_ahead(info.block_count, read_ahead_window(cfg), 
+        [this](block32 const * const b, size_t const count, block32 const mark) {
+        return this->read_ahead_blocks(b, count, mark);
+    })
+    , m_warm_cache_file(cfg.warm_cache)
+    , m_warm_cache([this](block32 const * const b, size_t const count, bool & full) {
+        return this->prewarm_blocks(b, count, full);
+    }, [this]() {
+        return m_counter.get(pool_counter_t::lock_miss) + m_counter.get(pool_counter_t::lock_wait);
+    })
 {
     SDL_TRACE_FUNCTION;
     throw_error_if_not_t<page_bpool>(is_open(), "page_bpool");
     load_zero_block();
     m_td.launch();
+    m_read_ahead.launch();
+    if (!m_warm_cache_file.empty()) {
+        m_warm_cache.launch(warm_cache_t::load(m_warm_cache_file, info.filesize), 
+            max_pool_size() / pool_limits::block_size);
+    }
 }
 
 page_bpool::~page_bpool()
 {
+    m_thread_id.reset_exit(); // exiting threads must not access page_bpool
+    if (!m_warm_cache_file.empty()) {
+        try {
+            save_warm_cache(m_warm_cache_file);
+        }
+        catch (sdl_exception & e) {
+            SDL_TRACE("save_warm_cache failed: ", e.what());
+        }
+    }
 }
 
 void page_bpool::load_zero_block()
@@ -104,7 +160,7 @@ void page_bpool::load_zero_block()
     SDL_ASSERT(!m_block.empty());
     m_zero_block_address = m_alloc.alloc_block();
     throw_error_if_t<page_bpool>(!m_zero_block_address, "bad alloc");
-    m_file.read(m_zero_block_address, 0, info.block_size_in_bytes(0));
+    read_block_from_file(m_zero_block_address, 0);
     m_block[0].set_lock_page_all();
     get_block_head(m_zero_block_address, 0)->set_zero_fixed();
 }
@@ -115,15 +171,40 @@ void page_bpool::trace_block(const char * const title, block32 const blockId, pa
         SDL_TRACE(title, "[",page_bpool::realBlock(pageId),"],",blockId,",", pageId,",",page_bit(pageId),
             " L ", m_lock_block_list.head(),
             " U ", m_unlock_block_list.head(),
+            " H ", m_hot_block_list.head(),
             " F ", m_free_block_list.head());
     }
 }
 #endif
 
+void page_bpool::set_block_fixed(char * const block_adr, size_t const page_count)
+{
+    SDL_ASSERT(page_count && (page_count <= pool_limits::block_page_num));
+    first_block_head(block_adr)->set_fixed();
+    for (size_t i = 0; i < page_count; ++i) {
+        get_block_head(block_adr, i)->set_fixed_lock();
+    }
+}
+
+block_head * page_bpool::init_block_head(char * const block_adr, 
+                                         block32 const blockId,
+                                         uint32 const real_blockId)
+{
+    SDL_ASSERT(blockId && real_blockId);
+    block_head * const first = first_block_head(block_adr);
+    first->set_zero();
+    for (size_t i = 1, end = info.block_page_count(size_t(real_blockId)); i < end; ++i) {
+        get_block_head(block_adr, i)->set_zero();
+    }
+    SDL_DEBUG_CPP(first->d_blockId = blockId);
+    first->realBlock = real_blockId;
+    return first;
+}
+
 page_head const *
 page_bpool::lock_block_init(block32 const blockId,
                             pageIndex const pageId,
-                            threadId_mask const * const threadId,
+                            threadId_mask const threadId,
                             thread_id const this_thread,
                             fixedf const page_fixed)
 {
@@ -133,40 +214,31 @@ page_bpool::lock_block_init(block32 const blockId,
     char * const block_adr = m_alloc.get_block(blockId);
     char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
     page_head * const page = reinterpret_cast<page_head *>(page_adr);
-    block_head * const first = first_block_head(block_adr);
-    { // clear/init block_head for all pages
-        first->set_zero();
-        for (size_t i = 1, end = info.block_page_count(pageId); i < end; ++i) {
-            get_block_head(block_adr, i)->set_zero();
-        }
-    }
-    SDL_DEBUG_CPP(first->d_blockId = blockId);
-    first->realBlock = page_bpool::realBlock(pageId);
-    SDL_ASSERT(first->realBlock);
+    block_head * const first = init_block_head(block_adr, blockId, page_bpool::realBlock(pageId));
     if (!threadId || is_fixed(page_fixed)) {
-        first->set_fixed();
+        set_block_fixed(block_adr, info.block_page_count(pageId));
         m_fixed_block_list.insert(first, blockId);
     }
     else {
-        SDL_ASSERT(threadId->first.value() < pool_limits::max_thread);
-        SDL_ASSERT(threadId->second);
         block_head * const head = block_head::get_block_head(page);
-        head->set_lock_thread(threadId->first.value());
+        head->add_lock();
         m_lock_block_list.insert(first, blockId);
-        threadId->second->set_block(first->realBlock); // skip it for fixed block
+        threadId->set_page(first->realBlock, page_bit(pageId)); // skip it for fixed block
+        access_block(first, pageId);
     }
-    return page;
+    return page; // block_index must be published after block_head(s) are initialized
 }
 
 page_head const *
-page_bpool::lock_block_head(block32 const blockId,
+page_bpool::lock_block_head(atomic_block_index & bi,
+                            block32 const blockId,
                             pageIndex const pageId,
-                            threadId_mask const * const threadId,
+                            threadId_mask const threadId,
                             thread_id const this_thread,
-                            fixedf const page_fixed,
-                            uint8 const oldLock)
+                            fixedf const page_fixed)
 {
     SDL_ASSERT(blockId);
+    SDL_ASSERT(bi.blockId() == blockId);
     SDL_ASSERT(this_thread == std::this_thread::get_id());
     SDL_ASSERT((threadId == nullptr) == is_init_thread(this_thread)); 
     char * const block_adr = m_alloc.get_block(blockId);
@@ -175,85 +247,152 @@ page_bpool::lock_block_head(block32 const blockId,
     block_head * const first = first_block_head(block_adr);
     SDL_ASSERT(first->d_blockId == blockId);
     SDL_ASSERT(first->realBlock == page_bpool::realBlock(pageId));
-    if (threadId) {
-        block_head * const head = block_head::get_block_head(page); // clear/init before first use
-        head->set_lock_thread(threadId->first.value());
-    }
     if (first->is_fixed()) {
         SDL_ASSERT(m_fixed_block_list.find_block(blockId));
         return page;
     }
+    const uint8 oldLock = bi.pageLock();
     if (!threadId || is_fixed(page_fixed)) {
-        first->set_fixed();
-        if (oldLock) { // was already locked
+        set_block_fixed(block_adr, info.block_page_count(pageId));
+        bi.set_lock_page_all();
+        if (first->blockList == block_list_id::lock) {
             m_lock_block_list.remove(first, blockId);
         }
-        else { // was unlocked
-            m_unlock_block_list.remove(first, blockId);
+        else { // unlocked, or locked by lock_page_fast while in unlock list
+            remove_unlock_block(first, blockId);
         }
         m_fixed_block_list.insert(first, blockId);
+        return page;
     }
-    else {
-        SDL_ASSERT(threadId->first.value() < pool_limits::max_thread);
-        SDL_ASSERT(threadId->second);
-        if (oldLock) { // was already locked
-            SDL_ASSERT_DEBUG_2(m_lock_block_list.find_block(blockId));
-            m_lock_block_list.promote(first, blockId);
-        }
-        else { // was unlocked
-            SDL_ASSERT_DEBUG_2(m_unlock_block_list.find_block(blockId));
-            m_unlock_block_list.remove(first, blockId);
-            m_lock_block_list.insert(first, blockId);
+    if (!oldLock) { // first lock of block loaded by read-ahead
+        if (uint32 const mark = first->read_ahead()) {
+            m_read_ahead.trigger(mark, first->realBlock);
+            first->clr_read_ahead();
         }
-        threadId->second->set_block(first->realBlock); // skip it for fixed block
     }
+    if (threadId->is_page(first->realBlock, page_bit(pageId))) { // page is already locked by this thread
+        SDL_ASSERT(bi.is_lock_page(page_bit(pageId)));
+        return page;
+    }
+    bi.set_lock_page(page_bit(pageId)); // pageLock is set before pageLockCount
+    block_head::get_block_head(page)->add_lock();
+    threadId->set_page(first->realBlock, page_bit(pageId)); // skip it for fixed block
+    if (first->blockList == block_list_id::lock) {
+        SDL_ASSERT_DEBUG_2(m_lock_block_list.find_block(blockId));
+        m_lock_block_list.promote(first, blockId);
+    }
+    else { // unlocked, or locked by lock_page_fast while in unlock list
+        remove_unlock_block(first, blockId);
+        m_lock_block_list.insert(first, blockId);
+    }
+    access_block(first, pageId);
     return page;
 }
 
+// stripe mutex already locked; page lock of current thread is already removed from thread mask
 page_bpool::unlock_result
-page_bpool::unlock_block_head(block_index & bi,
+page_bpool::unlock_block_head(atomic_block_index & bi,
                               block32 const blockId,
-                              pageIndex const pageId, 
-                              threadIndex const threadId)
+                              pageIndex const pageId)
 {
     SDL_ASSERT(blockId);
-    SDL_ASSERT(bi.pageLock());
-    SDL_ASSERT(!is_init_thread(std::this_thread::get_id())); 
-    SDL_ASSERT(threadId.value() < pool_limits::max_thread);
+    SDL_ASSERT(bi.blockId() == blockId);
     char * const block_adr = m_alloc.get_block(blockId);
-    char * const page_adr = block_adr + page_head::page_size * page_bit(pageId);
-    page_head * const page = reinterpret_cast<page_head *>(page_adr); 
-    block_head * const head = block_head::get_block_head(page);
+    block_head * const head = get_block_head(block_adr, page_bit(pageId));
     block_head * const first = first_block_head(block_adr);
-    if (!head->clr_lock_thread(threadId.value())) { // no more locks for this page
-        if (bi.clr_lock_page(page_bit(pageId))) {
-            SDL_ASSERT(!bi.is_lock_page(page_bit(pageId))); // this page unlocked
-            return unlock_result::false_; // other page(s) are still locked 
-        }
-        SDL_ASSERT(!head->pageLockThread);
-        if (first->is_fixed()) {
-            SDL_ASSERT(m_fixed_block_list.find_block(blockId)); 
-            SDL_ASSERT(!first->pageLockThread);
-            SDL_ASSERT(!head->pageLockThread);
-            return unlock_result::fixed_;
-        }
+    if (first->is_fixed()) {
+        return unlock_result::fixed_;
+    }
+    SDL_ASSERT(bi.is_lock_page(page_bit(pageId)));
+    if (head->release_lock()) {
+        return unlock_result::false_; // page is locked by other thread(s)
+    }
+    if (bi.clr_lock_page(page_bit(pageId))) {
+        return unlock_result::false_; // other page(s) are still locked 
+    }
+    // no more locks for this block, but lock_page_fast can lock it again before m_mutex is taken
+    unique_lock lock(m_mutex, std::defer_lock);
+    lock_mutex(lock);
+    if (bi.blockId() != blockId) { // was locked by lock_page_fast in unlock list, then evicted or moved
+        return unlock_result::true_;
+    }
+    if (bi.pageLock()) {
+        return unlock_result::false_; // locked again by lock_page_fast
+    }
+    if (first->blockList == block_list_id::lock) {
+        SDL_ASSERT_DEBUG_2(m_lock_block_list.find_block(blockId));
         m_lock_block_list.remove(first, blockId);
+    }
+    else { // locked by lock_page_fast while in unlock list
+        remove_unlock_block(first, blockId);
+    }
+    insert_unlock_block(first, blockId);
+    return unlock_result::true_;
+}
+
+// 2Q: block enters probationary list (m_unlock_block_list) and becomes protected (m_hot_block_list)
+// if any of its pages is locked again, so a sequential scan which locks every page once can't flush hot blocks.
+size_t page_bpool::hot_block_max(database_cfg const & cfg, size_t const max_pool_size)
+{
+    if (cfg.replacement == database_cfg::replacement_policy::two_queue) {
+        return a_max(max_pool_size / pool_limits::block_size * 3 / 4, size_t(1)); // 75% of pool
+    }
+    return 0;
+}
+
+block_list_t & page_bpool::unlock_list(block_head const * const first)
+{
+    SDL_ASSERT((first->blockList == block_list_id::unlock) || (first->blockList == block_list_id::hot));
+    SDL_ASSERT((first->blockList != block_list_id::hot) || is_two_queue());
+    return (first->blockList == block_list_id::hot) ? m_hot_block_list : m_unlock_block_list;
+}
+
+void page_bpool::insert_unlock_block(block_head * const first, block32 const blockId)
+{
+    if (!first->is_hot()) {
         m_unlock_block_list.insert(first, blockId);
-        return unlock_result::true_;
+        return;
+    }
+    m_hot_block_list.insert(first, blockId);
+    if (++m_hot_block_count > m_hot_block_max) { // demote least recently used protected block
+        block32 const tail = m_hot_block_list.tail();
+        block_head * const h = first_block_head(tail);
+        m_hot_block_list.remove(h, tail);
+        --m_hot_block_count;
+        h->clr_access();
+        m_unlock_block_list.insert(h, tail);
+        ++m_locked_stats.demote_hot;
+    }
+}
+
+void page_bpool::remove_unlock_block(block_head * const first, block32 const blockId)
+{
+    SDL_ASSERT_DEBUG_2(unlock_list(first).find_block(blockId));
+    unlock_list(first).remove(first, blockId);
+    if (first->blockList == block_list_id::hot) {
+        SDL_ASSERT(m_hot_block_count);
+        --m_hot_block_count;
+    }
+}
+
+void page_bpool::access_block(block_head * const first, pageIndex const pageId)
+{
+    if (is_two_queue()) {
+        first->set_access(page_bit(pageId));
     }
-    return unlock_result::false_;
 }
 
 bool page_bpool::can_alloc_block()
 {
-    SDL_ASSERT(m_alloc.capacity() >= info.filesize);
+    SDL_ASSERT(m_alloc.capacity() >= max_pool_size());
     if (max_pool_size() < info.filesize) {
         if (m_free_block_list) {
             return true;
         }
-        const size_t current = m_alloc.used_size();
+        const size_t current = evictable_size();
         if (current >= max_pool_size()) {
-            if (free_unlock_blocks(free_pool_block(current))) {
+            if (const size_t count = free_unlock_blocks(free_pool_block(current))) {
+                m_locked_stats.evict_alloc += count;
                 SDL_ASSERT(m_free_block_list);
                 return true;
             }
@@ -269,11 +408,21 @@ bool page_bpool::can_alloc_block()
     return true;
 }
 
+size_t page_bpool::evictable_size() const
+{
+    const size_t used = m_alloc.used_size();
+    const size_t fixed = m_fixed_block_list.size() * pool_limits::block_size;
+    SDL_ASSERT(fixed <= used);
+    return (fixed < used) ? (used - fixed) : 0;
+}
+
 char * page_bpool::alloc_block()
 {
     if (can_alloc_block()) {
         if (m_free_block_list) { // must reuse free block (memory already allocated)
             const auto p = m_free_block_list.pop_head();
+            SDL_ASSERT(m_free_block_count);
+            --m_free_block_count;
             SDL_ASSERT(p.first && p.second);
             SDL_ASSERT(p.first->d_blockId == p.second);
             A_STATIC_CHECK_TYPE(block_head *, p.first);
@@ -299,17 +448,14 @@ bool page_bpool::page_is_locked(pageIndex const pageId) const
         SDL_ASSERT(0);
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index const & bi = m_block[real_blockId];
+    const block_index bi = m_block[real_blockId].load();
     if (bi.blockId()) { // block is loaded
         if (bi.pageLock()) {
             return true;
         }
-        if (first_block_head(bi.blockId())->is_fixed()) {
-            return true;
-        }
+        return page_is_fixed(pageId);
     }
-    return false;
+    return false; // block is not loaded or reserved to load
 }
 
 bool page_bpool::page_is_fixed(pageIndex const pageId) const
@@ -323,77 +469,217 @@ bool page_bpool::page_is_fixed(pageIndex const pageId) const
         SDL_ASSERT(0);
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index const & bi = m_block[real_blockId];
-    if (bi.blockId()) { // block is loaded
-        if (first_block_head(bi.blockId())->is_fixed()) {
+    if (!m_block[real_blockId].blockId()) {
+        return false;
+    }
+    lock_guard lock(m_mutex); // block cannot be released or moved
+    if (const block32 blockId = m_block[real_blockId].blockId()) { // block is loaded
+        if (first_block_head(blockId)->is_fixed()) {
             return true;
         }
     }
     return false;
 }
 
+void page_bpool::wait_fast_path() const
+{
+    for (block_stripe const & s : m_stripe) {
+        while (s.fast_count.load()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+// Lock page of resident block without mutex.
+// Page locked by other thread(s): pageLockCount is incremented if it is not zero.
+// Unlocked page: page bit is set by CAS on block_index while blockId is unchanged, then pageLockCount
+// is incremented; block stays in unlock list (see block_head::blockList) and is moved to lock list by
+// lock_block_head or eviction. Eviction and defragment take only blocks without page bits (CAS too).
+// Block memory cannot be reused or moved while fast_count is not zero, see wait_fast_path.
 page_head const *
-page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const page_fixed)
+page_bpool::lock_page_fast(uint32 const real_blockId,
+                           pageIndex const pageId,
+                           threadId_mask const threadId)
 {
-    const uint32 real_blockId = page_bpool::realBlock(pageId);
-    if (!real_blockId) { // zero block must be always in memory
-        page_head const * const page = zero_block_page(pageId);
-        SDL_ASSERT(page->valid_checksum());
-        SDL_ASSERT(!get_block_head(real_blockId, pageId)->pageLockThread);
-        return page;
+    SDL_ASSERT(threadId);
+    atomic_block_index & bi = m_block[real_blockId];
+    fast_guard const guard(get_stripe(real_blockId).fast_count);
+    block32 const blockId = bi.blockId();
+    if (!blockId) {
+        return nullptr; // block is not loaded
     }
-    SDL_ASSERT(real_blockId < m_block.size());
-    if (info.last_block < real_blockId) {
-        throw_error_t<block_index>("page not found");
-        return nullptr;
+    char * const block_adr = m_alloc.get_block(blockId);
+    page_head * const page = get_block_page(block_adr, page_bit(pageId));
+    if (threadId->is_page(real_blockId, page_bit(pageId))) { // page is already locked by this thread
+        return page;
     }
-    const auto this_thread = std::this_thread::get_id();
-    const bool is_init = is_init_thread(this_thread);
-    lock_guard lock(m_mutex); // should be improved
-    thread_id_t::pos_mask const thread_index(is_init ? thread_id_t::pos_mask{} :
-        m_thread_id.insert(this_thread));
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId()) { // block is loaded
-        if (page_head const * const page = lock_block_head(bi.blockId(), pageId, 
-            is_init ? nullptr : &thread_index,
-            this_thread, page_fixed, bi.set_lock_page(page_bit(pageId)))) {
-            SDL_ASSERT_DEBUG_2(page->valid_checksum());
-            SDL_ASSERT(bi.pageLock());
-            SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
-            SDL_DEBUG_CPP(block_head const * const test = get_block_head(bi.blockId(), pageId));
-            SDL_ASSERT(first->realBlock == real_blockId);
-            SDL_ASSERT(first->fixedBlock || test->is_lock_thread(thread_index.first.value()));
-            SDL_ASSERT(first->fixedBlock || thread_index.second->is_block(real_blockId));
-            return page;
+    block_head * const head = block_head::get_block_head(page);
+    block_head * const first = first_block_head(block_adr);
+    const block_head::count64 old = head->add_lock_if_locked();
+    if (old) {
+        if (!(old & block_head::fixed_lock)) {
+            threadId->set_page(real_blockId, page_bit(pageId)); // skip it for fixed block
+            if (is_two_queue()) { // re-referenced block must become hot as on slow path
+                first->set_access(page_bit(pageId));
+            }
         }
+        SDL_ASSERT_DEBUG_2(page->valid_checksum());
+        return page;
+    }
+    if (first->read_ahead()) {
+        return nullptr; // first lock of block loaded by read-ahead, see lock_block_head
     }
-    else { // block is NOT loaded
-        if (char * const block_adr = alloc_block()) {
-            read_block_from_file(block_adr, real_blockId);
-            block32 const allocId = m_alloc.get_block_id(block_adr);
-            SDL_ASSERT(m_alloc.get_block(allocId) == block_adr);
-            bi.set_blockId(allocId);
-            bi.set_lock_page(page_bit(pageId));
-            if (page_head const * const page = lock_block_init(allocId, pageId,
-                is_init ? nullptr : &thread_index,
+    if (!bi.try_lock_page(blockId, page_bit(pageId))) {
+        return nullptr; // block was released or moved, or page was locked concurrently
+    }
+    head->add_lock();
+    threadId->set_page(real_blockId, page_bit(pageId));
+    if (is_two_queue()) {
+        first->set_access(page_bit(pageId));
+    }
+    SDL_ASSERT_DEBUG_2(page->valid_checksum());
+    return page;
+}
+
+page_head const *
+page_bpool::lock_page_slow(uint32 const real_blockId,
+                           pageIndex const pageId,
+                           threadId_mask const threadId,
+                           thread_id const this_thread,
+                           fixedf const page_fixed)
+{
+    atomic_block_index & bi = m_block[real_blockId];
+    for (;;) {
+        unique_lock stripe_lock(get_stripe(real_blockId).mutex, std::defer_lock);
+        unique_lock lock(m_mutex, std::defer_lock); // unlocked block can be released
+        lock_mutex(stripe_lock);
+        lock_mutex(lock);
+        if (block32 const blockId = bi.blockId()) { // block is loaded
+            if (page_head const * const page = lock_block_head(bi, blockId, pageId, threadId,
                 this_thread, page_fixed)) {
                 SDL_ASSERT_DEBUG_2(page->valid_checksum());
-                SDL_ASSERT(bi.pageLock());
+                SDL_ASSERT(bi.is_lock_page(page_bit(pageId)));
                 SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
                 SDL_DEBUG_CPP(block_head const * const test = get_block_head(bi.blockId(), pageId));
                 SDL_ASSERT(first->realBlock == real_blockId);
-                SDL_ASSERT(first->fixedBlock || thread_index.second->is_block(real_blockId));
-                SDL_ASSERT(first->fixedBlock || test->is_lock_thread(thread_index.first.value()));
+                SDL_ASSERT(test->lock_count());
+                SDL_ASSERT(first->fixedBlock || threadId->is_page(real_blockId, page_bit(pageId)));
                 return page;
             }
+            break;
+        }
+        if (!bi.try_reserve()) { // block is being loaded by read-ahead
+            stripe_lock.unlock();
+            m_counter.add(pool_counter_t::lock_wait);
+            m_loaded_cv.wait(lock, [&bi](){
+                return !bi.is_reserved();
+            });
+            continue;
+        }
+        // block is NOT loaded
+        m_counter.add(pool_counter_t::lock_miss);
+        char * const block_adr = alloc_block();
+        if (!block_adr) {
+            bi.cancel_reserve();
+            m_loaded_cv.notify_all();
+            break;
+        }
+        lock.unlock();
+        try {
+            read_block_from_file(block_adr, real_blockId); // stripe mutex only
         }
+        catch (...) {
+            lock.lock();
+            bi.cancel_reserve();
+            m_loaded_cv.notify_all();
+            throw;
+        }
+        lock.lock();
+        block32 const allocId = m_alloc.get_block_id(block_adr);
+        SDL_ASSERT(m_alloc.get_block(allocId) == block_adr);
+        page_head const * const page = lock_block_init(allocId, pageId, threadId, this_thread, page_fixed);
+        bi.init_block(allocId, page_bit(pageId));
+        if (first_block_head(block_adr)->is_fixed()) {
+            bi.set_lock_page_all();
+        }
+        else {
+            m_read_ahead.miss(real_blockId);
+        }
+        SDL_ASSERT_DEBUG_2(page->valid_checksum());
+        SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
+        SDL_DEBUG_CPP(block_head const * const test = get_block_head(bi.blockId(), pageId));
+        SDL_ASSERT(first->realBlock == real_blockId);
+        SDL_ASSERT(test->lock_count());
+        SDL_ASSERT(first->fixedBlock || threadId->is_page(real_blockId, page_bit(pageId)));
+        return page;
     }
     SDL_ASSERT(0);
     throw_error_t<block_index>("bad alloc");
     return nullptr;
 }
 
+page_head const *
+page_bpool::lock_page_fixed(pageIndex const pageId, fixedf const page_fixed)
+{
+    return lock_page_thread(pageId, page_fixed, false);
+}
+
+page_head const *
+page_bpool::lock_page_scan(pageIndex const pageId)
+{
+    return lock_page_thread(pageId, fixedf::false_, true);
+}
+
+bool page_bpool::unlock_page_scan(pageIndex const pageId)
+{
+    if (!page_bpool::realBlock(pageId) || is_init_thread(std::this_thread::get_id())) {
+        return false;
+    }
+    threadId_mask const threadId = m_thread_id.find();
+    if (threadId && threadId->release_scan_lock(page_bpool::realBlock(pageId), page_bit(pageId))) {
+        return unlock_page(pageId);
+    }
+    return false;
+}
+
+// scan lock is counted per thread: nested scans over the same page unlock it when the last one leaves;
+// a page locked by lock_page (before or during scans) stays locked until unlock_page or unlock_thread
+page_head const *
+page_bpool::lock_page_thread(pageIndex const pageId, fixedf const page_fixed, bool const scan)
+{
+    m_counter.add(pool_counter_t::lock_page);
+    const uint32 real_blockId = page_bpool::realBlock(pageId);
+    if (!real_blockId) { // zero block must be always in memory
+        page_head const * const page = zero_block_page(pageId);
+        SDL_ASSERT(page->valid_checksum());
+        SDL_ASSERT(!get_block_head(real_blockId, pageId)->lock_count());
+        return page;
+    }
+    SDL_ASSERT(real_blockId < m_block.size());
+    if (info.last_block < real_blockId) {
+        throw_error_t<block_index>("page not found");
+        return nullptr;
+    }
+    const auto this_thread = std::this_thread::get_id();
+    if (is_init_thread(this_thread)) { // init thread always fixes block
+        return lock_page_slow(real_blockId, pageId, nullptr, this_thread, page_fixed);
+    }
+    threadId_mask const threadId = m_thread_id.insert();
+    if (scan) {
+        threadId->add_scan_lock(real_blockId, page_bit(pageId));
+    }
+    else if (threadId->has_scan_lock()) {
+        threadId->hold_scan_lock(real_blockId, page_bit(pageId));
+    }
+    if (!is_fixed(page_fixed)) {
+        if (page_head const * const page = lock_page_fast(real_blockId, pageId, threadId)) {
+            m_counter.add(pool_counter_t::lock_fast);
+            return page;
+        }
+    }
+    return lock_page_slow(real_blockId, pageId, threadId, this_thread, page_fixed);
+}
+
 bool page_bpool::unlock_page(pageIndex const pageId)
 {
     SDL_ASSERT(pageId.value() < info.page_count);
@@ -406,53 +692,41 @@ bool page_bpool::unlock_page(pageIndex const pageId)
         throw_error_t<block_index>("page not found");
         return false;
     }
-    const auto this_thread = std::this_thread::get_id();
-    if (is_init_thread(this_thread)) {
+    if (is_init_thread(std::this_thread::get_id())) {
         return false;
     }
-    lock_guard lock(m_mutex); // should be improved
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId() && bi.is_lock_page(page_bit(pageId))) { // block is loaded and page is locked
-        threadId_mask thread_index = m_thread_id.find(this_thread);
-        if (!thread_index.second) { // thread NOT found
-            SDL_ASSERT(!"thread NOT found");
-            return false;
-        }
-        SDL_DEBUG_CPP(block_head const * const first = first_block_head(bi.blockId()));
-        SDL_DEBUG_CPP(auto const test = get_block_head(bi.blockId(), pageId));
-        SDL_ASSERT(first->fixedBlock || test->pageLockThread);
-        const unlock_result res = unlock_block_head(bi, bi.blockId(), pageId, thread_index.first);
-        if (unlock_result::true_ == res) { // block is NOT used
-            SDL_ASSERT(!bi.pageLock());
-            SDL_ASSERT(!test->is_fixed());
-            SDL_ASSERT(thread_index.second->is_block(real_blockId));
-            thread_index.second->clr_block(real_blockId);
-            SDL_ASSERT(!test->pageLockThread);
-            return true;
-        }
-        // block is used or fixed
-        SDL_ASSERT((res == unlock_result::fixed_) || bi.pageLock());
-        SDL_ASSERT(!test->is_lock_thread(thread_index.first.value()));
-        if (thread_index.second->is_block(real_blockId)) {
-            char * const block_adr = m_alloc.get_block(bi.blockId());
-            const size_t count = info.block_page_count(pageId);
-            for (size_t i = 0; i < count; ++i) { // can this thread release block ?
-                block_head const * const h = get_block_head(block_adr, i);
-                if (h->is_lock_thread(thread_index.first.value())) {
-                    return false;
-                }
-            }
-            thread_index.second->clr_block(real_blockId);
-        }
+    threadId_mask const threadId = m_thread_id.find();
+    if (!threadId) { // thread NOT found
+        SDL_WARNING_DEBUG_2(!"thread NOT found");
+        return false;
     }
-    return false;
+    if (!threadId->is_page(real_blockId, page_bit(pageId))) {
+        return false; // page is not locked by this thread or block is fixed
+    }
+    threadId->clr_page(real_blockId, page_bit(pageId));
+    atomic_block_index & bi = m_block[real_blockId];
+    const block32 blockId = bi.blockId(); // locked block cannot be released or moved
+    SDL_ASSERT(blockId);
+    block_head * const head = get_block_head(m_alloc.get_block(blockId), page_bit(pageId));
+    if (head->release_lock_if_shared()) {
+        return false; // page is locked by other thread(s)
+    }
+    unique_lock stripe_lock(get_stripe(real_blockId).mutex, std::defer_lock);
+    lock_mutex(stripe_lock);
+    SDL_ASSERT(bi.blockId() == blockId);
+    return unlock_block_head(bi, blockId, pageId) == unlock_result::true_; // true if block is NOT used
 }
 
 size_t page_bpool::free_unlocked(decommitf const f) // returns blocks number
 {
     lock_guard lock(m_mutex);
-    const size_t size = free_unlock_blocks(info.block_count);
+    size_t size = 0;
+    while (const size_t count = free_unlock_blocks(info.block_count)) {
+        size += count;
+    }
+    m_locked_stats.evict_explicit += size;
     if (is_decommit(f) && m_free_block_list) {
+        m_free_block_count = 0;
         m_alloc.release(m_free_block_list);
         SDL_ASSERT(!m_free_block_list);
         SDL_ASSERT(!size || m_alloc.can_alloc(size * pool_limits::block_size));
@@ -460,80 +734,59 @@ size_t page_bpool::free_unlocked(decommitf const f) // returns blocks number
     return size;
 }
 
-// mutex already locked
-bool page_bpool::thread_unlock_page(threadIndex const thread_index, pageIndex const pageId)
+bool page_bpool::thread_unlock_block(size_t const real_blockId, uint8 const pages)
 {
-    SDL_ASSERT(!is_init_thread(std::this_thread::get_id()));
-    SDL_ASSERT(pageId.value() < info.page_count);
-    const size_t real_blockId = page_bpool::realBlock(pageId);
-    if (!real_blockId) { // zero block must be always in memory
-        SDL_ASSERT(0);
-        return false;
-    }
+    SDL_ASSERT(real_blockId && pages);
     if (info.last_block < real_blockId) {
         throw_error_t<block_index>("page not found");
         return false;
     }
-    block_index & bi = m_block[real_blockId];
-    if (bi.blockId()) { // block is loaded
-        if (bi.is_lock_page(page_bit(pageId))) {
-            SDL_DEBUG_CPP(auto const test = get_block_head(bi.blockId(), pageId));
-            SDL_ASSERT(test->pageLockThread);
-            const unlock_result result = unlock_block_head(bi, bi.blockId(), pageId, thread_index);
-            if (result == unlock_result::true_) {
-                SDL_ASSERT(!bi.pageLock());
-                SDL_ASSERT(!test->pageLockThread);
-                return true;
-            }
-            else { // block is used or fixed
-                SDL_ASSERT(bi.pageLock());
-                SDL_ASSERT(!test->is_lock_thread(thread_index.value()));
-                return false;
-            }
-        }
-    }
-    return false;
-}
-
-// mutex already locked
-bool page_bpool::thread_unlock_block(threadIndex const thread_index, size_t const blockId) {
+    lock_guard stripe_lock(get_stripe(real_blockId).mutex);
+    atomic_block_index & bi = m_block[real_blockId];
+    const block32 blockId = bi.blockId(); // locked block cannot be released or moved
     SDL_ASSERT(blockId);
-    const size_t count = info.block_page_count(blockId);
-    for (size_t i = 0; i < count; ++i) {
-        pageIndex const pageId = static_cast<page32>(blockId * pool_limits::block_page_num + i);
-        if (thread_unlock_page(thread_index, pageId)) {
-            return true;
+    bool result = false;
+    for (size_t i = 0; i < pool_limits::block_page_num; ++i) {
+        if (pages & (1 << i)) {
+            pageIndex const pageId = static_cast<page32>(real_blockId * pool_limits::block_page_num + i);
+            if (unlock_block_head(bi, blockId, pageId) == unlock_result::true_) {
+                result = true;
+            }
         }
     }
-    return false;
+    return result;
 }
 
+// thread_mask_t is modified only by owner thread, so id must be the calling thread
+// (exit function of thread_id_t is called from exiting thread)
 size_t page_bpool::unlock_thread(thread_id const id, const removef f) 
 {
+    if (id != std::this_thread::get_id()) {
+        SDL_ASSERT(!"unlock_thread of other thread");
+        return 0;
+    }
     if (is_init_thread(id)) {
         SDL_ASSERT(!"unlock_thread");
         return 0;
     }
     SDL_TRACE_IF(trace_enable, "* unlock_thread ", id);
-    lock_guard lock(m_mutex); // should be improved
-    threadId_mask thread_index = m_thread_id.find(id);
-    if (!thread_index.second) { // thread NOT found
+    threadId_mask const threadId = m_thread_id.find(id);
+    if (!threadId) { // thread NOT found
         SDL_WARNING_DEBUG_2(0);
         return 0;
     }
     size_t unlock_count = 0;
-    thread_mask_t & mask = *(thread_index.second);
-    mask.for_each_block([this, &thread_index, &unlock_count](size_t const blockId){
+    threadId->for_each_block([this, &unlock_count](size_t const blockId, uint8 const pages){
         SDL_ASSERT(blockId);
-        if (blockId && thread_unlock_block(thread_index.first, blockId)) {
+        if (blockId && thread_unlock_block(blockId, pages)) {
             ++unlock_count;
         }
     });
     if (is_remove(f)) {
-        m_thread_id.erase(id); // safer
+        m_thread_id.erase(id);
     }
     else {
-        mask.clear();
+        threadId->clear();
     }
     SDL_TRACE_IF(trace_enable, "* unlock_thread ", id, " blocks = ", unlock_count);
     return unlock_count;
@@ -547,22 +800,14 @@ size_t page_bpool::free_unlock_blocks(size_t const block_count)
     }
     SDL_ASSERT(block_count <= info.block_count);
     SDL_ASSERT(m_unlock_block_list.assert_list());
-    block_list_t free_block_list(this);
-    size_t const free_count = m_unlock_block_list.truncate(free_block_list, block_count);
+    size_t free_count = evict_unlock_blocks(m_unlock_block_list, block_count);
+    if (!free_count && m_hot_block_count) { // protected blocks are evicted only if no probationary block
+        free_count = evict_unlock_blocks(m_hot_block_list, a_min(block_count, m_hot_block_count / 4 + 1));
+        m_locked_stats.evict_hot += free_count;
+    }
     if (free_count) {
-        SDL_ASSERT(free_block_list);
-        free_block_list.for_each([this](block_head * const h, block32 const p){
-            SDL_ASSERT(h->realBlock);
-            SDL_ASSERT(!h->is_fixed());
-            SDL_ASSERT(p);
-            block_index & bi = m_block[h->realBlock];
-            SDL_ASSERT(!bi.pageLock());
-            SDL_ASSERT(bi.blockId() == p);
-            bi.clr_blockId(); // must be reused
-            h->realBlock = block_list_t::null;
-            return true;
-        });
-        m_free_block_list.append(std::move(free_block_list));
+        wait_fast_path(); // before block memory is reused
+        m_free_block_count += free_count;
         SDL_ASSERT_DEBUG_2(m_unlock_block_list.assert_list());
         SDL_ASSERT_DEBUG_2(m_free_block_list.assert_list());
         SDL_ASSERT(m_free_block_list);
@@ -570,9 +815,35 @@ size_t page_bpool::free_unlock_blocks(size_t const block_count)
         return free_count;
     }
     SDL_ASSERT(m_unlock_block_list.empty());
+    SDL_ASSERT(m_hot_block_list.empty());
     return 0;
 }
 
+// moves unlocked blocks from tail of list to m_free_block_list; block locked by lock_page_fast
+// since it was unlocked is moved to m_lock_block_list instead
+size_t page_bpool::evict_unlock_blocks(block_list_t & list, size_t const block_count) // m_mutex locked
+{
+    size_t free_count = 0;
+    while ((free_count < block_count) && list) {
+        block32 const blockId = list.tail();
+        block_head * const h = first_block_head(blockId);
+        SDL_ASSERT(h->realBlock);
+        SDL_ASSERT(!h->is_fixed());
+        remove_unlock_block(h, blockId);
+        atomic_block_index & bi = m_block[h->realBlock];
+        SDL_ASSERT(bi.blockId() == blockId);
+        if (bi.try_clr_blockId(blockId)) { // must be reused
+            h->realBlock = block_list_t::null;
+            m_free_block_list.insert(h, blockId);
+            ++free_count;
+        }
+        else {
+            m_lock_block_list.insert(h, blockId);
+        }
+    }
+    return free_count;
+}
+
 #if SDL_DEBUG
 void page_bpool::trace_free_block_list()
 {
@@ -582,35 +853,99 @@ void page_bpool::trace_free_block_list()
 #endif
 
 size_t page_bpool::alloc_used_size() const {
-    lock_guard lock(m_mutex);
     return m_alloc.used_size();
 }
 
 size_t page_bpool::alloc_unused_size() const {
-    lock_guard lock(m_mutex);
     return m_alloc.unused_size();
 }
 
 size_t page_bpool::alloc_free_size() const {
-    lock_guard lock(m_mutex);
-    if (m_free_block_list) {
-        return m_free_block_list.length() * pool_limits::block_size;
-    }
-    return 0;
+    return m_free_block_count * pool_limits::block_size;
 }
 
 size_t page_bpool::alloc_commited_size() const {
-    lock_guard lock(m_mutex);
     return m_alloc.commited_size();
 }
 
+size_t page_bpool::alloc_hugepage_size() const {
+    return m_alloc.hugepage_size();
+}
+
+void page_bpool::lock_mutex(unique_lock & lock) const
+{
+    if (!lock.try_lock()) { // contended
+        using clock_type = std::chrono::steady_clock;
+        const auto start = clock_type::now();
+        if (lock.mutex() == &m_mutex) {
+            ++m_mutex_waiters; // preempts defragment_step
+            lock.lock();
+            --m_mutex_waiters;
+        }
+        else {
+            lock.lock();
+        }
+        const auto d = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start);
+        m_counter.add(pool_counter_t::mutex_wait);
+        m_counter.add(pool_counter_t::mutex_wait_time, static_cast<size_t>(d.count()));
+    }
+}
+
+pool_stats_t page_bpool::stats() const
+{
+    pool_stats_t s;
+    {
+        lock_guard lock(m_mutex);
+        s = m_locked_stats;
+        s.fixed_block = m_fixed_block_list.size();
+        s.fixed_size = s.fixed_block * pool_limits::block_size;
+        s.lock_block = m_lock_block_list.size();
+        s.unlock_block = m_unlock_block_list.size();
+        s.hot_block = m_hot_block_list.size();
+        s.free_block = m_free_block_list.size();
+        s.mixed_arena = m_alloc.mixed_arena_count();
+        s.free_arena = m_alloc.free_arena_count();
+    }
+    s.lock_page = m_counter.get(pool_counter_t::lock_page);
+    s.lock_fast = m_counter.get(pool_counter_t::lock_fast);
+    s.lock_miss = m_counter.get(pool_counter_t::lock_miss);
+    s.lock_wait = m_counter.get(pool_counter_t::lock_wait);
+    s.read_ahead_block = m_counter.get(pool_counter_t::read_ahead_block);
+    s.read_ahead_error = m_counter.get(pool_counter_t::read_ahead_error);
+    s.checksum_page = m_counter.get(pool_counter_t::checksum_page);
+    s.checksum_error = m_counter.get(pool_counter_t::checksum_error);
+    s.warm_block = m_warm_cache.loaded();
+    s.mutex_wait = m_counter.get(pool_counter_t::mutex_wait);
+    s.mutex_wait_time = m_counter.get(pool_counter_t::mutex_wait_time);
+    s.thread = thread_size();
+    s.used_size = alloc_used_size();
+    s.commited_size = alloc_commited_size();
+    s.hugepage_size = alloc_hugepage_size();
+    s.file = file_stats();
+    s.direct_io = direct_io();
+    return s;
+}
+
+vm_hugepage page_bpool::alloc_hugepage(database_cfg const & cfg)
+{
+    switch (cfg.hugepage) {
+    case database_cfg::hugepage_policy::transparent:
+        return vm_hugepage::transparent;
+    case database_cfg::hugepage_policy::hugetlb:
+        return vm_hugepage::hugetlb;
+    default:
+        return vm_hugepage::none;
+    }
+}
+
 void page_bpool::async_release() // called from thread_data
 {
     size_t free_length = 0;
     {
         lock_guard lock(m_mutex);
         if (can_alloc_block() && m_free_block_list) {
-            free_length = a_max(size_t(1), m_free_block_list.length() / 2); // experimental
+            SDL_ASSERT(m_free_block_count == m_free_block_list.length());
+            free_length = a_max(size_t(1), m_free_block_count / 2); // experimental
         }
         else {
             SDL_ASSERT(!m_free_block_list);
@@ -621,7 +956,9 @@ void page_bpool::async_release() // called from thread_data
     if (free_length) {
         lock_guard lock(m_mutex);
         block_list_t list(this);
-        if (m_free_block_list.truncate(list, free_length)) {
+        if (const size_t count = m_free_block_list.truncate(list, free_length)) {
+            SDL_ASSERT(count <= m_free_block_count);
+            m_free_block_count -= count;
             m_alloc.release(list);
             SDL_ASSERT(!list);
         }
@@ -629,54 +966,311 @@ void page_bpool::async_release() // called from thread_data
     SDL_TRACE("~release ", free_length);
 }
 
-bool page_bpool::defragment_nolock() //FIXME: interrupt on event ?
+// One step of incremental defragmentation: moves at most defrag_step_block blocks within defrag_step_time;
+// step is preempted if lock_page waits for m_mutex.
+size_t page_bpool::defragment_step(bool & preempted) // m_mutex locked
 {
+    preempted = false;
+    const size_t old_commited = m_alloc.commited_size();
     if (can_alloc_block() && m_free_block_list) {
+        m_free_block_count = 0;
         m_alloc.release(m_free_block_list);
         SDL_ASSERT(!m_free_block_list);
     }
-    if (!m_unlock_block_list) {
+    ++m_locked_stats.defrag_step;
+    if (!m_unlock_block_list && !m_hot_block_list) {
         SDL_TRACE("!", no_endl());
-        return false; // nothing to defragment
+        return 0; // nothing to defragment
     }
-    SDL_DEBUG_CPP(auto const test_unlock_count = m_unlock_block_list.length());
+    SDL_DEBUG_CPP(auto const test_unlock_count = m_unlock_block_list.length() + m_hot_block_list.length());
+    using clock_type = std::chrono::steady_clock;
+    const auto deadline = clock_type::now() + std::chrono::microseconds(defrag_step_time);
     std::vector<block32> moved_unlock;
-    const bool result =
+    const size_t result =
     m_alloc.defragment([this, &moved_unlock](block32 const from, block32 const to) {
         SDL_ASSERT(from != to);
-        if (m_unlock_block_list.find_block(from)) {
+        if (!from) {
+            return false; // zero block is fixed, see load_zero_block
+        }
+        if (m_unlock_block_list.find_block(from) || m_hot_block_list.find_block(from)) {
             SDL_TRACE_DEBUG_2("defragment: ", from, " -> ", to);
             if (block_head * const first = first_block_head(from)) { // must be allocated block
-                block_index & bi = m_block[first->realBlock];
+                atomic_block_index & bi = m_block[first->realBlock];
                 if (bi.blockId() == from) {
                     SDL_ASSERT(first->d_blockId == from);
-                    if (m_unlock_block_list.remove(first, from)) {
+                    if (!bi.try_reserve_move(from)) {
+                        return false; // locked by lock_page_fast
+                    }
+                    if (unlock_list(first).remove(first, from)) {
                         SDL_DEBUG_CPP(first->d_blockId = to);
                         moved_unlock.push_back(to);
-                        bi.set_blockId(to);
-                        return true;
+                        wait_fast_path(); // before memory is moved
+                        return true; // block is published by init_block_unlocked after it is moved
                     }
                 }
             }
             SDL_ASSERT(0); //return false;
         }
-        SDL_ASSERT(m_lock_block_list.find_block(from) || m_fixed_block_list.find_block(from));
-        return false; // don't move used block
+        return false; // don't move used block or block being loaded from file
+    },
+    [this, &moved_unlock, &preempted, deadline]() {
+        if (m_mutex_waiters.load()) { // foreground lock_page has priority
+            preempted = true;
+            return true;
+        }
+        return (moved_unlock.size() >= defrag_step_block) || (clock_type::now() >= deadline);
     });
-    SDL_ASSERT(result == !moved_unlock.empty());
+    SDL_ASSERT(result == moved_unlock.size());
     if (!moved_unlock.empty()) {
+        m_locked_stats.defrag_moved += moved_unlock.size();
         for (auto const & b : moved_unlock) {
-            m_unlock_block_list.insert(first_block_head(b), b);
+            block_head * const first = first_block_head(b);
+            unlock_list(first).insert(first, b);
+            m_block[first->realBlock].init_block_unlocked(b);
         }
     }    
-    SDL_ASSERT(test_unlock_count == m_unlock_block_list.length());
+    SDL_ASSERT(test_unlock_count == m_unlock_block_list.length() + m_hot_block_list.length());
+    if (preempted) {
+        ++m_locked_stats.defrag_preempt;
+    }
+    const size_t new_commited = m_alloc.commited_size();
+    if (new_commited < old_commited) {
+        m_locked_stats.defrag_released += old_commited - new_commited;
+    }
     return result;
 }
 
+// pool mutex is released between steps, so readers wait for one step at most
+bool page_bpool::defragment(std::atomic_bool const & cancel)
+{
+    size_t moved_count = 0;
+    size_t preempt_count = 0;
+    {
+        lock_guard lock(m_mutex);
+        ++m_locked_stats.defrag_run;
+    }
+    while (!cancel) {
+        bool preempted = false;
+        size_t moved = 0;
+        {
+            lock_guard lock(m_mutex);
+            moved = defragment_step(preempted);
+        }
+        moved_count += moved;
+        if (moved_count >= info.block_count) { // each block is moved at most once per pass (expected)
+            break;
+        }
+        if (preempted) {
+            if (++preempt_count > defrag_max_preempt) {
+                break; // pool is busy, continue on next pass
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        else if (moved) {
+            std::this_thread::yield();
+        }
+        else {
+            break; // nothing to move
+        }
+    }
+    return moved_count > 0;
+}
+
 bool page_bpool::defragment()
 {
+    std::atomic_bool const cancel(false);
+    return defragment(cancel);
+}
+
+size_t page_bpool::read_ahead_window(database_cfg const & cfg) const
+{
+    if (cfg.read_ahead) { // read-ahead must not evict blocks of the same scan
+        const size_t max_window = max_pool_size() / pool_limits::block_size / 4;
+        return a_min(cfg.read_ahead, max_window);
+    }
+    return 0;
+}
+
+bool page_bpool::can_read_ahead() const
+{
+    if (m_free_block_list) {
+        return true;
+    }
+    if (evictable_size() + pool_limits::block_size <= max_pool_size()) {
+        return m_alloc.can_alloc(pool_limits::block_size);
+    }
+    return false;
+}
+
+// load blocks without page lock by one vectored request; blocks are inserted into m_unlock_block_list;
+// if request fails, reservations are cancelled and 0 is returned, so blocks are loaded later by lock_page
+size_t page_bpool::read_ahead_blocks(uint32 const * const blocks, size_t const count, block32 const mark)
+{
+    SDL_ASSERT(blocks && count);
+    std::vector<read_request> req;
+    req.reserve(count);
+    {
+        lock_guard lock(m_mutex);
+        for (size_t i = 0; i < count; ++i) {
+            uint32 const real_blockId = blocks[i];
+            SDL_ASSERT(real_blockId && (real_blockId < m_block.size()));
+            if (!can_read_ahead()) {
+                break;
+            }
+            if (m_block[real_blockId].try_reserve()) { // block is not loaded
+                if (char * const block_adr = alloc_block()) {
+                    req.push_back({ block_adr, 
+                        size_t(real_blockId) * pool_limits::block_size, 
+                        info.block_size_in_bytes(real_blockId) });
+                }
+                else {
+                    m_block[real_blockId].cancel_reserve();
+                    m_loaded_cv.notify_all();
+                    break;
+                }
+            }
+        }
+    }
+    if (req.empty()) {
+        return 0;
+    }
+    uint32 const mark_blockId = static_cast<uint32>(req[0].offset / pool_limits::block_size); // first block in order of stream
+    std::sort(req.begin(), req.end(), [](read_request const & x, read_request const & y){
+        return x.offset < y.offset; // adjacent blocks are merged
+    });
+    bool ok = false;
+    try {
+        m_file.read(req.data(), req.size()); // without mutex
+        for (read_request const & r : req) {
+            verify_block(r.dest, r.offset / pool_limits::block_size);
+        }
+        ok = true;
+    }
+    catch (std::exception & e) {
+        SDL_TRACE("read_ahead failed = ", e.what()); // not fatal, see read_ahead_error
+    }
+    {
+        lock_guard lock(m_mutex);
+        for (read_request const & r : req) {
+            uint32 const real_blockId = static_cast<uint32>(r.offset / pool_limits::block_size);
+            atomic_block_index & bi = m_block[real_blockId];
+            block32 const allocId = m_alloc.get_block_id(r.dest);
+            SDL_ASSERT(m_alloc.get_block(allocId) == r.dest);
+            block_head * const first = init_block_head(r.dest, allocId, real_blockId);
+            if (ok) {
+                first->readAhead = (real_blockId == mark_blockId) ? mark : 0;
+                m_unlock_block_list.insert(first, allocId);
+                bi.init_block_unlocked(allocId); // publish unlocked block
+            }
+            else { // block memory is reused
+                first->realBlock = block_list_t::null;
+                m_free_block_list.insert(first, allocId);
+                ++m_free_block_count;
+                bi.cancel_reserve();
+            }
+        }
+    }
+    m_loaded_cv.notify_all();
+    if (!ok) {
+        m_counter.add(pool_counter_t::read_ahead_error);
+        return 0;
+    }
+    m_counter.add(pool_counter_t::read_ahead_block, req.size());
+    return req.size();
+}
+
+bool page_bpool::need_verify(size_t const real_blockId)
+{
+    switch (m_checksum) {
+    case database_cfg::checksum_policy::always:
+        return true;
+    case database_cfg::checksum_policy::first_load:
+        {
+            SDL_ASSERT((real_blockId / 32) < m_block_verified.size());
+            const uint32 bit = uint32(1) << (real_blockId % 32);
+            return !(m_block_verified[real_blockId / 32].fetch_or(bit) & bit);
+        }
+    default:
+        return false;
+    }
+}
+
+void page_bpool::verify_block(char const * const block_adr, size_t const real_blockId)
+{
+    if (!need_verify(real_blockId)) {
+        return;
+    }
+    const size_t page_count = info.block_page_count(real_blockId);
+    for (size_t i = 0; i < page_count; ++i) {
+        page_head const * const page = reinterpret_cast<page_head const *>(block_adr + page_head::page_size * i);
+        if (page->data.tornBits && (page_head::checksum(page) != page->data.tornBits)) {
+            const pageIndex pageId(static_cast<uint32>(real_blockId * pool_limits::block_page_num + i));
+            SDL_TRACE("bad checksum at page ", pageId.value());
+            m_counter.add(pool_counter_t::checksum_error);
+            lock_guard lock(m_checksum_mutex);
+            if (m_checksum_error.size() < max_checksum_error) {
+                m_checksum_error.push_back(pageId);
+            }
+        }
+    }
+    m_counter.add(pool_counter_t::checksum_page, page_count);
+}
+
+std::vector<pageIndex> page_bpool::checksum_error_pages() const
+{
+    lock_guard lock(m_checksum_mutex);
+    return m_checksum_error;
+}
+
+size_t page_bpool::prewarm_blocks(uint32 const * const blocks, size_t const count, bool & full)
+{
+    const size_t loaded = read_ahead_blocks(blocks, count, 0);
     lock_guard lock(m_mutex);
-    return defragment_nolock();
+    full = !can_read_ahead();
+    return loaded;
+}
+
+std::vector<page_bpool::block32>
+page_bpool::resident_blocks() const
+{
+    std::vector<block32> blocks;
+    lock_guard lock(m_mutex);
+    blocks.reserve(m_hot_block_list.size() + m_lock_block_list.size() + 
+        m_unlock_block_list.size() + m_fixed_block_list.size());
+    auto const push_back = [&blocks](block_head * const h, block32) {
+        SDL_ASSERT(h->realBlock);
+        blocks.push_back(h->realBlock);
+        return bc::continue_;
+    };
+    // each list is ordered by recency (most recently used first)
+    m_hot_block_list.for_each(push_back);
+    m_lock_block_list.for_each(push_back);
+    m_unlock_block_list.for_each(push_back);
+    m_fixed_block_list.for_each(push_back);
+    return blocks;
+}
+
+void page_bpool::save_warm_cache(std::string const & fname) const
+{
+    warm_cache_t::save(fname, info.filesize, resident_blocks());
+}
+
+void page_bpool::read_ahead(std::vector<pageIndex> const & pages)
+{
+    if (!m_read_ahead) {
+        return;
+    }
+    std::vector<block32> blocks;
+    blocks.reserve(pages.size());
+    for (pageIndex const & p : pages) {
+        const uint32 real_blockId = page_bpool::realBlock(p);
+        if (real_blockId && (real_blockId <= info.last_block)) { // zero block is always in memory
+            if (blocks.empty() || (blocks.back() != real_blockId)) {
+                blocks.push_back(real_blockId);
+            }
+        }
+    }
+    m_read_ahead.hint(std::move(blocks));
 }
 
 //---------------------------------------------------
@@ -738,7 +1332,7 @@ void page_bpool::thread_data::run_thread()
                     defrag_timeout += m_period;
                     if (defrag_timeout >= m_defrag_period) {
                         defrag_timeout = 0;
-                        m_parent.defragment(); //FIXME: interrupt on event ?
+                        m_parent.defragment(m_shutdown);
                     }
                 }
             }
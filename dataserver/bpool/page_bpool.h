@@ -7,6 +7,9 @@
 #include "dataserver/bpool/file.h"
 #include "dataserver/bpool/thread_id.h"
 #include "dataserver/bpool/block_list.h"
+#include "dataserver/bpool/read_ahead.h"
+#include "dataserver/bpool/pool_stats.h"
+#include "dataserver/bpool/warm_cache.h"
 #include "dataserver/bpool/flag_type.h"
 #include "dataserver/common/thread.h"
 #include "dataserver/common/algorithm.h"
@@ -53,15 +56,21 @@ struct pool_info_t final {
 
 class page_bpool_file {
 protected:
-    explicit page_bpool_file(const std::string & fname);
+    page_bpool_file(const std::string & fname, bool direct_io);
     ~page_bpool_file(){}
 public:
     static bool valid_filesize(size_t);
     size_t filesize() const { 
         return m_file.filesize();
     }
+    bool direct_io() const { // file is read bypassing OS cache, see database_cfg::direct_io
+        return m_file.direct_io();
+    }
+    file_stats_t::value_type file_stats() const {
+        return m_file.stats();
+    }
 protected:
-    PagePoolFile m_file;
+    PagePoolFile m_file; // thread-safe
 };
 
 class base_page_bpool : public page_bpool_file {
@@ -69,6 +78,7 @@ protected:
     base_page_bpool(const std::string & fname, database_cfg const &);
     ~base_page_bpool(){}
     size_t free_pool_block(size_t) const;
+    size_t alloc_capacity() const; // address space of pool memory
     const pool_info_t info;
     size_t min_pool_size() const { return m_min_pool_size; }
     size_t max_pool_size() const { return m_max_pool_size; }
@@ -92,6 +102,12 @@ public:
     const thread_id init_thread_id;
     page_bpool(const std::string & fname, database_cfg const &);
     ~page_bpool();
+    class fixed_scope : noncopyable { // pages locked by this thread are fixed in memory as if by init thread
+        page_bpool const * const m_prev;
+    public:
+        explicit fixed_scope(page_bpool const *); // nullptr: no effect
+        ~fixed_scope();
+    };
 public:
     static bool is_zero_block(pageIndex);
     bool is_open() const;
@@ -99,14 +115,21 @@ public:
     page_head const * lock_page(pageIndex);
     bool unlock_page(pageIndex);
     page_head const * lock_page_fixed(pageIndex, fixedf);
+    page_head const * lock_page_scan(pageIndex); // counted lock, page is unlocked by last unlock_page_scan
+    bool unlock_page_scan(pageIndex); // never unlocks page which is also locked by lock_page
     bool page_is_locked(pageIndex) const;
     bool page_is_fixed(pageIndex) const;
-    bool defragment();
+    bool defragment(); // incremental, pool mutex is released between steps
+    void read_ahead(std::vector<pageIndex> const &); // hint: pages will be read in this order
+    size_t read_ahead_window() const { // in blocks
+        return m_read_ahead.window();
+    }
     size_t thread_size() const {
         return m_thread_id.size();
     }
+    using page_bpool_file::file_stats;
 public:
-    size_t unlock_thread(thread_id, removef);
+    size_t unlock_thread(thread_id, removef); // thread_id must be current thread
     size_t unlock_thread(removef);
     size_t free_unlocked(decommitf); // returns blocks number
 public:
@@ -114,18 +137,25 @@ public:
     size_t alloc_unused_size() const;
     size_t alloc_free_size() const;
     size_t alloc_commited_size() const;
+    size_t alloc_hugepage_size() const; // commited memory backed by huge pages
+    pool_stats_t stats() const;
+    void save_warm_cache(std::string const &) const; // resident blocks, hottest first
+    std::vector<pageIndex> checksum_error_pages() const; // pages with bad checksum found on load
 private:
     enum class unlock_result { false_, true_, fixed_ };
-    using threadId_mask = thread_id_t::pos_mask;
+    using threadId_mask = thread_id_t::mask_ptr;
+    static thread_local page_bpool const * t_fixed_scope; // see fixed_scope
     bool is_init_thread(thread_id const & id) const {
-        return this->init_thread_id == id;
+        return (this->init_thread_id == id) || 
+            ((t_fixed_scope == this) && (std::this_thread::get_id() == id));
     }
-    bool thread_unlock_page(threadIndex, pageIndex); // called from unlock_thread
-    bool thread_unlock_block(threadIndex, size_t); // called from unlock_thread
+    bool thread_unlock_block(size_t, uint8); // called from unlock_thread
     static pageIndex block_pageIndex(pageIndex);
     static pageIndex block_pageIndex(pageIndex, size_t);
     void load_zero_block();
     void read_block_from_file(char * block_adr, size_t);
+    bool need_verify(size_t); // see database_cfg::checksum
+    void verify_block(char const * block_adr, size_t); // called after block is read from file
     static uint32 realBlock(pageIndex); // file block 
     block_head const * get_block_head(block32, pageIndex) const;
     static page_head * get_block_page(char * block_adr, size_t);
@@ -133,11 +163,31 @@ private:
     static block_head * first_block_head(char * block_adr);
     block_head * first_block_head(block32) const;
     page_head const * zero_block_page(pageIndex);
-    page_head const * lock_block_init(block32, pageIndex, threadId_mask const *, thread_id, fixedf); // block is loaded from file
-    page_head const * lock_block_head(block32, pageIndex, threadId_mask const *, thread_id, fixedf, uint8); // block was loaded before
-    unlock_result unlock_block_head(block_index &, block32, pageIndex, threadIndex);
+    page_head const * lock_page_thread(pageIndex, fixedf, bool scan);
+    page_head const * lock_page_fast(uint32, pageIndex, threadId_mask); // without mutex
+    page_head const * lock_page_slow(uint32, pageIndex, threadId_mask, thread_id, fixedf);
+    page_head const * lock_block_init(block32, pageIndex, threadId_mask, thread_id, fixedf); // block is loaded from file
+    page_head const * lock_block_head(atomic_block_index &, block32, pageIndex, threadId_mask, thread_id, fixedf); // block was loaded before
+    void set_block_fixed(char * block_adr, size_t); // lock all pages of block in memory
+    block_head * init_block_head(char * block_adr, block32, uint32 realBlock); // clear/init block_head for all pages
+    size_t read_ahead_window(database_cfg const &) const;
+    bool can_read_ahead() const; // block can be allocated without eviction
+    size_t read_ahead_blocks(uint32 const *, size_t, block32 mark); // called from read_ahead_t, returns number of loaded blocks
+    size_t prewarm_blocks(uint32 const *, size_t, bool & full); // called from warm_cache_t, returns number of loaded blocks
+    std::vector<block32> resident_blocks() const; // real blocks, hottest first
+    unlock_result unlock_block_head(atomic_block_index &, block32, pageIndex);
     size_t free_unlock_blocks(size_t); // returns number of free blocks
-    uint32 pageAccessTime() const;
+    size_t evict_unlock_blocks(block_list_t &, size_t); // m_mutex locked, returns number of free blocks
+    bool is_two_queue() const {
+        return m_replacement == database_cfg::replacement_policy::two_queue;
+    }
+    static size_t hot_block_max(database_cfg const &, size_t max_pool_size);
+    static vm_hugepage alloc_hugepage(database_cfg const &);
+    block_list_t & unlock_list(block_head const *); // list of unlocked block
+    void insert_unlock_block(block_head *, block32); // m_mutex locked
+    void remove_unlock_block(block_head *, block32); // m_mutex locked
+    void access_block(block_head *, pageIndex); // marks re-referenced block, lock_page_fast uses block_head::set_access
+    size_t evictable_size() const; // m_mutex locked, used memory except fixed blocks
     bool can_alloc_block();
     char * alloc_block();
 #if SDL_DEBUG
@@ -145,20 +195,66 @@ private:
     void trace_block(const char *, block32, pageIndex);
 #endif
     void async_release(); // called from thread_data
-    bool defragment_nolock();
+    enum { defrag_step_block = 16 }; // blocks moved per step
+    enum { defrag_step_time = 1000 }; // microseconds per step
+    enum { defrag_max_preempt = 1000 }; // preempted steps per pass
+    size_t defragment_step(bool & preempted); // m_mutex locked, returns number of moved blocks
+    bool defragment(std::atomic_bool const & cancel); // called from thread_data
+private:
+    enum { stripe_num = 64 }; // power of 2
+    class block_stripe : noncopyable { // guards load/unlock of blocks: realBlock % stripe_num
+        enum { cache_line = 64 };
+        enum { data_size = sizeof(std::mutex) + sizeof(std::atomic<int>) };
+    public:
+        std::mutex mutex;
+        std::atomic<int> fast_count; // lock_page_fast in progress
+        block_stripe(): fast_count(0) {}
+    private:
+        char padding[cache_line - data_size % cache_line];
+    };
+    class fast_guard : noncopyable {
+        std::atomic<int> & m_count;
+    public:
+        explicit fast_guard(std::atomic<int> & c): m_count(c) {
+            ++m_count;
+        }
+        ~fast_guard() {
+            --m_count;
+        }
+    };
+    block_stripe & get_stripe(size_t const realBlock) const {
+        return m_stripe[realBlock & (stripe_num - 1)];
+    }
+    void wait_fast_path() const; // called before block memory is reused or moved
 private:
     friend page_bpool_friend; // for first_block_head
     using lock_guard = std::lock_guard<std::mutex>;
-    mutable std::mutex m_mutex; // should be improved
-    mutable uint32 m_pageAccessTime = 0;
+    using unique_lock = std::unique_lock<std::mutex>;
+    void lock_mutex(unique_lock &) const; // counts wait time of contended mutex
+    mutable std::mutex m_mutex; // guards block lists and allocator
+    mutable std::atomic<int> m_mutex_waiters; // lock_page waiting for m_mutex
+    std::condition_variable m_loaded_cv; // notified when reserved block is loaded
+    mutable array_t<block_stripe, stripe_num> m_stripe;
     char * m_zero_block_address = nullptr;
-    std::vector<block_index> m_block;
+    block_index_map m_block; // file blocks
     thread_id_t m_thread_id;
     page_bpool_alloc m_alloc;
     block_list_t m_lock_block_list;
-    block_list_t m_unlock_block_list;
+    block_list_t m_unlock_block_list; // probationary blocks if two_queue
+    block_list_t m_hot_block_list; // protected (re-referenced) blocks if two_queue
     block_list_t m_free_block_list;
     block_list_t m_fixed_block_list;
+    std::atomic<size_t> m_free_block_count; // length of m_free_block_list
+    size_t m_hot_block_count = 0; // length of m_hot_block_list
+    const size_t m_hot_block_max;
+    const database_cfg::replacement_policy m_replacement;
+    pool_stats_t m_locked_stats; // evict/defragment counters guarded by m_mutex
+    mutable pool_counter_t m_counter;
+    const database_cfg::checksum_policy m_checksum;
+    std::vector<std::atomic<uint32>> m_block_verified; // 1 bit per file block if checksum_policy::first_load
+    mutable std::mutex m_checksum_mutex;
+    std::vector<pageIndex> m_checksum_error; // guarded by m_checksum_mutex
+    enum { max_checksum_error = 1024 };
 private:
     enum { trace_enable = 0 };
     class thread_data {
@@ -181,6 +277,9 @@ private:
     };
     thread_data m_td;
     friend thread_data;
+    read_ahead_t m_read_ahead;
+    const std::string m_warm_cache_file;
+    warm_cache_t m_warm_cache; // destroyed first
 };
 
 inline page_head const *
@@ -78,14 +78,7 @@ page_bpool::zero_block_page(pageIndex const pageId) {
 
 inline void page_bpool::read_block_from_file(char * const block_adr, size_t const blockId) {
      m_file.read(block_adr, blockId * pool_limits::block_size, info.block_size_in_bytes(blockId)); 
-}
-
-inline uint32 page_bpool::pageAccessTime() const {
-#if 0
-    return unix_time();
-#else
-    return ++m_pageAccessTime;
-#endif
+     verify_block(block_adr, blockId);
 }
 
 //----------------------------------------------------------------
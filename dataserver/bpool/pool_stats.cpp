@@ -0,0 +1,52 @@
+// pool_stats.cpp
+//
+#include "dataserver/bpool/pool_stats.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+pool_counter_t::pool_counter_t()
+{
+    for (slot_type & s : m_slot) {
+        for (auto & v : s.value) {
+            v = 0;
+        }
+    }
+}
+
+size_t pool_counter_t::slot_index()
+{
+    static std::atomic<size_t> next_slot(0);
+    static thread_local size_t const index = next_slot++ & (slot_num - 1);
+    return index;
+}
+
+size_t pool_counter_t::get(type const t) const
+{
+    SDL_ASSERT(t < _end);
+    size_t result = 0;
+    for (slot_type const & s : m_slot) {
+        result += s.value[t].load(std::memory_order_relaxed);
+    }
+    return result;
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            SDL_ASSERT(file_stats_t::hist_index(0) == 0);
+            SDL_ASSERT(file_stats_t::hist_index(1) == 1);
+            SDL_ASSERT(file_stats_t::hist_index(3) == 2);
+            SDL_ASSERT(file_stats_t::hist_index(size_t(1) << 40) == file_stats_t::hist_size - 1);
+            pool_counter_t test;
+            test.add(pool_counter_t::lock_page);
+            test.add(pool_counter_t::lock_page, 2);
+            SDL_ASSERT(test.get(pool_counter_t::lock_page) == 3);
+            SDL_ASSERT(test.get(pool_counter_t::lock_miss) == 0);
+        }
+    };
+    static unit_test s_test;
+}
+#endif //#if SDL_DEBUG
+}}} // sdl
@@ -0,0 +1,94 @@
+// pool_stats.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_POOL_STATS_H__
+#define __SDL_BPOOL_POOL_STATS_H__
+
+#include "dataserver/bpool/file.h"
+#include "dataserver/common/array.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+struct pool_stats_t { // snapshot of page_bpool statistics
+    size_t lock_page = 0;           // lock_page calls
+    size_t lock_fast = 0;           // pages locked without mutex
+    size_t lock_miss = 0;           // blocks loaded from file by lock_page
+    size_t lock_wait = 0;           // waits for block being loaded by read-ahead
+    size_t read_ahead_block = 0;    // blocks loaded by read-ahead or prewarm
+    size_t read_ahead_error = 0;    // failed reads of read-ahead or prewarm, blocks are left for lock_page
+    size_t checksum_page = 0;       // pages verified on load (database_cfg::checksum)
+    size_t checksum_error = 0;      // pages with bad checksum
+    size_t warm_block = 0;          // blocks of warm cache loaded by prewarm
+    size_t mutex_wait = 0;          // contended locks of pool mutex
+    size_t mutex_wait_time = 0;     // microseconds
+    size_t evict_alloc = 0;         // unlocked blocks freed to allocate block
+    size_t evict_explicit = 0;      // unlocked blocks freed by free_unlocked
+    size_t evict_hot = 0;           // protected blocks freed (two_queue)
+    size_t demote_hot = 0;          // protected blocks moved to probationary list (two_queue)
+    size_t defrag_run = 0;          // defragment passes
+    size_t defrag_step = 0;         // bounded steps of defragment
+    size_t defrag_preempt = 0;      // steps interrupted by lock_page waiters
+    size_t defrag_moved = 0;        // blocks moved by defragment
+    size_t defrag_released = 0;     // commited memory (bytes) released by defragment
+    size_t mixed_arena = 0;         // partially used arenas (fragmentation)
+    size_t free_arena = 0;          // released arenas
+    size_t fixed_block = 0;         // length of block lists
+    size_t lock_block = 0;
+    size_t unlock_block = 0;        // can include blocks locked by lock_page_fast
+    size_t hot_block = 0;
+    size_t free_block = 0;
+    size_t thread = 0;              // registered threads
+    size_t used_size = 0;           // memory in bytes
+    size_t commited_size = 0;
+    size_t hugepage_size = 0;
+    size_t fixed_size = 0;          // pinned memory, not counted in max_memory budget
+    bool direct_io = false;         // file is read bypassing OS page cache
+    file_stats_t::value_type file;
+    size_t lock_hit() const {
+        SDL_ASSERT(lock_miss <= lock_page);
+        return lock_page - lock_miss;
+    }
+    double hit_ratio() const {
+        return lock_page ? double(lock_hit()) / lock_page : 0.0;
+    }
+};
+
+// Per-thread counters aggregated on demand: each thread increments its own cache line (relaxed), 
+// so counters can be left enabled on hot path.
+class pool_counter_t : noncopyable {
+public:
+    enum type {
+        lock_page,
+        lock_fast,
+        lock_miss,
+        lock_wait,
+        read_ahead_block,
+        read_ahead_error,
+        checksum_page,
+        checksum_error,
+        mutex_wait,
+        mutex_wait_time,
+        _end
+    };
+    pool_counter_t();
+    void add(type const t, size_t const value = 1) {
+        m_slot[slot_index()].value[t].fetch_add(value, std::memory_order_relaxed);
+    }
+    size_t get(type) const;
+private:
+    enum { slot_num = 64 }; // power of 2
+    static size_t slot_index(); // slot of current thread
+    class slot_type : noncopyable {
+        enum { cache_line = 64 };
+        enum { data_size = sizeof(std::atomic<size_t>) * _end };
+    public:
+        std::atomic<size_t> value[_end];
+    private:
+        char padding[cache_line - data_size % cache_line];
+    };
+    array_t<slot_type, slot_num> m_slot;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_POOL_STATS_H__
@@ -0,0 +1,195 @@
+// read_ahead.cpp
+//
+#include "dataserver/bpool/read_ahead.h"
+
+namespace sdl { namespace db { namespace bpool {
+
+read_ahead_t::read_ahead_t(size_t const block_count, size_t const window, load_fun && f)
+    : m_block_count(block_count)
+    , m_window(window)
+    , m_load(std::move(f))
+{
+    SDL_ASSERT(m_block_count);
+    SDL_ASSERT(m_load);
+}
+
+read_ahead_t::~read_ahead_t()
+{
+    if (m_thread) {
+        shutdown();
+        m_thread.reset(); // join
+    }
+}
+
+void read_ahead_t::launch()
+{
+    SDL_ASSERT(!m_thread);
+    if (m_window) {
+        m_thread.reset(new joinable_thread([this](){
+            this->run_thread();
+        }));
+    }
+}
+
+void read_ahead_t::shutdown()
+{
+    {
+        lock_guard lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_one();
+}
+
+size_t read_ahead_t::find_stream(block32 const realBlock) const
+{
+    for (size_t i = 0; i < stream_num; ++i) {
+        stream_type const & s = m_stream[i];
+        if (!s.is_order() && s.last) {
+            if ((realBlock > s.last) && (realBlock <= s.last + 2)) { // allow one skipped block
+                return i;
+            }
+            if ((realBlock > s.last) && (realBlock < s.next)) { // scan overtook read-ahead
+                return i;
+            }
+        }
+    }
+    return stream_num;
+}
+
+size_t read_ahead_t::new_stream()
+{
+    const size_t i = m_victim;
+    m_victim = (m_victim + 1) % stream_num;
+    m_stream[i] = stream_type();
+    return i;
+}
+
+void read_ahead_t::push(size_t const i)
+{
+    SDL_ASSERT(i < stream_num);
+    stream_type & s = m_stream[i];
+    if (!s.pending) {
+        s.pending = true;
+        m_queue.push_back(i);
+        m_cv.notify_one();
+    }
+}
+
+void read_ahead_t::miss(block32 const realBlock)
+{
+    if (!m_window) {
+        return;
+    }
+    lock_guard lock(m_mutex);
+    const size_t i = find_stream(realBlock);
+    if (i < stream_num) {
+        stream_type & s = m_stream[i];
+        s.last = realBlock;
+        if (++s.hits >= 2) { // third sequential block
+            s.next = a_max(s.next, static_cast<block32>(realBlock + 1));
+            push(i);
+        }
+    }
+    else {
+        stream_type & s = m_stream[new_stream()];
+        s.last = realBlock;
+        s.next = realBlock + 1;
+    }
+}
+
+void read_ahead_t::trigger(block32 const mark, block32 const realBlock)
+{
+    SDL_ASSERT(m_window);
+    lock_guard lock(m_mutex);
+    const size_t i = stream_index(mark);
+    stream_type & s = m_stream[i];
+    if (s.is_order() || (realBlock >= s.last)) {
+        s.last = realBlock;
+        push(i);
+    }
+}
+
+void read_ahead_t::hint(std::vector<block32> && order)
+{
+    if (!m_window || order.empty()) {
+        return;
+    }
+    lock_guard lock(m_mutex);
+    const size_t i = new_stream();
+    m_stream[i].order = std::move(order);
+    push(i);
+}
+
+size_t read_ahead_t::next_window(std::vector<block32> & blocks)
+{
+    SDL_ASSERT(!m_queue.empty());
+    SDL_ASSERT(blocks.empty());
+    const size_t i = m_queue.front();
+    m_queue.pop_front();
+    stream_type & s = m_stream[i];
+    s.pending = false;
+    if (s.is_order()) {
+        const size_t end = a_min(s.pos + m_window, s.order.size());
+        for (; s.pos < end; ++s.pos) {
+            const block32 b = s.order[s.pos];
+            if (b && (b < m_block_count)) {
+                blocks.push_back(b);
+            }
+        }
+    }
+    else if (s.next && (s.next < s.last + 2 * m_window)) { // do not go too far from scan
+        const size_t end = a_min(size_t(s.next) + m_window, m_block_count);
+        for (; s.next < end; ++s.next) {
+            blocks.push_back(s.next);
+        }
+    }
+    return i;
+}
+
+void read_ahead_t::window_done(size_t const i, bool const loaded)
+{
+    lock_guard lock(m_mutex);
+    stream_type & s = m_stream[i];
+    if (loaded) {
+        s.skip = 0;
+    }
+    else if (s.skip++ < max_skip_window) { // window is resident, no block is marked
+        push(i);
+    }
+    else {
+        s.skip = 0;
+    }
+}
+
+// failed window is dropped (its blocks are loaded later by lock_page), thread keeps serving other streams
+void read_ahead_t::run_thread()
+{
+    std::vector<block32> blocks;
+    blocks.reserve(m_window);
+    while (true) {
+        size_t i = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]{
+                return m_shutdown || !m_queue.empty();
+            });
+            if (m_shutdown) {
+                break;
+            }
+            i = next_window(blocks);
+        }
+        if (!blocks.empty()) {
+            size_t loaded = 0;
+            try {
+                loaded = m_load(blocks.data(), blocks.size(), make_mark(i)); // first loaded block is marked
+            }
+            catch (std::exception & e) {
+                SDL_TRACE_ERROR("read_ahead error = ", e.what());
+            }
+            window_done(i, loaded != 0);
+            blocks.clear();
+        }
+    }
+}
+
+}}} // sdl
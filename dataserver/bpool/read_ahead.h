@@ -0,0 +1,81 @@
+// read_ahead.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_READ_AHEAD_H__
+#define __SDL_BPOOL_READ_AHEAD_H__
+
+#include "dataserver/bpool/block_head.h"
+#include "dataserver/common/thread.h"
+#include "dataserver/common/array.h"
+#include <functional>
+#include <condition_variable>
+#include <deque>
+
+namespace sdl { namespace db { namespace bpool {
+
+// Loads blocks ahead of sequential scans on background thread.
+// Stream is detected by sequential misses of blocks or given explicitly as block order (e.g. IAM extents).
+// Blocks of window are read by one vectored request. First block of each loaded window is marked in block_head::readAhead; first lock of marked block
+// calls trigger() to load next window, so scan cursor finds blocks resident.
+class read_ahead_t : noncopyable {
+    using block32 = block_index::block32;
+public:
+    enum { stream_num = 64 }; // max number of concurrent streams
+    enum { max_skip_window = 4 }; // number of resident windows skipped at once
+    using load_fun = std::function<size_t(block32 const * realBlock, size_t count, block32 mark)>; // returns number of loaded blocks
+    read_ahead_t(size_t block_count, size_t window, load_fun &&);
+    ~read_ahead_t();
+    size_t window() const {
+        return m_window;
+    }
+    explicit operator bool() const {
+        return m_window != 0;
+    }
+    void launch();
+    void miss(block32 realBlock); // block is loaded synchronously
+    void trigger(block32 mark, block32 realBlock); // marked block is locked first time
+    void hint(std::vector<block32> &&); // blocks in order of access
+private:
+    struct stream_type {
+        block32 last = 0; // last block used by scan
+        block32 next = 0; // next block to load
+        size_t hits = 0; // number of sequential misses
+        size_t pos = 0; // next position in order
+        std::vector<block32> order; // explicit order of blocks
+        size_t skip = 0; // number of skipped resident windows
+        bool pending = false; // queued for background thread
+        bool is_order() const {
+            return !order.empty();
+        }
+    };
+    using lock_guard = std::lock_guard<std::mutex>;
+    static block32 make_mark(size_t const i) {
+        return static_cast<block32>(i + 1);
+    }
+    static size_t stream_index(block32 const mark) {
+        SDL_ASSERT(mark && (mark <= stream_num));
+        return mark - 1;
+    }
+    size_t find_stream(block32) const; // m_mutex locked, returns stream_num if not found
+    size_t new_stream(); // m_mutex locked
+    void push(size_t); // m_mutex locked
+    size_t next_window(std::vector<block32> &); // m_mutex locked, returns stream index
+    void window_done(size_t, bool loaded);
+    void run_thread();
+    void shutdown();
+private:
+    const size_t m_block_count;
+    const size_t m_window; // in blocks
+    const load_fun m_load;
+    std::mutex m_mutex; // guards m_stream, m_queue
+    std::condition_variable m_cv;
+    array_t<stream_type, stream_num> m_stream;
+    size_t m_victim = 0; // next stream to reuse
+    std::deque<size_t> m_queue; // pending streams
+    bool m_shutdown = false;
+    std::unique_ptr<joinable_thread> m_thread;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_READ_AHEAD_H__
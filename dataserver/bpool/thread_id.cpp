@@ -1,115 +1,374 @@
 // thread_id.cpp
 //
 #include "dataserver/bpool/thread_id.h"
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
 
 namespace sdl { namespace db { namespace bpool { 
 
 thread_mask_t::thread_mask_t(size_t const filesize)
-    : m_index_count(round_up_div(filesize, index_size))
-    , m_block_count(round_up_div(filesize, (size_t)block_size))
+    : m_block_count(round_up_div(filesize, (size_t)pool_limits::block_size))
 {
-    SDL_ASSERT(m_index_count <= max_index);
-    SDL_ASSERT(m_block_count <= pool_limits::max_block);
-    static_assert(index_block_num == 8192, "");
-    static_assert(!(index_block_num % mask_div), "");
-    static_assert(sizeof(mask_t) == 1024, "");
-    m_index.resize(m_index_count);
+    SDL_ASSERT(m_block_count <= pool_limits::max_file_block);
+    static_assert(slot_key(pool_limits::max_file_block) < (slot_type(1) << 40), "");
 }
 
-void thread_mask_t::shrink_to_fit() {
-    for (mask_p & p : m_index) {
-        if (p && empty(*p)) {
-            p.reset();
+thread_mask_t::slot_type &
+thread_mask_t::insert_slot(size_t const i) {
+    SDL_ASSERT(i < m_block_count);
+    if ((m_used + 1) * 4 > m_slot.size() * 3) { // load factor 3/4
+        if (slot_type * const s = find_slot(i)) {
+            return *s;
+        }
+        rehash(1);
+    }
+    const size_t mask = m_slot.size() - 1;
+    const slot_type key = slot_key(i);
+    for (size_t pos = hash(i) & mask;; pos = (pos + 1) & mask) {
+        slot_type & s = m_slot[pos];
+        if (!s) {
+            s = key;
+            ++m_used;
+            return s;
+        }
+        if ((s & ~slot_type(0xFF)) == key) {
+            return s;
         }
     }
 }
 
+thread_mask_t::scan_type &
+thread_mask_t::scan_slot(slot_type const & s) {
+    if (m_scan.empty()) {
+        m_scan.assign(m_slot.size(), 0);
+    }
+    SDL_ASSERT(m_scan.size() == m_slot.size());
+    return m_scan[&s - m_slot.data()];
+}
+
+void thread_mask_t::rehash(size_t const reserve) { // drops slots with zero page_mask and no scan locks
+    data_type old;
+    old.swap(m_slot);
+    scan_data old_scan;
+    old_scan.swap(m_scan);
+    auto const is_used = [&old, &old_scan](size_t const j) {
+        return slot_mask(old[j]) || (!old_scan.empty() && old_scan[j]);
+    };
+    size_t count = reserve;
+    for (size_t j = 0; j < old.size(); ++j) {
+        if (is_used(j)) {
+            ++count;
+        }
+    }
+    m_used = 0;
+    if (!count) {
+        return;
+    }
+    size_t capacity = size_t(1) << min_power;
+    while (count * 4 > capacity * 3) {
+        capacity <<= 1;
+    }
+    m_slot.assign(capacity, 0);
+    if (!old_scan.empty()) {
+        m_scan.assign(capacity, 0);
+    }
+    const size_t mask = capacity - 1;
+    for (size_t j = 0; j < old.size(); ++j) {
+        if (is_used(j)) {
+            size_t pos = hash(slot_block(old[j])) & mask;
+            while (m_slot[pos]) {
+                pos = (pos + 1) & mask;
+            }
+            m_slot[pos] = old[j];
+            if (!old_scan.empty()) {
+                m_scan[pos] = old_scan[j];
+            }
+            ++m_used;
+        }
+    }
+}
+
+void thread_mask_t::shrink_to_fit() {
+    rehash(0);
+}
+
 void thread_mask_t::clear() {
-    for (mask_p & p : m_index) {
-        p.reset();
+    if (m_slot.size() > (size_t(1) << shrink_power)) {
+        data_type().swap(m_slot);
+        scan_data().swap(m_scan);
+    }
+    else {
+        std::fill(m_slot.begin(), m_slot.end(), 0);
+        std::fill(m_scan.begin(), m_scan.end(), 0);
+    }
+    m_used = 0;
+    m_scan_used = 0;
+}
+
+// page locked before first scan lock belongs to lock_page holder, so it is not counted
+void thread_mask_t::add_scan_lock(size_t const i, size_t const page) {
+    SDL_ASSERT(page < block_page_num);
+    slot_type & s = insert_slot(i);
+    scan_type & scan = scan_slot(s);
+    const size_t shift = page << 3;
+    const uint8 count = scan_byte(scan, page) & scan_count;
+    if (count) {
+        if (count == scan_count) {
+            throw_error_t<thread_mask_t>("too many scans of page");
+        }
+        scan += scan_type(1) << shift;
+    }
+    else if (!(slot_mask(s) & (1 << page))) {
+        scan = (scan & ~(scan_type(0xFF) << shift)) | (scan_type(1) << shift);
+        ++m_scan_used;
+    }
+}
+
+bool thread_mask_t::release_scan_lock(size_t const i, size_t const page) {
+    SDL_ASSERT(page < block_page_num);
+    slot_type const * const s = m_scan.empty() ? nullptr : find_slot(i);
+    if (!s) {
+        return false; // page is not locked by scan
+    }
+    scan_type & scan = m_scan[s - m_slot.data()];
+    const size_t shift = page << 3;
+    const uint8 b = scan_byte(scan, page);
+    if (!(b & scan_count)) {
+        return false; // page is not locked by scan
+    }
+    if ((b & scan_count) > 1) {
+        scan -= scan_type(1) << shift;
+        return false; // page is still used by other scan
+    }
+    scan &= ~(scan_type(0xFF) << shift);
+    SDL_ASSERT(m_scan_used);
+    --m_scan_used;
+    return !(b & scan_held);
+}
+
+void thread_mask_t::hold_scan_lock(size_t const i, size_t const page) {
+    SDL_ASSERT(page < block_page_num);
+    if (slot_type const * const s = m_scan.empty() ? nullptr : find_slot(i)) {
+        scan_type & scan = m_scan[s - m_slot.data()];
+        if (scan_byte(scan, page) & scan_count) {
+            scan |= scan_type(scan_held) << (page << 3);
+        }
     }
 }
 
 //-------------------------------------------------------------
 
-thread_id_t::thread_id_t(size_t const s)
-    : init_thread_id(std::this_thread::get_id())
-    , m_filesize(s)
-    , m_size(0)
-{
-    SDL_ASSERT(m_filesize);
-    SDL_ASSERT(!empty(init_thread_id));
-}
-
-thread_id_t::pos_mask
-thread_id_t::find(thread_id const id) {
-    SDL_ASSERT(id != init_thread_id);
-    SDL_ASSERT(!empty(id));
-    const auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x){
-        SDL_ASSERT(empty(x.first) == !x.second);
-        return (x.first == id);
-    });
-    if (pos != m_data.end()) {
-        SDL_ASSERT(pos->second);
-        const size_t d = static_cast<size_t>(std::distance(m_data.begin(), pos));
-        return { d, pos->second.get() };
-    }
-    return{ max_thread, nullptr };
-}
-
-thread_id_t::pos_mask
-thread_id_t::insert(thread_id const id) {
-    SDL_ASSERT(id != init_thread_id);
-    SDL_ASSERT(!empty(id));
-    auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x) {
-        return (x.first == id) || (x.second == nullptr);
-    });
-    if (pos == m_data.end()) {
-        SDL_ASSERT(0); //FIXME: wait until thread is released ?
-        throw_error_t<thread_id_t>("too many threads");
-        return { max_thread, nullptr };
-    }
-    if (pos->first != id) {
-        SDL_ASSERT(empty(pos->first)); // empty slot is found
-        SDL_ASSERT(!pos->second);
-        const auto pos_id = std::find_if(pos + 1, m_data.end(), [id](id_mask const & x) {
-            return (x.first == id);
-        });
-        if (pos_id == m_data.end()) { // use empty slot
-            pos->first = id;
-            reset_new(pos->second, m_filesize);
-            SDL_ASSERT(m_size < (int)max_size());
-            ++m_size;
-            SDL_TRACE("thread_insert ", id, ", m_size ", m_size);
-        }
-        else {
-            pos = pos_id;
-        }
-    }
-    SDL_ASSERT(pos->second);
-    const auto d = static_cast<size_t>(std::distance(m_data.begin(), pos));
-    return { d, pos->second.get() };
-}
-
-bool thread_id_t::erase(thread_id const id) {
-    SDL_ASSERT(id != init_thread_id);
-    SDL_ASSERT(!empty(id));
-    const auto pos = std::find_if(m_data.begin(), m_data.end(), [id](id_mask const & x){
-        return (x.first == id);
-    });
-    if (pos != m_data.end()) {
-        SDL_ASSERT(pos->second);
-        pos->first = {};
-        pos->second.reset();
-        SDL_ASSERT(m_size);
-        --m_size;
-        SDL_TRACE("* thread_erase ", id, ", m_size ", m_size);
+namespace thread_id_ {
+
+struct slot_type : noncopyable {
+    using thread_id = thread_id_t::thread_id;
+    thread_id const id;
+    thread_mask_t mask;
+    std::atomic_bool erased;
+    slot_type(thread_id const i, size_t const filesize)
+        : id(i), mask(filesize), erased(false) {}
+};
+
+using shared_slot = std::shared_ptr<slot_type>;
+
+} // thread_id_
+
+class thread_id_t::data_type : noncopyable {
+    using shared_slot = thread_id_::shared_slot;
+    using map_type = std::unordered_map<thread_id, shared_slot>;
+    using lock_guard = std::lock_guard<std::mutex>;
+public:
+    const size_t filesize;
+    std::atomic<size_t> size;
+    data_type(size_t const s, exit_fun && f)
+        : filesize(s), size(0), m_exit(std::move(f)) {}
+    shared_slot insert(thread_id);
+    shared_slot find(thread_id) const;
+    bool erase(thread_id);
+    void clear();
+    void reset_exit() {
+        lock_guard lock(m_exit_mutex); // wait for thread_exit in progress
+        m_exit = nullptr;
+    }
+    void thread_exit(thread_id);
+private:
+    mutable std::mutex m_mutex; // guards m_map
+    map_type m_map;
+    std::mutex m_exit_mutex; // guards m_exit
+    exit_fun m_exit;
+};
+
+namespace thread_id_ {
+
+class local_cache : noncopyable { // registered slots of current thread
+    using data_type = thread_id_t::data_type;
+    struct entry_type {
+        std::shared_ptr<data_type> data;
+        shared_slot slot;
+    };
+    std::vector<entry_type> m_entry; // usually one entry per page_bpool
+    local_cache() = default;
+public:
+    ~local_cache();
+    static local_cache & get() {
+        static thread_local local_cache cache;
+        return cache;
+    }
+    slot_type * find(data_type const * const p) const {
+        for (entry_type const & e : m_entry) {
+            if (e.data.get() == p) {
+                return e.slot->erased ? nullptr : e.slot.get();
+            }
+        }
+        return nullptr;
+    }
+    void insert(std::shared_ptr<data_type> const &, shared_slot const &);
+};
+
+local_cache::~local_cache() {
+    for (entry_type const & e : m_entry) {
+        if (!e.slot->erased) {
+            e.data->thread_exit(e.slot->id);
+        }
+    }
+}
+
+void local_cache::insert(std::shared_ptr<data_type> const & data, shared_slot const & slot) {
+    SDL_ASSERT(data && slot);
+    m_entry.erase(std::remove_if(m_entry.begin(), m_entry.end(), 
+        [&data](entry_type const & e) {
+            return (e.data == data) || e.slot->erased; // replaced or released
+        }), m_entry.end());
+    m_entry.push_back({ data, slot });
+}
+
+} // thread_id_
+
+thread_id_::shared_slot
+thread_id_t::data_type::insert(thread_id const id) {
+    lock_guard lock(m_mutex);
+    shared_slot & slot = m_map[id];
+    if (!slot) {
+        if (m_map.size() > max_thread) {
+            m_map.erase(id);
+            throw_error_t<thread_id_t>("too many threads");
+        }
+        slot = std::make_shared<thread_id_::slot_type>(id, filesize);
+        ++size;
+        SDL_TRACE("thread_insert ", id, ", size ", size);
+    }
+    return slot;
+}
+
+thread_id_::shared_slot
+thread_id_t::data_type::find(thread_id const id) const {
+    lock_guard lock(m_mutex);
+    const auto pos = m_map.find(id);
+    if (pos != m_map.end()) {
+        return pos->second;
+    }
+    return{};
+}
+
+bool thread_id_t::data_type::erase(thread_id const id) {
+    lock_guard lock(m_mutex);
+    const auto pos = m_map.find(id);
+    if (pos != m_map.end()) {
+        pos->second->erased = true;
+        m_map.erase(pos);
+        SDL_ASSERT(size);
+        --size;
+        SDL_TRACE("* thread_erase ", id, ", size ", size);
         return true;
     }
-    SDL_ASSERT(!"erase");
     return false;
 }
 
+void thread_id_t::data_type::clear() {
+    lock_guard lock(m_mutex);
+    for (auto & p : m_map) {
+        p.second->erased = true;
+    }
+    m_map.clear();
+    size = 0;
+}
+
+void thread_id_t::data_type::thread_exit(thread_id const id) { // called from exiting thread
+    try {
+        lock_guard lock(m_exit_mutex);
+        if (m_exit) {
+            m_exit(id);
+        }
+    }
+    catch (std::exception & e) {
+        SDL_TRACE_ERROR("thread_exit = ", e.what());
+        SDL_ASSERT(0);
+    }
+}
+
+//-------------------------------------------------------------
+
+thread_id_t::thread_id_t(size_t const filesize, exit_fun f)
+    : m_data(std::make_shared<data_type>(filesize, std::move(f)))
+{
+    SDL_ASSERT(filesize);
+}
+
+thread_id_t::~thread_id_t()
+{
+    m_data->reset_exit();
+    m_data->clear(); // slots of alive threads are released by local_cache
+}
+
+void thread_id_t::reset_exit()
+{
+    m_data->reset_exit();
+}
+
+size_t thread_id_t::size() const
+{
+    SDL_ASSERT(m_data->size <= max_size());
+    return m_data->size;
+}
+
+thread_id_t::mask_ptr
+thread_id_t::find()
+{
+    if (auto const slot = thread_id_::local_cache::get().find(m_data.get())) {
+        return &(slot->mask);
+    }
+    return nullptr;
+}
+
+thread_id_t::mask_ptr
+thread_id_t::insert()
+{
+    thread_id_::local_cache & cache = thread_id_::local_cache::get();
+    if (auto const slot = cache.find(m_data.get())) {
+        return &(slot->mask);
+    }
+    thread_id_::shared_slot const slot = m_data->insert(get_id());
+    cache.insert(m_data, slot);
+    return &(slot->mask);
+}
+
+thread_id_t::mask_ptr
+thread_id_t::find(thread_id const id)
+{
+    SDL_ASSERT(id != thread_id());
+    if (auto const slot = m_data->find(id)) { // slot is kept alive by owner thread
+        return &(slot->mask);
+    }
+    return nullptr;
+}
+
+bool thread_id_t::erase(thread_id const id)
+{
+    SDL_ASSERT(id != thread_id());
+    return m_data->erase(id);
+}
+
 #if SDL_DEBUG
 namespace {
     inline constexpr uint32_t knuth_hash(uint32_t v) {
@@ -121,11 +380,10 @@ namespace {
     public:
         unit_test() {
             static_assert(power_of<64>::value == 6, "");
-            if (0) {
-                test_mask(gigabyte<8>::value);
-                //test_mask(terabyte<1>::value);
+            if (1) {
+                test_mask(gigabyte<1>::value);
             }
-            if (0) {
+            if (1) {
                 try {
                     test_thread();
                 }
@@ -141,24 +399,87 @@ namespace {
         thread_mask_t test(filesize);
         for (size_t i = 0; i < test.size(); ++i) {
             SDL_ASSERT(!test[i]);
-            test.set_block(i);
-            SDL_ASSERT(test[i]);
+            for (size_t j = 0; j < pool_limits::block_page_num; ++j) {
+                test.set_page(i, j);
+                SDL_ASSERT(test.is_page(i, j));
+            }
+            SDL_ASSERT(test.page_mask(i) == 0xFF);
+            test.clr_page(i, 0);
+            SDL_ASSERT(test.page_mask(i) == 0xFE);
             if (i >= 8192)
                 test.clr_block(i);
         }
+        size_t count = 0;
+        test.for_each_block([&count](size_t, uint8 const mask){
+            SDL_ASSERT(mask == 0xFE);
+            ++count;
+        });
+        SDL_ASSERT(count == a_min(test.size(), size_t(8192)));
         test.clr_block(test.size()-1);
         test.shrink_to_fit();
+        SDL_ASSERT(test.used() == a_min(test.size() - 1, size_t(8192)));
+        test.clear();
+        SDL_ASSERT(!test.used() && !test.capacity());
+        test.set_page(test.size() - 1, 7);
+        SDL_ASSERT(test.page_mask(test.size() - 1) == 0x80);
+        SDL_ASSERT(test.capacity() == 16);
+        test.add_scan_lock(1, 0); // nested scans
+        test.set_page(1, 0);
+        test.add_scan_lock(1, 0);
+        SDL_ASSERT(!test.release_scan_lock(1, 0));
+        SDL_ASSERT(test.release_scan_lock(1, 0));
+        SDL_ASSERT(!test.has_scan_lock());
+        test.set_page(2, 1); // locked by lock_page before scan
+        test.add_scan_lock(2, 1);
+        SDL_ASSERT(!test.has_scan_lock());
+        SDL_ASSERT(!test.release_scan_lock(2, 1));
+        test.add_scan_lock(3, 2); // locked by lock_page during scan
+        test.hold_scan_lock(3, 2);
+        test.add_scan_lock(3, 3); // other page of same block
+        SDL_ASSERT(!test.release_scan_lock(3, 2));
+        SDL_ASSERT(test.has_scan_lock());
+        SDL_ASSERT(test.release_scan_lock(3, 3));
+        SDL_ASSERT(!test.has_scan_lock());
+        for (size_t i = 0; i < 1000; ++i) { // scan counts move with slots on rehash
+            test.add_scan_lock(i + 10, i % pool_limits::block_page_num);
+        }
+        test.shrink_to_fit();
+        for (size_t i = 0; i < 1000; ++i) {
+            SDL_ASSERT(test.release_scan_lock(i + 10, i % pool_limits::block_page_num));
+        }
+        SDL_ASSERT(!test.has_scan_lock());
+        test.add_scan_lock(4, 0);
+        test.clear();
+        SDL_ASSERT(!test.has_scan_lock());
     }
     void unit_test::test_thread() {
-        thread_id_t test(gigabyte<8>::value);
-        auto pos = test.insert();
-        SDL_ASSERT(pos.first.value() == test.insert().first.value());
+        std::atomic<size_t> exit_count(0);
+        thread_id_t * registry = nullptr;
+        thread_id_t test(gigabyte<8>::value, [&exit_count, &registry](thread_id_t::thread_id const id){
+            SDL_ASSERT(registry->erase(id)); // as page_bpool::unlock_thread with removef::true_
+            ++exit_count;
+        });
+        registry = &test;
+        auto const mask = test.insert();
+        SDL_ASSERT(mask == test.insert());
+        SDL_ASSERT(mask == test.find());
         const auto id = test.get_id();
-        SDL_ASSERT(test.find(id).first.value() < pool_limits::max_thread);
-        SDL_ASSERT(test.find(id).second);
+        SDL_ASSERT(test.find(id) == mask);
+        std::vector<std::thread> threads(100);
+        for (auto & t : threads) {
+            t = std::thread([&test](){
+                SDL_ASSERT(test.insert() == test.find());
+            });
+        }
+        for (auto & t : threads) {
+            t.join();
+        }
+        SDL_ASSERT(exit_count == threads.size());
+        SDL_ASSERT(test.size() == 1);
         SDL_ASSERT(test.erase(id));
         SDL_ASSERT(!test.erase(id));
-        SDL_ASSERT(!test.find(id).second);
+        SDL_ASSERT(!test.find(id));
+        SDL_ASSERT(!test.find());
         SDL_TRACE_FUNCTION;
     }
     static unit_test s_test;
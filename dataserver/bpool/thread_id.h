@@ -5,31 +5,36 @@
 #define __SDL_BPOOL_THREAD_ID_H__
 
 #include "dataserver/bpool/block_head.h"
-#include "dataserver/common/array.h"
 #include <atomic>
 #include <thread>
+#include <functional>
+#include <vector>
 
 namespace sdl { namespace db { namespace bpool {
 
-class thread_mask_t : noncopyable {
-    static constexpr size_t index_size = megabyte<512>::value; // 2^29, 536,870,912
-    static constexpr size_t max_index = terabyte<1>::value / index_size; // 2048
-    enum { block_size = pool_limits::block_size };
-    enum { chunk_block_num = 64 }; // # of blocks in uint64 mask
-    enum { chunk_size = block_size * chunk_block_num };
-    enum { index_block_num = index_size / block_size }; // 8192 = 128 * 64
-    enum { mask_div = 8 * sizeof(uint64) }; // 64 = 2^6
-    enum { mask_hex = mask_div - 1 };
-    enum { mask_size = index_block_num / mask_div }; // 128, 1 bit per block
-    static_assert(mask_size * chunk_size == index_size, "");
-    using mask_t = array_t<uint64, mask_size>;
-    using mask_p = std::unique_ptr<mask_t>;
-    using data_type = std::vector<mask_p>; //FIXME: custom allocator
+class thread_mask_t : noncopyable { // pages locked by one thread, modified only by owner thread
+    enum { block_page_num = pool_limits::block_page_num };
+    enum { min_power = 4 }; // 16 slots
+    enum { shrink_power = 12 }; // 4096 slots (32 KB), larger table is released by clear()
+    static_assert(block_page_num == 8, "uint8 page mask");
+    // open addressing hash table (linear probing), slot = (realBlock + 1) << 8 | page_mask;
+    // slot with zero page_mask keeps its key until rehash, so no tombstones are needed.
+    using slot_type = uint64;
+    using data_type = std::vector<slot_type>;
+    // scan locks of block are kept at the same position as its slot, byte per page = scan_held | count
+    using scan_type = uint64;
+    using scan_data = std::vector<scan_type>; // empty until first scan lock
+    enum : uint8 { scan_held = 0x80, scan_count = 0x7F };
 public:
     explicit thread_mask_t(size_t filesize);
-    bool is_block(size_t) const;
+    uint8 page_mask(size_t) const;
+    bool is_block(size_t i) const {
+        return page_mask(i) != 0;
+    }
+    bool is_page(size_t, size_t) const;
+    void set_page(size_t, size_t);
+    void clr_page(size_t, size_t);
     void clr_block(size_t);
-    void set_block(size_t);
     size_t size() const {
         return m_block_count;
     }
@@ -37,78 +42,83 @@ public:
         SDL_ASSERT(i < size());
         return is_block(i);
     }
-    data_type const & data() const {
-        return m_index;
+    size_t capacity() const { // allocated slots
+        return m_slot.size();
+    }
+    size_t used() const { // touched blocks since last clear or rehash
+        return m_used;
     }
     template<class fun_type>
-    void for_each_block(fun_type &&) const;
+    void for_each_block(fun_type &&) const; // fun(blockId, page_mask), O(blocks touched by thread)
     void shrink_to_fit();
-    void clear();
+    void clear(); // also drops scan locks
+public: // counted locks of page scans, see page_bpool::lock_page_scan; O(1) as page_mask
+    bool has_scan_lock() const {
+        return m_scan_used != 0;
+    }
+    void add_scan_lock(size_t, size_t); // page locked by this thread before first scan lock is not counted
+    bool release_scan_lock(size_t, size_t); // true if page must be unlocked
+    void hold_scan_lock(size_t, size_t); // page is locked by lock_page too, scans do not unlock it
 private:
-    bool empty(mask_t const &) const;
+    static constexpr slot_type slot_key(size_t const i) {
+        return static_cast<slot_type>(i + 1) << 8;
+    }
+    static constexpr uint8 slot_mask(slot_type const s) {
+        return static_cast<uint8>(s);
+    }
+    static constexpr size_t slot_block(slot_type const s) {
+        return static_cast<size_t>(s >> 8) - 1;
+    }
+    static constexpr uint8 scan_byte(scan_type const s, size_t const page) {
+        return static_cast<uint8>(s >> (page << 3));
+    }
+    static size_t hash(size_t const i) { // Knuth multiplicative hash, high bits folded down
+        const uint32 h = static_cast<uint32>(i) * UINT32_C(2654435761);
+        return static_cast<size_t>(h ^ (h >> 16));
+    }
+    slot_type const * find_slot(size_t) const;
+    slot_type * find_slot(size_t);
+    slot_type & insert_slot(size_t);
+    scan_type & scan_slot(slot_type const &);
+    void rehash(size_t min_used);
 private:
-    const size_t m_index_count;
     const size_t m_block_count;
-    data_type m_index;
+    size_t m_used = 0; // occupied slots (including slots with zero page_mask)
+    data_type m_slot; // size is power of 2 or zero
+    scan_data m_scan; // same size as m_slot if not empty
+    size_t m_scan_used = 0; // pages with scan locks
 };
 
-inline bool thread_mask_t::empty(mask_t const & m) const {
-    for (const auto & v : m) {
-        if (v)
-            return false;
-    }
-    return true;
+namespace thread_id_ {
+    class local_cache;
 }
 
+// Registry of threads which lock pages. Lookup of current thread is O(1) (thread local cache).
+// When registered thread exits, exit function is called in that thread to release its pages.
 class thread_id_t : noncopyable {
     enum { max_thread = pool_limits::max_thread };
 public:
     using thread_id = std::thread::id;
-    typedef thread_mask_t * const mask_ptr;
-    struct pos_mask {
-        threadIndex const first;
-        mask_ptr second;
-        pos_mask(): first(max_thread), second(nullptr) {}
-        pos_mask(threadIndex f, mask_ptr s): first(f), second(s) {}
-    };
-    explicit thread_id_t(size_t filesize);
+    using mask_ptr = thread_mask_t *;
+    using exit_fun = std::function<void(thread_id)>;
+    thread_id_t(size_t filesize, exit_fun);
+    ~thread_id_t();
     static thread_id get_id() {
         return std::this_thread::get_id();
     }
     static constexpr size_t max_size() {
         return max_thread;
     }
-    size_t size() const {
-        SDL_ASSERT(m_size <= (int)max_size());
-        return m_size;
-    }
-    pos_mask insert() {
-        return insert(get_id());
-    }
-    pos_mask insert(thread_id); // throw if too many threads
+    size_t size() const;
+    mask_ptr insert(); // current thread; throw if too many threads
+    mask_ptr find(); // current thread; lock-free
+    mask_ptr find(thread_id); // any thread; mask is valid and can be used only in owner thread
     bool erase(thread_id);
-    pos_mask find(thread_id);
-    pos_mask find() {
-        return find(get_id());
-    }
+    void reset_exit(); // exit function is not called after return
 private:
-    static bool empty(thread_id id) {
-        return id == thread_id();
-    }
-#if 0
-    enum { use_hash = 0 }; // to be tested
-    static size_t hash_id(id_type const & id) {
-        std::hash<std::thread::id> hasher;
-        return hasher(id) % max_thread;
-    }
-#endif
-    using unique_mask = std::unique_ptr<thread_mask_t>;
-    using id_mask = std::pair<thread_id, unique_mask>;
-    using data_type = array_t<id_mask, max_thread>;
-    const thread_id init_thread_id;
-    const size_t m_filesize;
-    data_type m_data;
-    std::atomic<int> m_size;
+    friend thread_id_::local_cache;
+    class data_type;
+    std::shared_ptr<data_type> m_data;
 };
 
 }}} // sdl
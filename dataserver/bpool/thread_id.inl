@@ -6,65 +6,67 @@
 
 namespace sdl { namespace db { namespace bpool { 
 
-inline bool thread_mask_t::is_block(size_t const i) const {
+inline thread_mask_t::slot_type const *
+thread_mask_t::find_slot(size_t const i) const {
     SDL_ASSERT(i < m_block_count);
-    mask_p const & p = m_index[i / index_block_num];
-    if (p) {
-        const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-        const size_t k = (i & mask_hex);
-        uint64 const & mask = (*p)[j];
-        return (mask & (uint64(1) << k)) != 0;
+    if (m_slot.empty()) {
+        return nullptr;
+    }
+    const size_t mask = m_slot.size() - 1;
+    const slot_type key = slot_key(i);
+    for (size_t pos = hash(i) & mask;; pos = (pos + 1) & mask) {
+        slot_type const & s = m_slot[pos];
+        if (!s) {
+            return nullptr;
+        }
+        if ((s & ~slot_type(0xFF)) == key) {
+            return &s;
+        }
     }
-    return false;
 }
 
-inline void thread_mask_t::clr_block(size_t const i) {
-    SDL_ASSERT(i < m_block_count);
-    mask_p & p = m_index[i / index_block_num];
-    if (p) {
-        const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-        const size_t k = (i & mask_hex);
-        uint64 & mask = (*p)[j];
-        mask &= ~(uint64(1) << k);
+inline thread_mask_t::slot_type *
+thread_mask_t::find_slot(size_t const i) {
+    return const_cast<slot_type *>(static_cast<thread_mask_t const *>(this)->find_slot(i));
+}
+
+inline uint8 thread_mask_t::page_mask(size_t const i) const {
+    if (slot_type const * const s = find_slot(i)) {
+        return slot_mask(*s);
     }
+    return 0;
 }
 
-inline void thread_mask_t::set_block(size_t const i) {
-    SDL_ASSERT(i < m_block_count);
-    mask_p & p = m_index[i / index_block_num];
-    if (!p) {
-        reset_new(p); //FIXME: should be optimized (custom allocator)
+inline bool thread_mask_t::is_page(size_t const i, size_t const page) const {
+    SDL_ASSERT(page < block_page_num);
+    return (page_mask(i) & (1 << page)) != 0;
+}
+
+inline void thread_mask_t::set_page(size_t const i, size_t const page) {
+    SDL_ASSERT(page < block_page_num);
+    insert_slot(i) |= slot_type(1) << page;
+}
+
+inline void thread_mask_t::clr_page(size_t const i, size_t const page) {
+    SDL_ASSERT(page < block_page_num);
+    if (slot_type * const s = find_slot(i)) {
+        *s &= ~(slot_type(1) << page);
+    }
+}
+
+inline void thread_mask_t::clr_block(size_t const i) {
+    if (slot_type * const s = find_slot(i)) {
+        *s &= ~slot_type(0xFF);
     }
-    const size_t j = (i % index_block_num) >> power_of<mask_div>::value; // divide by mask_div
-    const size_t k = (i & mask_hex);
-    uint64 & mask = (*p)[j];
-    mask |= (uint64(1) << k);
 }
 
 template<class fun_type>
 void thread_mask_t::for_each_block(fun_type && fun) const {
-    size_t block_offset = 0;
-    for (mask_p const & p : m_index) {
-        if (p) {
-            mask_t const & m = *p;
-            size_t block_index = block_offset;
-            for (const uint64 & mask : m) {
-                if (mask) {
-                    static_assert(chunk_block_num == 64, "");
-                    size_t b = block_index;
-                    for (size_t k = 0; k < chunk_block_num; ++k, ++b) {
-                        if (mask & (uint64(1) << k)) {
-                            fun(b);
-                        }
-                    }
-                }
-                block_index += chunk_block_num;
-            }
-            SDL_ASSERT(block_index == (block_offset + index_block_num));
+    for (slot_type const s : m_slot) {
+        if (const uint8 pages = slot_mask(s)) {
+            fun(slot_block(s), pages);
         }
-        block_offset += index_block_num;
     }
-    SDL_ASSERT(block_offset >= m_block_count);
 }
 
 }}} // sdl
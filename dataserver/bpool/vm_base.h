@@ -23,6 +23,18 @@ inline constexpr bool is_commited(vm_commited v) {
     return v != vm_commited::false_;
 }
 
+enum class vm_hugepage { 
+    none,           // arena is mapped separately
+    transparent,    // 2 MB aligned address space with madvise(MADV_HUGEPAGE)
+    hugetlb         // explicit MAP_HUGETLB, falls back to transparent if huge pages are not available
+};
+
+enum class vm_populate { false_, true_ }; // pre-fault committed memory (MAP_POPULATE)
+
+inline constexpr bool is_populate(vm_populate v) {
+    return v != vm_populate::false_;
+}
+
 }}} // db
 
 #endif // __SDL_BPOOL_VM_BASE_H__
@@ -3,6 +3,8 @@
 #include "dataserver/bpool/vm_unix.h"
 #include "dataserver/filesys/mmap64_unix.h" // mmap, mmap64
 #include <numeric>
+#include <fstream>
+#include <chrono>
 
 #if defined(SDL_OS_UNIX)
     #if !defined(MAP_ANONYMOUS)
@@ -22,11 +24,17 @@ vm_unix_base::vm_unix_base(size_t const size)
     SDL_ASSERT(size && !(size % arena_size));
 }
 
-vm_unix::vm_unix(size_t const size, vm_commited const f)
+vm_unix::vm_unix(size_t const size, vm_commited const f, vm_hugepage const h, vm_populate const pf)
     : vm_unix_base(get_arena_size(size) * arena_size)
     , m_arena(arena_reserved)
     , m_free_arena_list{} // clear
     , m_mixed_arena_list{} // clear
+    , m_alloc_block_count(0)
+    , m_alloc_arena_count(0)
+    , m_hugepage(h)
+    , m_populate(pf)
+    , m_hugepage_count(0)
+    , m_hugetlb_count(0)
 {
     SDL_ASSERT(size && !(size % block_size));
     SDL_ASSERT(page_reserved <= vm_unix::max_page);
@@ -43,6 +51,10 @@ vm_unix::vm_unix(size_t const size, vm_commited const f)
     static_assert(get_arena_size(gigabyte<1>::value) == 1024, "");
     static_assert(get_arena_size(terabyte<1>::value) == 1024*1024, ""); // 1048576
     static_assert(arena_t::mask_all == 0xFFFF, "");
+    static_assert(hugepage_size == arena_size * hugepage_arena_num, "");
+    if (m_hugepage != vm_hugepage::none) {
+        sys_reserve_hugepage();
+    }
     if (is_commited(f)) {
         size_t i = 0;
         for (auto & x : m_arena) {
@@ -68,9 +80,17 @@ vm_unix::vm_unix(size_t const size, vm_commited const f)
 
 vm_unix::~vm_unix()
 {
+#if defined(SDL_OS_UNIX)
+    if (m_reserve_adr) { // releases all arenas
+        ::munmap(m_reserve_adr, m_reserve_size);
+        return;
+    }
+#endif
+    size_t i = 0;
     for (arena_t & x : m_arena) {
         if (x.arena_adr)
-            sys_free_arena(x.arena_adr);
+            sys_free_arena(x.arena_adr, i);
+        ++i;
     }
 }
 
@@ -153,7 +173,7 @@ void vm_unix::alloc_arena_nosort(arena_t & x, const size_t i) {
     SDL_ASSERT(&x == &m_arena[i]);
     SDL_ASSERT(m_sort_adr.empty());
     if (!x.arena_adr) {
-        x.arena_adr = sys_alloc_arena(); // throw if failed
+        x.arena_adr = sys_alloc_arena(i); // throw if failed
         SDL_ASSERT(debug_zero_arena(x));
         ++m_alloc_arena_count;
         SDL_ASSERT(m_alloc_arena_count <= arena_reserved);
@@ -165,7 +185,7 @@ void vm_unix::alloc_arena(arena_t & x, const size_t i) {
     (void)i;
     SDL_ASSERT(&x == &m_arena[i]);
     if (!x.arena_adr) {
-        x.arena_adr = sys_alloc_arena(); // throw if failed
+        x.arena_adr = sys_alloc_arena(i); // throw if failed
         SDL_ASSERT(debug_zero_arena(x));
         ++m_alloc_arena_count;
         SDL_ASSERT(m_alloc_arena_count <= arena_reserved);
@@ -187,8 +207,9 @@ void vm_unix::free_arena(arena_t & x, const size_t i) {
             SDL_ASSERT(m_alloc_arena_count == m_sort_adr.size());
             m_sort_adr.erase(find_sort_adr(static_cast<sort_adr_t::value_type>(i)));
         }
-        sys_free_arena(x.arena_adr);
-        x.arena_adr = nullptr;
+        char * const p = x.arena_adr;
+        x.arena_adr = nullptr; // before sys_free_arena (see is_hugepage_used)
+        sys_free_arena(p, i);
         SDL_ASSERT(m_alloc_arena_count);
         --m_alloc_arena_count;
     }
@@ -216,11 +237,24 @@ size_t vm_unix::count_mixed_arena_list() const {
     return result;
 }
 
-char * vm_unix::sys_alloc_arena() {
+char * vm_unix::sys_alloc_arena(size_t const i) {
+    SDL_ASSERT(i < arena_reserved);
+    if (m_reserve_adr) {
+        const size_t u = i / hugepage_arena_num;
+        if (!is_hugepage_used(u)) {
+            sys_commit_hugepage(u);
+        }
+        return m_reserve_adr + i * arena_size;
+    }
 #if defined(SDL_OS_UNIX)
+#if defined(MAP_POPULATE)
+    const int populate = is_populate(m_populate) ? MAP_POPULATE : 0;
+#else
+    const int populate = 0;
+#endif
     void * const p = mmap64_t::call(nullptr, arena_size, 
         PROT_READ | PROT_WRITE // the desired memory protection of the mapping
-        , MAP_PRIVATE | MAP_ANONYMOUS // private copy-on-write mapping. The mapping is not backed by any file
+        , MAP_PRIVATE | MAP_ANONYMOUS | populate // private copy-on-write mapping. The mapping is not backed by any file
         ,-1 // file descriptor
         , 0 // offset must be a multiple of the page size as returned by sysconf(_SC_PAGE_SIZE)
     );
@@ -233,8 +267,17 @@ char * vm_unix::sys_alloc_arena() {
 #endif
 }
 
-bool vm_unix::sys_free_arena(char * const p) {
+bool vm_unix::sys_free_arena(char * const p, size_t const i) {
     SDL_ASSERT(p);
+    SDL_ASSERT(i < arena_reserved);
+    if (m_reserve_adr) { // 2 MB unit is decommited when both arenas are free, so huge page is not split
+        SDL_ASSERT(p == m_reserve_adr + i * arena_size);
+        const size_t u = i / hugepage_arena_num;
+        if (!is_hugepage_used(u)) {
+            return sys_decommit_hugepage(u);
+        }
+        return true;
+    }
 #if defined(SDL_OS_UNIX)
     if (::munmap(p, arena_size)) {
         SDL_ASSERT(!"munmap");
@@ -246,6 +289,171 @@ bool vm_unix::sys_free_arena(char * const p) {
     return true;
 }
 
+bool vm_unix::is_hugepage_used(size_t const u) const
+{
+    const size_t end = a_min((u + 1) * hugepage_arena_num, arena_reserved);
+    for (size_t i = u * hugepage_arena_num; i < end; ++i) {
+        if (m_arena[i].arena_adr) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t vm_unix::hugepage_set_block_count(size_t const u) const
+{
+    size_t count = 0;
+    const size_t end = a_min((u + 1) * hugepage_arena_num, arena_reserved);
+    for (size_t i = u * hugepage_arena_num; i < end; ++i) {
+        count += m_arena[i].set_block_count();
+    }
+    return count;
+}
+
+void vm_unix::sys_reserve_hugepage()
+{
+#if defined(SDL_OS_UNIX)
+    SDL_ASSERT(!m_reserve_adr);
+    m_reserve_size = round_up_div(byte_reserved, (size_t)hugepage_size) * hugepage_size;
+    const size_t size = m_reserve_size + hugepage_size; // to align start address
+    void * const p = mmap64_t::call(nullptr, size, PROT_NONE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    throw_error_if_t<vm_unix>(p == MAP_FAILED, "mmap64_t failed");
+    char * const adr = reinterpret_cast<char *>(p);
+    char * const start = adr + (hugepage_size - reinterpret_cast<size_t>(adr) % hugepage_size) % hugepage_size;
+    char * const end = start + m_reserve_size;
+    if (start > adr) {
+        ::munmap(adr, start - adr);
+    }
+    if (adr + size > end) {
+        ::munmap(end, adr + size - end);
+    }
+    m_reserve_adr = start;
+    m_hugetlb.resize(m_reserve_size / hugepage_size);
+    SDL_TRACE("vm_unix reserve hugepage = ", m_reserve_size / megabyte<1>::value, " MB");
+#endif
+}
+
+void vm_unix::sys_commit_hugepage(size_t const u)
+{
+#if defined(SDL_OS_UNIX)
+    SDL_ASSERT(m_reserve_adr && (u < m_hugetlb.size()));
+    SDL_ASSERT(!m_hugetlb[u]);
+    char * const adr = m_reserve_adr + u * hugepage_size;
+#if defined(MAP_HUGETLB)
+    if (m_hugepage == vm_hugepage::hugetlb) {
+#if defined(MAP_POPULATE)
+        const int populate = is_populate(m_populate) ? MAP_POPULATE : 0;
+#else
+        const int populate = 0;
+#endif
+        void * const p = mmap64_t::call(adr, hugepage_size, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_HUGETLB | populate, -1, 0);
+        if (p != MAP_FAILED) {
+            SDL_ASSERT(p == adr);
+            m_hugetlb[u] = 1;
+            ++m_hugetlb_count;
+            ++m_hugepage_count;
+            return;
+        } // else no free huge pages: use transparent huge pages
+    }
+#endif
+    void * const p = mmap64_t::call(adr, hugepage_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+    throw_error_if_t<vm_unix>(p == MAP_FAILED, "mmap64_t failed");
+    SDL_ASSERT(p == adr);
+#if defined(MADV_HUGEPAGE)
+    ::madvise(adr, hugepage_size, MADV_HUGEPAGE); // ignore error if THP is disabled
+#endif
+    if (is_populate(m_populate)) { // after madvise, else memory is faulted with small pages
+#if defined(MADV_POPULATE_WRITE)
+        if (::madvise(adr, hugepage_size, MADV_POPULATE_WRITE))
+#endif
+        {
+            enum { sys_page_size = 4096 };
+            for (size_t i = 0; i < hugepage_size; i += sys_page_size) {
+                reinterpret_cast<volatile char *>(adr)[i] = 0;
+            }
+        }
+    }
+    ++m_hugepage_count;
+#else
+    (void)u;
+#endif
+}
+
+bool vm_unix::sys_decommit_hugepage(size_t const u)
+{
+#if defined(SDL_OS_UNIX)
+    SDL_ASSERT(m_reserve_adr && (u < m_hugetlb.size()));
+    char * const adr = m_reserve_adr + u * hugepage_size;
+    void * const p = mmap64_t::call(adr, hugepage_size, PROT_NONE, // release memory, keep address space
+        MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED | MAP_NORESERVE, -1, 0);
+    if (p == MAP_FAILED) {
+        SDL_ASSERT(!"mmap64_t");
+        return false;
+    }
+    if (m_hugetlb[u]) {
+        m_hugetlb[u] = 0;
+        SDL_ASSERT(m_hugetlb_count);
+        --m_hugetlb_count;
+    }
+    SDL_ASSERT(m_hugepage_count);
+    --m_hugepage_count;
+    return true;
+#else
+    (void)u;
+    return false;
+#endif
+}
+
+size_t vm_unix::hugepage_used_size() const
+{
+    if (!m_reserve_adr) {
+        return 0;
+    }
+    size_t result = m_hugetlb_count * hugepage_size;
+    if (m_hugetlb_count < m_hugepage_count) {
+        using namespace std::chrono;
+        const int64 now = duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+        const int64 last = m_smaps_time;
+        if (!last || (now - last >= smaps_period_ms)) { // smaps of large process is slow to parse
+            m_smaps_time = now ? now : 1;
+            m_smaps_size = smaps_hugepage_size();
+        }
+        result += m_smaps_size;
+    }
+    return result;
+}
+
+// sum AnonHugePages of reserved address space
+size_t vm_unix::smaps_hugepage_size() const
+{
+    size_t result = 0;
+#if defined(SDL_OS_UNIX) && defined(__linux__)
+    std::ifstream smaps("/proc/self/smaps");
+    std::string line;
+    bool inside = false;
+    while (std::getline(smaps, line)) {
+        if (line.empty()) {
+            continue;
+        }
+        const char c = line[0];
+        if (((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'f'))) { // address range
+            char * end = nullptr;
+            const size_t first = std::strtoull(line.c_str(), &end, 16);
+            const size_t last = std::strtoull(end + 1, nullptr, 16);
+            const size_t start = reinterpret_cast<size_t>(m_reserve_adr);
+            inside = (first < start + m_reserve_size) && (start < last);
+        }
+        else if (inside && !line.compare(0, 14, "AnonHugePages:")) {
+            result += std::strtoull(line.c_str() + 14, nullptr, 10) * kilobyte<1>::value;
+        }
+    }
+#endif
+    return result;
+}
+
 char * vm_unix::alloc_next_arena_block() 
 {
     SDL_ASSERT(m_arena_brk < arena_reserved);
@@ -469,14 +677,16 @@ char * vm_unix::get_free_block(block_t const & b) const // block is NOT allocate
     return nullptr;
 }
 
-bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
+// Moves blocks from sparse mixed arenas into dense ones. 
+// Can be interrupted (is_break) and called again: arenas are sorted on each call.
+size_t vm_unix::defragment(move_block_fun const & move_block, break_fun const & is_break)
 {
     SDL_ASSERT(move_block);
     const size_t mixed_count = count_mixed_arena_list();
     if (mixed_count < 2) {
-        return false; // nothing to defragment
+        return 0; // nothing to defragment
     }
-    using arena_block = std::pair<arena32, uint8>;
+    using arena_block = std::pair<arena32, uint16>;
     std::vector<arena_block> mixed(mixed_count); // sorted by set_block_count
     {
         arena_index p = m_mixed_arena_list;
@@ -485,7 +695,13 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
             const auto & x = m_arena[p.index()];
             SDL_ASSERT(x.arena_adr && x.mixed());
             val.first = static_cast<arena32>(p.index());
-            val.second = static_cast<uint8>(x.set_block_count());
+            if (m_reserve_adr) { // empty sparse 2 MB units first, so whole huge pages are released
+                val.second = static_cast<uint16>(hugepage_set_block_count(p.index() / hugepage_arena_num)
+                    * (arena_block_num + 1) + x.set_block_count()); // then sparse arenas inside unit
+            }
+            else {
+                val.second = static_cast<uint16>(x.set_block_count());
+            }
             p = x.next_arena;
         }
         std::sort(mixed.begin(), mixed.end(), [](arena_block const & x, arena_block const & y){
@@ -498,7 +714,8 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
     SDL_ASSERT(lh->second <= rh->second);
     size_t moved_block_count = 0;
     size_t free_arena_count = 0;
-    while (lh < rh) {
+    bool interrupted = false;
+    while ((lh < rh) && !interrupted) {
         SDL_DEBUG_CPP(lh->second = 0); // not used
         SDL_DEBUG_CPP(rh->second = 0); // not used
         auto & x = m_arena[lh->first];
@@ -507,6 +724,10 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
         SDL_ASSERT(!x.empty() && !y.full());
         auto lmask = x.block_mask;
         while (lmask && !y.full()) {
+            if (is_break && is_break()) {
+                interrupted = true;
+                break;
+            }
             const size_t lb = arena_t::find_set_block(lmask);
             const size_t rb = y.find_free_block();
             SDL_ASSERT(x.is_block(lb));
@@ -543,7 +764,7 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
     }
     SDL_TRACE_IF(free_arena_count > 0, "# free_arena_count = ", free_arena_count);
     SDL_TRACE_IF(moved_block_count > 0, "# moved_block_count = ", moved_block_count);
-    return moved_block_count > 0;
+    return moved_block_count;
 }
 
 //---------------------------------------------------------------
@@ -552,14 +773,39 @@ bool vm_unix::defragment(move_block_fun const & move_block) // to be tested
 namespace {
 class unit_test {
     static void test(vm_commited);
+    static void test_hugepage(vm_hugepage);
 public:
     unit_test() {
         test(vm_commited::false_);
         test(vm_commited::true_);
+#if defined(SDL_OS_UNIX)
+        test_hugepage(vm_hugepage::transparent);
+#endif
         SDL_TRACE_FUNCTION;
     }
 };
 
+void unit_test::test_hugepage(vm_hugepage const h) {
+    using T = vm_unix;
+    T test(T::hugepage_size * 2 + T::arena_size, vm_commited::false_, h);
+    std::vector<char *> block_adr;
+    for (size_t i = 0; i < test.block_reserved; ++i) {
+        char * const p = test.alloc_block();
+        SDL_ASSERT(p == test.get_block(test.get_block_id(p)));
+        block_adr.push_back(p);
+    }
+    SDL_ASSERT(!(reinterpret_cast<size_t>(block_adr[0]) % T::hugepage_size));
+    SDL_ASSERT(test.commited_size() == T::hugepage_size * 3);
+    for (size_t i = 0; i < T::arena_block_num; ++i) { // first arena of 2 MB unit
+        SDL_ASSERT(test.release(block_adr[i]));
+    }
+    SDL_ASSERT(test.commited_size() == T::hugepage_size * 3); // huge page is not split
+    for (size_t i = T::arena_block_num; i < T::arena_block_num * 2; ++i) {
+        SDL_ASSERT(test.release(block_adr[i]));
+    }
+    SDL_ASSERT(test.commited_size() == T::hugepage_size * 2);
+}
+
 void unit_test::test(vm_commited const flag) {
     if (1) {
         using T = vm_unix;
@@ -13,6 +13,8 @@ class vm_unix_base : public vm_base {
 public:
     enum { arena_size = megabyte<1>::value }; // 1 MB = 2^20 = 1048,576
     enum { arena_block_num = 16 };
+    enum { hugepage_size = megabyte<2>::value }; // commit unit of vm_hugepage mode
+    enum { hugepage_arena_num = hugepage_size / arena_size };
     size_t const byte_reserved;
     size_t const page_reserved;
     size_t const block_reserved;
@@ -106,7 +108,7 @@ public:
     };
 #pragma pack(pop)
 public:
-    explicit vm_unix(size_t, vm_commited);
+    vm_unix(size_t, vm_commited, vm_hugepage = vm_hugepage::none, vm_populate = vm_populate::false_);
     ~vm_unix();
     char * alloc_block();
     bool release(char *);
@@ -119,8 +121,15 @@ public:
         return m_alloc_block_count * block_size;
     }
     size_t commited_size() const {
+        if (m_reserve_adr) {
+            return m_hugepage_count * hugepage_size;
+        }
         return m_alloc_arena_count * arena_size;
     }
+    vm_hugepage hugepage() const {
+        return m_hugepage;
+    }
+    size_t hugepage_used_size() const; // commited memory backed by huge pages
     size_t count_free_arena_list() const;
     size_t count_mixed_arena_list() const;
     size_t arena_brk() const {
@@ -133,7 +142,8 @@ public:
         return m_alloc_arena_count;
     }
     using move_block_fun = std::function<bool(block32 from, block32 to)>;
-    bool defragment(move_block_fun const &);
+    using break_fun = std::function<bool()>; // returns true to interrupt defragment
+    size_t defragment(move_block_fun const &, break_fun const & = nullptr); // returns number of moved blocks
 private:
     char * get_free_block(block_t const &) const; // block NOT allocated
     char * alloc_block_without_count();
@@ -147,8 +157,13 @@ private:
     bool find_free_arena_list(size_t) const;
     bool find_mixed_arena_list(size_t) const;
 #endif
-    char * sys_alloc_arena();
-    bool sys_free_arena(char *);
+    char * sys_alloc_arena(size_t);
+    bool sys_free_arena(char *, size_t);
+    void sys_reserve_hugepage(); // reserve 2 MB aligned address space
+    void sys_commit_hugepage(size_t); // commit 2 MB unit of arenas
+    bool sys_decommit_hugepage(size_t);
+    bool is_hugepage_used(size_t) const; // unit has allocated arena
+    size_t hugepage_set_block_count(size_t) const;
     void alloc_arena_nosort(arena_t &, size_t);
     void alloc_arena(arena_t &, size_t);
     void free_arena(arena_t &, size_t);
@@ -163,8 +178,20 @@ private:
     size_t m_arena_brk = 0;
     arena_index m_free_arena_list; // list of released arena(s)
     arena_index m_mixed_arena_list; // list of arena(s) with allocated and free block(s)
-    size_t m_alloc_block_count = 0;
-    size_t m_alloc_arena_count = 0;
+    std::atomic<size_t> m_alloc_block_count; // can be read without page_bpool mutex
+    std::atomic<size_t> m_alloc_arena_count;
+private:
+    const vm_hugepage m_hugepage;
+    const vm_populate m_populate;
+    char * m_reserve_adr = nullptr; // 2 MB aligned address space if m_hugepage != none
+    size_t m_reserve_size = 0;
+    std::vector<uint8> m_hugetlb; // 2 MB unit is mapped with MAP_HUGETLB
+    std::atomic<size_t> m_hugepage_count; // commited 2 MB units
+    std::atomic<size_t> m_hugetlb_count;
+    enum { smaps_period_ms = 1000 }; // AnonHugePages of /proc/self/smaps are read at most once per period
+    mutable std::atomic<size_t> m_smaps_size{ 0 };
+    mutable std::atomic<int64> m_smaps_time{ 0 }; // steady clock, milliseconds
+    size_t smaps_hugepage_size() const;
 private:
     enum { use_sort_arena = 1 };
     using sort_adr_t = std::vector<arena32>;
@@ -0,0 +1,176 @@
+// warm_cache.cpp
+//
+#include "dataserver/bpool/warm_cache.h"
+#include <fstream>
+
+namespace sdl { namespace db { namespace bpool {
+
+namespace {
+
+#pragma pack(push, 1)
+struct warm_cache_header { // followed by block32 array
+    enum { magic_value = 0x4D524157 }; // "WARM"
+    enum { version_value = 1 };
+    uint32 magic;
+    uint32 version;
+    uint64 filesize; // database file
+    uint64 count; // number of blocks
+};
+#pragma pack(pop)
+
+} // namespace
+
+warm_cache_t::warm_cache_t(load_fun && f, busy_fun && b)
+    : m_load(std::move(f))
+    , m_busy(std::move(b))
+    , m_loaded(0)
+{
+    SDL_ASSERT(m_load);
+    SDL_ASSERT(m_busy);
+}
+
+warm_cache_t::~warm_cache_t()
+{
+    if (m_thread) {
+        shutdown();
+        m_thread.reset(); // join
+    }
+}
+
+void warm_cache_t::shutdown()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_one();
+}
+
+void warm_cache_t::save(std::string const & fname, size_t const filesize, std::vector<block32> const & blocks)
+{
+    const std::string temp = fname + ".tmp";
+    {
+        std::ofstream out(temp, std::ofstream::binary | std::ofstream::trunc);
+        throw_error_if_not_t<warm_cache_t>(out.is_open(), "cannot create warm cache file");
+        warm_cache_header h {};
+        h.magic = warm_cache_header::magic_value;
+        h.version = warm_cache_header::version_value;
+        h.filesize = filesize;
+        h.count = blocks.size();
+        out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+        if (!blocks.empty()) {
+            out.write(reinterpret_cast<char const *>(blocks.data()), blocks.size() * sizeof(block32));
+        }
+        throw_error_if_not_t<warm_cache_t>(out.good(), "cannot write warm cache file");
+    }
+    throw_error_if_t<warm_cache_t>(std::rename(temp.c_str(), fname.c_str()) != 0, "cannot rename warm cache file");
+}
+
+std::vector<warm_cache_t::block32>
+warm_cache_t::load(std::string const & fname, size_t const filesize)
+{
+    std::vector<block32> blocks;
+    std::ifstream in(fname, std::ifstream::binary);
+    if (!in.is_open()) {
+        return blocks;
+    }
+    warm_cache_header h {};
+    in.read(reinterpret_cast<char *>(&h), sizeof(h));
+    if (!in.good() ||
+        (h.magic != warm_cache_header::magic_value) ||
+        (h.version != warm_cache_header::version_value) ||
+        (h.filesize != filesize) || // database was changed
+        (h.count > pool_limits::max_block)) {
+        SDL_TRACE("warm cache ignored: ", fname);
+        return blocks;
+    }
+    blocks.resize(static_cast<size_t>(h.count));
+    if (!blocks.empty()) {
+        in.read(reinterpret_cast<char *>(blocks.data()), blocks.size() * sizeof(block32));
+        if (!in.good()) {
+            SDL_TRACE("warm cache ignored: ", fname);
+            blocks.clear();
+        }
+    }
+    const size_t block_count = round_up_div(filesize, (size_t)pool_limits::block_size);
+    const auto last = std::remove_if(blocks.begin(), blocks.end(), [block_count](block32 const b){
+        return !b || (b >= block_count); // zero block is always in memory
+    });
+    if (last != blocks.end()) {
+        SDL_TRACE("warm cache bad blocks: ", std::distance(last, blocks.end()));
+        blocks.erase(last, blocks.end());
+    }
+    return blocks;
+}
+
+void warm_cache_t::launch(std::vector<block32> && blocks, size_t const max_block)
+{
+    SDL_ASSERT(!m_thread);
+    if (blocks.size() > max_block) { // keep hottest blocks
+        blocks.resize(max_block);
+    }
+    if (blocks.empty()) {
+        return;
+    }
+    std::sort(blocks.begin(), blocks.end()); // file-offset order
+    blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+    m_blocks = std::move(blocks);
+    m_thread.reset(new joinable_thread([this](){
+        this->run_thread();
+    }));
+}
+
+bool warm_cache_t::wait_idle(size_t & busy)
+{
+    enum { idle_ms = 10 };
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;) {
+        if (m_shutdown) {
+            return false;
+        }
+        const size_t now = m_busy();
+        if (now == busy) { // no foreground misses since last batch
+            return true;
+        }
+        busy = now;
+        m_cv.wait_for(lock, std::chrono::milliseconds(idle_ms), [this](){
+            return m_shutdown;
+        });
+    }
+}
+
+void warm_cache_t::run_thread()
+{
+    SDL_TRACE("warm cache started: ", m_blocks.size(), " blocks");
+    try {
+        size_t busy = m_busy();
+        for (size_t i = 0; i < m_blocks.size(); i += batch_size) {
+            if (!wait_idle(busy)) {
+                break;
+            }
+            const size_t count = a_min(m_blocks.size() - i, (size_t)batch_size);
+            bool full = false;
+            m_loaded += m_load(m_blocks.data() + i, count, full); // resident blocks are skipped
+            if (full) {
+                break; // pool can't grow without eviction (max_memory)
+            }
+        }
+    }
+    catch (sdl_exception & e) {
+        SDL_TRACE("warm cache failed: ", e.what());
+    }
+    SDL_TRACE("warm cache finished: ", m_loaded.load(), " blocks");
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            static_assert(sizeof(warm_cache_header) == 24, "");
+        }
+    };
+    static unit_test s_test;
+}
+#endif //#if SDL_DEBUG
+}}} // sdl
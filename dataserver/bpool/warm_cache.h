@@ -0,0 +1,48 @@
+// warm_cache.h
+//
+#pragma once
+#ifndef __SDL_BPOOL_WARM_CACHE_H__
+#define __SDL_BPOOL_WARM_CACHE_H__
+
+#include "dataserver/bpool/block_head.h"
+#include "dataserver/common/thread.h"
+#include <functional>
+#include <condition_variable>
+
+namespace sdl { namespace db { namespace bpool {
+
+// Snapshot of resident blocks (hottest first) saved to side file; 
+// after restart blocks are reloaded on background thread in file-offset order.
+// Prewarm yields to lock_page misses and stops when pool can't grow without eviction.
+class warm_cache_t : noncopyable {
+    using block32 = block_index::block32;
+public:
+    enum { batch_size = 16 }; // blocks per request (1 MB), short delay for foreground misses
+    using load_fun = std::function<size_t(block32 const * realBlock, size_t count, bool & full)>; // returns number of loaded blocks
+    using busy_fun = std::function<size_t()>; // number of foreground misses 
+    warm_cache_t(load_fun &&, busy_fun &&);
+    ~warm_cache_t();
+    static void save(std::string const & fname, size_t filesize, std::vector<block32> const &); // may throw
+    static std::vector<block32> load(std::string const & fname, size_t filesize); // empty if not valid, bad blocks are dropped
+    void launch(std::vector<block32> &&, size_t max_block); // hottest first
+    size_t loaded() const { // blocks read from file
+        return m_loaded;
+    }
+private:
+    void run_thread();
+    void shutdown();
+    bool wait_idle(size_t & busy); // waits while lock_page misses, returns false on shutdown
+private:
+    const load_fun m_load;
+    const busy_fun m_busy;
+    std::vector<block32> m_blocks; // sorted by offset
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_shutdown = false;
+    std::atomic<size_t> m_loaded;
+    std::unique_ptr<joinable_thread> m_thread;
+};
+
+}}} // sdl
+
+#endif // __SDL_BPOOL_WARM_CACHE_H__
@@ -11,7 +11,7 @@ class FileMapping::data_t: noncopyable
     void * m_pFileView = nullptr;
     uint64 m_FileSize = 0;
 public:
-    explicit data_t(const char* filename);
+    data_t(const char* filename, preload);
     ~data_t();
 
     void const * GetFileView() const
@@ -24,7 +24,7 @@ public:
     }
 };
 
-FileMapping::data_t::data_t(const char * const filename)
+FileMapping::data_t::data_t(const char * const filename, preload const pre)
 {
     const uint64 fsize = FileMapping::GetFileSize(filename);
     if (0 == fsize) {
@@ -33,9 +33,14 @@ FileMapping::data_t::data_t(const char * const filename)
         return;
     }
     A_STATIC_CHECK_TYPE(file_map_detail::view_of_file, m_pFileView);
-    m_pFileView = file_map_detail::map_view_of_file(filename, 0, fsize);
+    m_pFileView = file_map_detail::map_view_of_file(filename, 0, fsize, pre == preload::populate);
     if (m_pFileView) {
         m_FileSize = fsize; // success
+        if (pre == preload::lock) {
+            if (!file_map_detail::lock_view_of_file(m_pFileView, m_FileSize)) {
+                SDL_TRACE("lock_view_of_file failed : ", filename); // e.g. RLIMIT_MEMLOCK
+            }
+        }
     }
 }
 
@@ -75,16 +80,26 @@ bool FileMapping::IsFileMapped() const
     return (GetFileView() != nullptr);
 }
 
+bool FileMapping::Advise(uint64 const offset, uint64 const size, advice const a) const
+{
+    if (m_data.get() && size && (offset < m_data->GetFileSize())) {
+        return file_map_detail::advise_view_of_file(
+            const_cast<void *>(m_data->GetFileView()), offset,
+            a_min(size, m_data->GetFileSize() - offset), a);
+    }
+    return false;
+}
+
 void FileMapping::UnmapView()
 {
     m_data.reset();
 }
 
-void const * FileMapping::CreateMapView(const char * const filename)
+void const * FileMapping::CreateMapView(const char * const filename, preload const pre)
 {
     UnmapView();
 
-    std::unique_ptr<data_t> p(new data_t(filename));
+    std::unique_ptr<data_t> p(new data_t(filename, pre));
 
     auto ret = p->GetFileView();
     if (ret) {
@@ -11,11 +11,17 @@ namespace sdl {
 class FileMapping: noncopyable {
     using FileMapping_error = sdl_exception_t<FileMapping>;
 public:
+    enum class preload { none, populate, lock }; // pre-fault or lock whole view in memory
+    enum class advice { normal, sequential, random, willneed, dontneed }; // access pattern of range
+
     FileMapping();
     ~FileMapping();
 
     // Create file mapping for read-only. Returns nullptr if error
-    void const * CreateMapView(const char* filename);
+    void const * CreateMapView(const char* filename, preload = preload::none);
+
+    // Hint for range of view (offset is rounded down to OS page). Returns false if not supported
+    bool Advise(uint64 offset, uint64 size, advice) const;
 
     // Close file mapping
     void UnmapView();
@@ -5,21 +5,22 @@
 #include "dataserver/filesys/file_map_detail.h"
 #include "dataserver/filesys/file_h.h"
 #include "dataserver/filesys/mmap64_unix.h"
+#include <unistd.h>
 
 namespace sdl {
 
 file_map_detail::view_of_file 
 file_map_detail::map_view_of_file(const char* filename,
                                   uint64 const offset,  
-                                  uint64 const size)
+                                  uint64 const size,
+                                  bool const populate)
 {
     A_STATIC_ASSERT_64_BIT; 
 
     SDL_ASSERT(size);
-    SDL_ASSERT(!offset); // current limitation
-    SDL_ASSERT(offset < size);
+    SDL_ASSERT(!(offset % static_cast<uint64>(::sysconf(_SC_PAGESIZE)))); // mmap requires aligned offset
 
-    if (size && (offset < size) && !offset) {
+    if (size) {
 
         FileHandler fp(filename, "rb");
         if (!fp.is_open()) {
@@ -27,9 +28,17 @@ file_map_detail::map_view_of_file(const char* filename,
             SDL_ASSERT(false);
             return nullptr;
         }
+        int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+        if (populate) {
+            flags |= MAP_POPULATE; // read whole file on mmap
+        }
+#else
+        (void)populate;
+#endif
         auto pFileView = mmap64_t::call(
             nullptr, static_cast<size_t>(size), 
-            PROT_READ, MAP_PRIVATE, fileno(fp.get()), 0);
+            PROT_READ, flags, fileno(fp.get()), static_cast<off_t>(offset));
 
         if (pFileView == MAP_FAILED) {
             SDL_TRACE("mmap failed: ", filename);
@@ -48,7 +57,7 @@ bool file_map_detail::unmap_view_of_file(
     uint64 const size)
 {
     if (p) {
-        SDL_ASSERT(offset < size);
+        SDL_ASSERT(size);
         if (::munmap(p, size)) {
             SDL_ASSERT(!"munmap");
         }
@@ -59,6 +68,39 @@ bool file_map_detail::unmap_view_of_file(
     return false;
 }
 
+bool file_map_detail::lock_view_of_file(view_of_file p, uint64 const size)
+{
+    SDL_ASSERT(p && size);
+    return !::mlock(p, static_cast<size_t>(size));
+}
+
+bool file_map_detail::unlock_view_of_file(view_of_file p, uint64 const size)
+{
+    SDL_ASSERT(p && size);
+    return !::munlock(p, static_cast<size_t>(size));
+}
+
+bool file_map_detail::advise_view_of_file(
+    view_of_file p,
+    uint64 const offset,
+    uint64 const size,
+    FileMapping::advice const a)
+{
+    SDL_ASSERT(p && size);
+    static const uint64 os_page = static_cast<uint64>(::sysconf(_SC_PAGESIZE));
+    uint64 const first = offset - offset % os_page; // madvise requires aligned address
+    int advice = MADV_NORMAL;
+    switch (a) {
+    case FileMapping::advice::sequential:   advice = MADV_SEQUENTIAL; break;
+    case FileMapping::advice::random:       advice = MADV_RANDOM; break;
+    case FileMapping::advice::willneed:     advice = MADV_WILLNEED; break;
+    case FileMapping::advice::dontneed:     advice = MADV_DONTNEED; break;
+    default:
+        break;
+    }
+    return !::madvise(static_cast<char *>(p) + first, static_cast<size_t>(offset + size - first), advice);
+}
+
 } // sdl
 
 #if SDL_DEBUG
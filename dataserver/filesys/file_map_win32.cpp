@@ -56,24 +56,26 @@ public:
 file_map_detail::view_of_file 
 file_map_detail::map_view_of_file(const char* filename,
                                   uint64 const offset,  
-                                  uint64 const size)
+                                  uint64 const size,
+                                  bool) // populate is not supported
 {
     A_STATIC_ASSERT_64_BIT;
 
     SDL_ASSERT(size);
-    SDL_ASSERT(!offset); // current limitation
-    SDL_ASSERT(offset < size);
+    SDL_ASSERT(!(offset % kilobyte<64>::value)); // allocation granularity
 
-    if (size && (offset < size) && !offset) {
+    if (size) {
 
         filesize_64 fsize {};
-        fsize.size = size;
+        fsize.size = offset + size; // mapping must include the view
+
+        filesize_64 foffset {};
+        foffset.size = offset;
 
         static_assert(sizeof(DWORD) == 4, "");
         static_assert(sizeof(fsize.size) == 8, "");
         static_assert(sizeof(fsize.d.lo) == 4, "");
         static_assert(sizeof(fsize.d.hi) == 4, "");
-        SDL_ASSERT(fsize.d.lo);
 
         ReadFileHandler file(filename);
         if (!file.is_open()) {
@@ -101,8 +103,9 @@ file_map_detail::map_view_of_file(const char* filename,
         auto pFileView = ::MapViewOfFile(
             hFileMapping,
             FILE_MAP_READ,
-            0, 0,           // file offset where the view begins
-            0);             // mapping extends from the specified offset to the end of the file mapping.
+            foffset.d.hi,   // file offset where the view begins
+            foffset.d.lo,
+            static_cast<SIZE_T>(size));
 
         ::CloseHandle(hFileMapping);
 
@@ -124,7 +127,7 @@ bool file_map_detail::unmap_view_of_file(
         uint64 const size)
 {
     if (p) {
-        SDL_ASSERT(offset < size);
+        SDL_ASSERT(size);
         ::UnmapViewOfFile(p);
         return true;
     }
@@ -133,6 +136,23 @@ bool file_map_detail::unmap_view_of_file(
     return false;
 }
 
+bool file_map_detail::lock_view_of_file(view_of_file p, uint64 const size)
+{
+    SDL_ASSERT(p && size);
+    return ::VirtualLock(p, static_cast<SIZE_T>(size)) != 0; // limited by working set size
+}
+
+bool file_map_detail::unlock_view_of_file(view_of_file p, uint64 const size)
+{
+    SDL_ASSERT(p && size);
+    return ::VirtualUnlock(p, static_cast<SIZE_T>(size)) != 0;
+}
+
+bool file_map_detail::advise_view_of_file(view_of_file, uint64, uint64, FileMapping::advice)
+{
+    return false; // not supported
+}
+
 } // sdl
 
 #if SDL_DEBUG
@@ -128,6 +128,24 @@ void test_sample_table(sample::dbo_table * const table) {
         tab.query.scan_if([](T::record){
             return true;
         });
+        tab.query.scan_if([](T::record){
+            return true;
+        }, datatable::scan_order::allocation);
+        if (1) {
+            size_t count = 0;
+            datatable::parallel_scan_cfg cfg;
+            cfg.ordered = true;
+            tab.query.parallel_scan_if<size_t>([](size_t & result, T::record p){
+                if (p.Id() > 0) {
+                    ++result;
+                }
+                return true;
+            },
+            [&count](size_t && result){
+                count += result;
+                return true;
+            }, cfg);
+        }
         if (auto found = tab->find([](T::record p){
             return p.Id() > 0;
         })) {
@@ -82,6 +82,23 @@ public:
             }
         }
     }
+    template<class fun_type> // scan_order::allocation reads pages in file order, records are not in key order
+    void scan_if(fun_type && fun, datatable::scan_order const order) const {
+        m_table.get_table().scan_head_if(order, [this, &fun](row_head const * const row) {
+            return fun(record(&m_table, row));
+        });
+    }
+    // scan(T &, record const &) -> bool is called by worker threads for ranges of data pages,
+    // results are combined by merge(T &&) -> bool (see datatable::parallel_scan)
+    template<class T, class scan_fun, class merge_fun>
+    void parallel_scan_if(scan_fun && scan, merge_fun && merge, datatable::parallel_scan_cfg const & cfg = {}) const {
+        m_table.get_table().template parallel_scan<T>(
+            [this, &scan](datatable::page_range const & range, T & result) {
+                return is_continue(range.scan_if([this, &scan, &result](row_head const * const row) {
+                    return scan(result, record(&m_table, row));
+                }));
+            }, std::forward<merge_fun>(merge), cfg);
+    }
     template<class fun_type>
     record find(fun_type && fun) const {
         for (record const & p : m_table) { // linear search
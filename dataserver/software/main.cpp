@@ -14,6 +14,8 @@
 #include "dataserver/common/thread.h"
 #include "dataserver/utils/conv.h"
 #include "dataserver/system/page_info.h"
+#include "dataserver/system/page_trace.h"
+#include "dataserver/system/column_batch.h"
 #include <map>
 #include <set>
 #include <fstream>
@@ -92,6 +94,33 @@ struct cmd_option : noncopyable {
     size_t max_memory = 0;
     size_t pool_period = 0;
     size_t pool_defrag = 0;
+    size_t test_lookup = 0;
+    size_t read_ahead = 0;
+    int pool_policy = 0;
+    size_t test_replacement = 0;
+    int hugepage = 0;
+    bool prefault = false;
+    bool pool_stats = false;
+    std::string warm_cache;
+    int pin = 0;
+    std::string pin_tables;
+    size_t checksum_threads = 0;
+    size_t scan_threads = 0;
+    size_t batch_bench = 0;
+    int pool_checksum = 0;
+    bool scan_unlock = false;
+    bool direct_io = false;
+    size_t test_direct_io = 0;
+    int mmap_preload = 0;
+    int mmap_advice = 0;
+    size_t mmap_window = 0;
+    size_t mmap_window_max = 0;
+    std::string page_trace;
+    std::string trace_report;
+    size_t init_threads = 0;
+    bool lazy_catalog = false;
+    std::string catalog_cache;
+    size_t trace_width = 64;
 };
 
 template<class sys_row>
@@ -1131,6 +1160,142 @@ void trace_table_index(db::database const & db, db::datatable & table, cmd_optio
     }
 }
 
+void trace_parallel_scan(db::datatable const & table, cmd_option const & opt)
+{
+    for (bool const ordered : { false, true }) {
+        db::datatable::parallel_scan_cfg cfg;
+        cfg.threads = opt.scan_threads;
+        cfg.ordered = ordered;
+        milliseconds_span timer;
+        size_t count = 0;
+        size_t ranges = 0;
+        table.parallel_scan<size_t>(
+            [](db::datatable::page_range const & range, size_t & result) {
+                range.scan_if([&result](db::row_head const *) {
+                    ++result;
+                    return true;
+                });
+                return true;
+            },
+            [&count, &ranges](size_t && result) {
+                count += result;
+                ++ranges;
+                return true;
+            }, cfg);
+        std::cout << "\nparallel_scan[" << table.name() << "]"
+            << " ordered = " << ordered
+            << " records = " << count
+            << " ranges = " << ranges
+            << " ms = " << timer.now();
+    }
+    milliseconds_span timer;
+    const size_t count = table._record.count();
+    std::cout << "\nsequential_scan[" << table.name() << "]"
+        << " records = " << count
+        << " ms = " << timer.now();
+    {
+        milliseconds_span timer;
+        size_t count = 0;
+        table.scan_head_if(db::datatable::scan_order::allocation, [&count](db::row_head const *) {
+            ++count;
+            return true;
+        });
+        std::cout << "\nallocation_scan[" << table.name() << "]"
+            << " records = " << count
+            << " ms = " << timer.now();
+    }
+}
+
+template<class fun_type> // fun(std::integral_constant<scalartype::type, T>) for numeric fixed column types
+bool for_numeric_type(db::scalartype::type const type, fun_type && fun)
+{
+    using db::scalartype;
+    switch (type) {
+    case scalartype::t_tinyint:     fun(std::integral_constant<scalartype::type, scalartype::t_tinyint>()); break;
+    case scalartype::t_smallint:    fun(std::integral_constant<scalartype::type, scalartype::t_smallint>()); break;
+    case scalartype::t_int:         fun(std::integral_constant<scalartype::type, scalartype::t_int>()); break;
+    case scalartype::t_bigint:      fun(std::integral_constant<scalartype::type, scalartype::t_bigint>()); break;
+    case scalartype::t_real:        fun(std::integral_constant<scalartype::type, scalartype::t_real>()); break;
+    case scalartype::t_float:       fun(std::integral_constant<scalartype::type, scalartype::t_float>()); break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// sum of numeric fixed columns by per-record access and by columnar decode of data pages
+void trace_column_batch(db::datatable const & table, cmd_option const & opt)
+{
+    std::vector<size_t> cols;
+    for (size_t const i : db::column_batch::fixed_columns(table.ut())) {
+        if (for_numeric_type(table.ut()[i].type, [](auto){})) {
+            cols.push_back(i);
+        }
+    }
+    if (cols.empty()) {
+        return;
+    }
+    for (size_t pass = 0; pass < opt.batch_bench; ++pass) {
+        double sum = 0;
+        size_t nulls = 0;
+        size_t rows = 0;
+        milliseconds_span timer;
+        for (auto const record : table._record) {
+            for (size_t const i : cols) {
+                for_numeric_type(record.usercol(i).type, [&record, i, &sum, &nulls](auto type) {
+                    if (auto const p = record.template cast_fixed_col<decltype(type)::value>(i)) {
+                        sum += *p;
+                    }
+                    else {
+                        ++nulls;
+                    }
+                });
+            }
+            ++rows;
+        }
+        std::cout << "\nrecord_scan[" << table.name() << "]"
+            << " columns = " << cols.size()
+            << " rows = " << rows
+            << " nulls = " << nulls
+            << " sum = " << sum
+            << " ms = " << timer.now();
+    }
+    for (size_t pass = 0; pass < opt.batch_bench; ++pass) {
+        double sum = 0;
+        size_t nulls = 0;
+        size_t rows = 0;
+        milliseconds_span timer;
+        db::column_batch batch(table, cols);
+        db::datatable::datapage_access const pages(&table, db::dataType::type::IN_ROW_DATA, db::pageType::type::data);
+        for (db::page_head const * const head : pages) {
+            batch.clear();
+            batch.append(head);
+            for (size_t j = 0; j < batch.column_count(); ++j) {
+                auto const & c = batch[j];
+                for_numeric_type(c.col.type, [&c, &batch, &sum](auto type) {
+                    auto const values = c.template values<decltype(type)::value>();
+                    for (size_t i = 0; i < batch.size(); ++i) { // NULL values are zero
+                        sum += values[i];
+                    }
+                });
+                const size_t words = (batch.size() + db::column_batch::word_bits - 1) / db::column_batch::word_bits;
+                for (size_t i = 0; i < words; ++i) {
+                    for (db::column_batch::word_type w = c.null_bits()[i]; w; w &= w - 1) {
+                        ++nulls;
+                    }
+                }
+            }
+            rows += batch.size();
+        }
+        std::cout << "\ncolumn_batch[" << table.name() << "]"
+            << " columns = " << cols.size()
+            << " rows = " << rows
+            << " nulls = " << nulls
+            << " sum = " << sum
+            << " ms = " << timer.now();
+    }
+}
+
 void trace_datatable(db::database const & db, db::datatable & table, cmd_option const & opt, bool const is_internal)
 {
     enum { trace_iam = 1 };
@@ -1184,6 +1349,12 @@ void trace_datatable(db::database const & db, db::datatable & table, cmd_option
             });
         }
     }
+    if (opt.scan_threads) {
+        trace_parallel_scan(table, opt);
+    }
+    if (opt.batch_bench) {
+        trace_column_batch(table, opt);
+    }
     if (!is_internal) {
         if (opt.record_num) {
             std::cout << "\n\nDATARECORD [" << table.name() << "]";
@@ -2522,6 +2693,264 @@ void test_unlock_thread(db::database const & db, cmd_option const & opt)
 }
 #endif
 
+// concurrent lookup of resident pages, threads = 1, 2, 4 ... test_lookup;
+// hold: pages stay locked by thread, so repeated lookups are served by its own thread mask;
+// unlock: page is unlocked after each lookup, so lookups lock pages which are unlocked or locked by other threads
+void test_lookup(db::database const & db, cmd_option const & opt)
+{
+    enum { lookup_count = 1000000 }; // per thread
+    enum { max_page = megabyte<64>::value / db::page_head::page_size }; // working set
+    const size_t page_count = a_min(db.page_count(), (size_t)max_page);
+    std::cout << "\ntest_lookup pages = " << page_count << std::endl;
+    {
+        unique_thread warm;
+        reset_new(warm, [&db, page_count]() { // working set is resident and unlocked
+            db::database::scoped_thread_lock const lock(db);
+            for (size_t i = 0; i < page_count; ++i) {
+                db::pageIndex const id = static_cast<db::pageFileID::page32>(i);
+                if (db.load_page_head(id)) {
+                    db.unlock_page(id);
+                }
+            }
+        });
+    } // join thread
+    size_t thread_count = 1;
+    for (;;) {
+        for (bool const unlock : { false, true }) {
+            std::atomic<size_t> found(0);
+            const size_t lock_fast = db.pool_stats().lock_fast;
+            milliseconds_span timer;
+            {
+                std::vector<unique_thread> threads(thread_count);
+                size_t seed = 0;
+                for (auto & t : threads) {
+                    reset_new(t, [&db, &found, page_count, seed, unlock]() {
+                        db::database::scoped_thread_lock const lock(db);
+                        uint32 rand = static_cast<uint32>(seed + 1);
+                        size_t count = 0;
+                        for (size_t i = 0; i < lookup_count; ++i) {
+                            rand = rand * 1103515245 + 12345; // LCG
+                            db::pageIndex const id = static_cast<db::pageFileID::page32>((rand >> 8) % page_count);
+                            if (db.load_page_head(id)) {
+                                ++count;
+                                if (unlock) {
+                                    db.unlock_page(id);
+                                }
+                            }
+                        }
+                        found += count;
+                    });
+                    ++seed;
+                }
+            } // join threads
+            const long_long ms = a_max(timer.now(), long_long(1));
+            const size_t total = thread_count * lookup_count;
+            SDL_ASSERT(found == total);
+            std::cout << "threads = " << thread_count
+                << (unlock ? " unlock" : " hold")
+                << " lookups = " << total
+                << " ms = " << ms
+                << " lookups/sec = " << (total * 1000 / ms)
+                << " lock_fast = " << (db.pool_stats().lock_fast - lock_fast)
+                << std::endl;
+        }
+        if (thread_count >= opt.test_lookup) {
+            break;
+        }
+        thread_count = a_min(thread_count * 2, opt.test_lookup);
+    }
+    std::cout << "pool commited = " << db.pool_commited_size() / megabyte<1>::value
+        << " MB hugepage = " << db.pool_hugepage_size() / megabyte<1>::value
+        << " MB" << std::endl;
+}
+
+// full scan of database mixed with Zipf-distributed page lookups, reports hit ratio of lookups;
+// run with --use_page_bpool, --max_memory less than database size and without --read_ahead
+void test_replacement(db::database const & db, cmd_option const & opt)
+{
+    enum { scan_step = 4 }; // scanned pages per lookup
+    enum { max_key = megabyte<256>::value / db::page_head::page_size }; // lookup set
+    const size_t page_count = db.page_count();
+    const size_t key_count = a_min(page_count, (size_t)max_key);
+    std::vector<double> zipf(key_count); // cumulative distribution, s = 1
+    double sum = 0;
+    for (size_t i = 0; i < key_count; ++i) {
+        sum += 1.0 / (i + 1);
+        zipf[i] = sum;
+    }
+    std::cout << "\ntest_replacement pages = " << page_count
+        << " keys = " << key_count
+        << " pool_policy = " << opt.pool_policy
+        << std::endl;
+    milliseconds_span timer;
+    size_t hits = 0;
+    size_t lookups = 0;
+    size_t scanned = 0;
+    unique_thread test;
+    reset_new(test, [&]() {
+        db::database::scoped_thread_lock const lock(db);
+        uint32 rand = 1;
+        size_t scan = 0;
+        for (size_t i = 0; i < opt.test_replacement; ++i) {
+            for (size_t j = 0; j < scan_step; ++j) {
+                db.load_page_head(static_cast<db::pageFileID::page32>(scan));
+                scan = (scan + 1) % page_count;
+                ++scanned;
+            }
+            rand = rand * 1103515245 + 12345; // LCG
+            const double r = sum * (rand >> 8) / double(1 << 24);
+            const size_t key = std::lower_bound(zipf.begin(), zipf.end(), r) - zipf.begin();
+            const size_t page = (key * 7919) % page_count; // scatter keys over file
+            const size_t read_count = db.pool_read_count();
+            db.load_page_head(static_cast<db::pageFileID::page32>(page));
+            if (i >= opt.test_replacement / 4) { // skip warm-up
+                ++lookups;
+                if (read_count == db.pool_read_count()) {
+                    ++hits;
+                }
+            }
+            db.unlock_thread(db::bpool::removef::false_); // allow eviction
+        }
+    });
+    test.reset(); // join thread
+    std::cout << "lookups = " << lookups
+        << " scanned = " << scanned
+        << " hit ratio = " << (lookups ? double(hits) / lookups : 0.0)
+        << " ms = " << timer.now()
+        << std::endl;
+}
+
+// kB value of "key:" line in /proc file (Linux), 0 if not found
+size_t read_proc_kb(const char * const fname, const char * const key)
+{
+    std::ifstream in(fname);
+    std::string line;
+    const size_t len = strlen(key);
+    while (std::getline(in, line)) {
+        if (line.compare(0, len, key) == 0) {
+            return static_cast<size_t>(atoll(line.c_str() + len));
+        }
+    }
+    return 0;
+}
+
+// buffered vs direct_io: miss and hit latency of random page lookups, 
+// growth of process RSS and of OS page cache (run with --use_page_bpool and --max_memory)
+void test_direct_io(db::database const & main_db, cmd_option const & opt)
+{
+    std::cout << "\ntest_direct_io pages = " << opt.test_direct_io << std::endl;
+    for (bool const direct : { false, true }) {
+        db::database_cfg cfg = main_db.cfg();
+        cfg.use_page_bpool = true;
+        cfg.read_ahead = 0;
+        cfg.direct_io = direct;
+        const size_t cache_kb = read_proc_kb("/proc/meminfo", "Cached:");
+        const size_t rss_kb = read_proc_kb("/proc/self/status", "VmRSS:");
+        db::database const db(opt.mdf_file, cfg);
+        if (!db.is_open()) {
+            std::cout << "database open failed" << std::endl;
+            return;
+        }
+        const size_t page_count = db.page_count();
+        size_t miss = 0, miss_us = 0;
+        size_t hit = 0, hit_us = 0;
+        unique_thread test;
+        reset_new(test, [&]() {
+            db::database::scoped_thread_lock const lock(db);
+            std::vector<db::pageFileID::page32> pages(opt.test_direct_io);
+            uint32 rand = 1;
+            for (auto & p : pages) {
+                rand = rand * 1103515245 + 12345; // LCG
+                p = static_cast<db::pageFileID::page32>((rand >> 8) % page_count);
+            }
+            for (size_t pass = 0; pass < 2; ++pass) { // 1st pass loads blocks, 2nd pass finds them resident
+                for (auto const p : pages) {
+                    const size_t read_count = db.pool_read_count();
+                    microseconds_span timer;
+                    db.load_page_head(p);
+                    const size_t us = static_cast<size_t>(timer.now());
+                    if (read_count != db.pool_read_count()) {
+                        ++miss;
+                        miss_us += us;
+                    }
+                    else if (pass) {
+                        ++hit;
+                        hit_us += us;
+                    }
+                }
+            }
+        });
+        test.reset(); // join thread
+        const size_t rss_kb2 = read_proc_kb("/proc/self/status", "VmRSS:");
+        const size_t cache_kb2 = read_proc_kb("/proc/meminfo", "Cached:");
+        std::cout << (db.pool_stats().direct_io ? "direct_io" : "buffered")
+            << ": miss = " << miss
+            << " miss_us = " << (miss ? double(miss_us) / miss : 0.0)
+            << " hit = " << hit
+            << " hit_us = " << (hit ? double(hit_us) / hit : 0.0)
+            << " rss_MB = " << (rss_kb2 - a_min(rss_kb, rss_kb2)) / 1024
+            << " page_cache_MB = " << (cache_kb2 - a_min(cache_kb, cache_kb2)) / 1024
+            << std::endl;
+    }
+}
+
+void trace_pool_stats(db::database const & db)
+{
+    if (!db.use_page_bpool()) {
+        std::cout << "\npool_stats: page_bpool is not used" << std::endl;
+        return;
+    }
+    const db::bpool::pool_stats_t s = db.pool_stats();
+    const size_t MB = megabyte<1>::value;
+    std::cout << "\npool_stats:"
+        << "\nlock_page = " << s.lock_page
+        << "\nlock_fast = " << s.lock_fast
+        << "\nlock_hit = " << s.lock_hit()
+        << "\nlock_miss = " << s.lock_miss
+        << "\nlock_wait = " << s.lock_wait
+        << "\nhit_ratio = " << s.hit_ratio()
+        << "\nread_ahead_block = " << s.read_ahead_block
+        << "\nread_ahead_error = " << s.read_ahead_error
+        << "\nchecksum_page = " << s.checksum_page
+        << "\nchecksum_error = " << s.checksum_error
+        << "\nwarm_block = " << s.warm_block
+        << "\nfile_read = " << s.file.read_count
+        << "\nfile_read_MB = " << s.file.read_bytes / MB
+        << "\nfile_read_time_us = " << s.file.read_time
+        << "\nfile_read_max_us = " << s.file.max_time
+        << "\nmutex_wait = " << s.mutex_wait
+        << "\nmutex_wait_time_us = " << s.mutex_wait_time
+        << "\nevict_alloc = " << s.evict_alloc
+        << "\nevict_explicit = " << s.evict_explicit
+        << "\nevict_hot = " << s.evict_hot
+        << "\ndemote_hot = " << s.demote_hot
+        << "\ndefrag_run = " << s.defrag_run
+        << "\ndefrag_step = " << s.defrag_step
+        << "\ndefrag_preempt = " << s.defrag_preempt
+        << "\ndefrag_moved = " << s.defrag_moved
+        << "\ndefrag_released_MB = " << s.defrag_released / MB
+        << "\nmixed_arena = " << s.mixed_arena
+        << "\nfree_arena = " << s.free_arena
+        << "\nfixed_block = " << s.fixed_block
+        << "\nfixed_MB = " << s.fixed_size / MB
+        << "\nlock_block = " << s.lock_block
+        << "\nunlock_block = " << s.unlock_block
+        << "\nhot_block = " << s.hot_block
+        << "\nfree_block = " << s.free_block
+        << "\nthread = " << s.thread
+        << "\nused_MB = " << s.used_size / MB
+        << "\ncommited_MB = " << s.commited_size / MB
+        << "\nhugepage_MB = " << s.hugepage_size / MB
+        << "\ndirect_io = " << s.direct_io
+        << "\nread latency (us):";
+    for (size_t i = 0; i < db::bpool::file_stats_t::hist_size; ++i) {
+        if (s.file.hist[i]) {
+            std::cout << "\n< " << (size_t(1) << i) << " = " << s.file.hist[i];
+        }
+    }
+    std::cout << std::endl;
+}
+
 void maketables(db::database const & db, cmd_option const & opt)
 {
     if (!opt.out_file.empty()) {
@@ -2630,10 +3059,37 @@ void print_help(int argc, char* argv[])
         << "\n[--create_spatial_index] export database parameter"
         << "\n[--dump_pages]"
         << "\n[--checksum]"
+        << "\n[--checksum_threads] int : number of threads for --checksum"
+        << "\n[--scan_threads] int : count records of tables by parallel scan in file order and in table order"
+        << "\n[--batch_bench] int : number of passes summing numeric columns of tables by records and by column_batch"
+        << "\n[--pool_checksum] 0|1|2 : verify checksum of pages read by page pool (0 = off, 1 = first load, 2 = always)"
+        << "\n[--scan_unlock] 0|1 : page scans unlock the page they leave (bounded pool memory), each copy of iterator holds its page"
+        << "\n[--direct_io] 0|1 : page pool reads file bypassing OS page cache (O_DIRECT, unix only)"
+        << "\n[--test_direct_io] int : number of random pages to compare buffered and direct_io reads"
+        << "\n[--mmap_preload] 0|1|2 : page mapping preload of whole file (0 = none, 1 = populate, 2 = lock)"
+        << "\n[--mmap_advice] 0|1|2 : page mapping access pattern (0 = normal, 1 = sequential, 2 = random)"
+        << "\n[--mmap_window] int : page mapping window in MB, mapped on first touch (0 = whole file)"
+        << "\n[--mmap_window_max] int : page mapping resident windows, cold windows are released (0 = unlimited), limits resident memory, not mapped address space"
+        << "\n[--page_trace] path to binary file of page accesses (page pool or page mapping)"
+        << "\n[--trace_report] path to page trace file : accesses by allocation unit, page type, index level, heatmap and working set"
+        << "\n[--trace_width] int : heatmap columns for --trace_report"
+        << "\n[--init_threads] int : threads to read system tables and build table schemas on open"
+        << "\n[--lazy_catalog] 0|1 : indexes and keys of tables are loaded on first use"
+        << "\n[--catalog_cache] path to side file of resolved catalog, saved on first open and used while it matches database"
         << "\n[--min_memory]"
         << "\n[--max_memory]"
         << "\n[--pool_period]"
         << "\n[--pool_defrag]"
+        << "\n[--read_ahead] int : read-ahead window in blocks of 64 KB (page pool or page mapping scans)"
+        << "\n[--test_lookup] int : max number of threads to test page lookup, pages held or unlocked per lookup"
+        << "\n[--pool_policy] 0|1 : replacement policy of page pool (0 = LRU, 1 = 2Q)"
+        << "\n[--test_replacement] int : number of lookups mixed with full scan to test hit ratio"
+        << "\n[--hugepage] 0|1|2 : huge pages for page pool (0 = none, 1 = transparent, 2 = hugetlb)"
+        << "\n[--prefault] 0|1 : pre-fault commited memory of page pool"
+        << "\n[--pool_stats] 0|1 : dump statistics of page pool"
+        << "\n[--warm_cache] path to file of resident blocks (reloaded on startup, saved on exit)"
+        << "\n[--pin] int : pages fixed in page pool (bit mask: 1 = system tables, 2 = index levels, 4 = spatial index levels, 8 = background)"
+        << "\n[--pin_tables] names of tables to preload and fix in page pool (separated by space)"
         << std::endl;
 }
 
@@ -2715,11 +3171,44 @@ int run_main(cmd_option const & opt)
             << "\nmax_memory = " << opt.max_memory
             << "\npool_period = " << opt.pool_period
             << "\npool_defrag = " << opt.pool_defrag
+            << "\nread_ahead = " << opt.read_ahead
+            << "\ntest_lookup = " << opt.test_lookup
+            << "\npool_policy = " << opt.pool_policy
+            << "\ntest_replacement = " << opt.test_replacement
+            << "\nhugepage = " << opt.hugepage
+            << "\nprefault = " << opt.prefault
+            << "\npool_stats = " << opt.pool_stats
+            << "\nwarm_cache = " << opt.warm_cache
+            << "\npin = " << opt.pin
+            << "\npin_tables = " << opt.pin_tables
+            << "\nchecksum_threads = " << opt.checksum_threads
+            << "\nscan_threads = " << opt.scan_threads
+            << "\nbatch_bench = " << opt.batch_bench
+            << "\npool_checksum = " << opt.pool_checksum
+            << "\nscan_unlock = " << opt.scan_unlock
+            << "\ndirect_io = " << opt.direct_io
+            << "\ntest_direct_io = " << opt.test_direct_io
+            << "\nmmap_preload = " << opt.mmap_preload
+            << "\nmmap_advice = " << opt.mmap_advice
+            << "\nmmap_window = " << opt.mmap_window
+            << "\nmmap_window_max = " << opt.mmap_window_max
+            << "\npage_trace = " << opt.page_trace
+            << "\ntrace_report = " << opt.trace_report
+            << "\ntrace_width = " << opt.trace_width
+            << "\ninit_threads = " << opt.init_threads
+            << "\nlazy_catalog = " << opt.lazy_catalog
+            << "\ncatalog_cache = " << opt.catalog_cache
             << std::endl;
     }
     if (opt.precision) {
         db::to_string::precision(opt.precision);
     }
+    if (!opt.trace_report.empty()) {
+        db::page_trace::report_cfg report;
+        report.width = a_max(opt.trace_width, size_t(1));
+        db::page_trace::report(opt.trace_report, std::cout, report);
+        return EXIT_SUCCESS;
+    }
     if (!opt.export_database.empty()) {
         if (export_database(opt)) {
             return EXIT_SUCCESS;
@@ -2730,6 +3219,49 @@ int run_main(cmd_option const & opt)
     db::database_cfg cfg(opt.min_memory, opt.max_memory);
     cfg.pool_period = opt.pool_period;
     cfg.pool_defrag = opt.pool_defrag;
+    cfg.read_ahead = opt.read_ahead;
+    if (opt.pool_policy) {
+        cfg.replacement = db::database_cfg::replacement_policy::two_queue;
+    }
+    if (opt.hugepage == 1) {
+        cfg.hugepage = db::database_cfg::hugepage_policy::transparent;
+    }
+    else if (opt.hugepage == 2) {
+        cfg.hugepage = db::database_cfg::hugepage_policy::hugetlb;
+    }
+    cfg.prefault = opt.prefault;
+    cfg.warm_cache = opt.warm_cache;
+    cfg.pin.system = (opt.pin & 1) != 0;
+    cfg.pin.index = (opt.pin & 2) != 0;
+    cfg.pin.spatial = (opt.pin & 4) != 0;
+    cfg.pin.background = (opt.pin & 8) != 0;
+    cfg.pin.tables = db::make::util::split(opt.pin_tables);
+    if (opt.pool_checksum == 1) {
+        cfg.checksum = db::database_cfg::checksum_policy::first_load;
+    }
+    else if (opt.pool_checksum == 2) {
+        cfg.checksum = db::database_cfg::checksum_policy::always;
+    }
+    cfg.scan_unlock = opt.scan_unlock;
+    cfg.direct_io = opt.direct_io;
+    if (opt.mmap_preload == 1) {
+        cfg.preload = db::database_cfg::mmap_preload::populate;
+    }
+    else if (opt.mmap_preload == 2) {
+        cfg.preload = db::database_cfg::mmap_preload::lock;
+    }
+    cfg.mmap_window = opt.mmap_window * megabyte<1>::value;
+    cfg.mmap_window_max = opt.mmap_window_max;
+    cfg.page_trace = opt.page_trace;
+    cfg.init_threads = opt.init_threads;
+    cfg.lazy_catalog = opt.lazy_catalog;
+    cfg.catalog_cache = opt.catalog_cache;
+    if (opt.mmap_advice == 1) {
+        cfg.advice = db::database_cfg::mmap_advice::sequential;
+    }
+    else if (opt.mmap_advice == 2) {
+        cfg.advice = db::database_cfg::mmap_advice::random;
+    }
     cfg.use_page_bpool = opt.use_page_bpool;
     db::database m_db(opt.mdf_file, cfg);
     db::database const & db = m_db;
@@ -2738,6 +3270,17 @@ int run_main(cmd_option const & opt)
             << "\ndbi_dbname = " << db.dbi_dbname()
             << "\nuse_page_bpool = " << db.use_page_bpool()
             << std::endl;
+        const db::database::open_time_t t = db.open_time();
+        std::cout << "open_time_ms = " << t.total
+            << " (system = " << t.system
+            << ", usertable = " << t.usertable
+            << ", datatable = " << t.datatable
+            << ", pin = " << t.pin
+            << (t.cached ? ", catalog_cache" : "")
+            << ")" << std::endl;
+        if (opt.direct_io && db.use_page_bpool() && !db.pool_stats().direct_io) {
+            std::cout << "warning: direct_io is not supported, file is read through OS page cache" << std::endl;
+        }
     }
     else {
         std::cerr << "\ndatabase failed: " << db.filename() << std::endl;
@@ -2761,16 +3304,31 @@ int run_main(cmd_option const & opt)
         test_unlock_thread(db, opt);
     }
 #endif
+    if (opt.test_lookup) {
+        test_lookup(db, opt);
+    }
+    if (opt.test_replacement) {
+        test_replacement(db, opt);
+    }
+    if (opt.test_direct_io) {
+        test_direct_io(db, opt);
+    }
     if (opt.checksum) {
         SDL_UTILITY_SCOPE_TIMER_SEC(timer, "checksum seconds = ");
         std::cout << "checksum started" << std::endl;
-        db.scan_checksum([](db::page_head const * const p) {
+        auto const fun = [](db::page_head const * const p) {
             std::cout << "checksum failed at page: "
                 << sdl::db::to_string::type(p->data.pageId)
                 << " tornBits = " << p->data.tornBits
                 << std::endl;
             return true;
-        });
+        };
+        if (opt.checksum_threads) {
+            db.scan_checksum(fun, opt.checksum_threads);
+        }
+        else {
+            db.scan_checksum(fun);
+        }
         std::cout << "checksum ended" << std::endl;
     }
     if (opt.boot_page) {
@@ -2817,7 +3375,7 @@ int run_main(cmd_option const & opt)
         trace_access<db::usertable>(db);
         trace_access<db::datatable>(db);
     }
-    if (opt.alloc_page || opt.record_num) {
+    if (opt.alloc_page || opt.record_num || opt.scan_threads || opt.batch_bench) {
         trace_datatables(db, opt);
     }
     if (!opt.index_key.empty()) {
@@ -2838,6 +3396,9 @@ int run_main(cmd_option const & opt)
     if (!opt.dump_pages.empty()) {
         table_dump_pages_all(db, opt);
     }
+    if (opt.pool_stats) {
+        trace_pool_stats(db);
+    }
     return EXIT_SUCCESS;
 }
 
@@ -2917,6 +3478,33 @@ int run_main(int argc, char* argv[])
     cmd.add(make_option(0, opt.max_memory, "max_memory"));
     cmd.add(make_option(0, opt.pool_period, "pool_period"));
     cmd.add(make_option(0, opt.pool_defrag, "pool_defrag"));
+    cmd.add(make_option(0, opt.read_ahead, "read_ahead"));
+    cmd.add(make_option(0, opt.test_lookup, "test_lookup"));
+    cmd.add(make_option(0, opt.pool_policy, "pool_policy"));
+    cmd.add(make_option(0, opt.test_replacement, "test_replacement"));
+    cmd.add(make_option(0, opt.hugepage, "hugepage"));
+    cmd.add(make_option(0, opt.prefault, "prefault"));
+    cmd.add(make_option(0, opt.pool_stats, "pool_stats"));
+    cmd.add(make_option(0, opt.warm_cache, "warm_cache"));
+    cmd.add(make_option(0, opt.pin, "pin"));
+    cmd.add(make_option(0, opt.pin_tables, "pin_tables"));
+    cmd.add(make_option(0, opt.checksum_threads, "checksum_threads"));
+    cmd.add(make_option(0, opt.scan_threads, "scan_threads"));
+    cmd.add(make_option(0, opt.batch_bench, "batch_bench"));
+    cmd.add(make_option(0, opt.pool_checksum, "pool_checksum"));
+    cmd.add(make_option(0, opt.scan_unlock, "scan_unlock"));
+    cmd.add(make_option(0, opt.direct_io, "direct_io"));
+    cmd.add(make_option(0, opt.test_direct_io, "test_direct_io"));
+    cmd.add(make_option(0, opt.mmap_preload, "mmap_preload"));
+    cmd.add(make_option(0, opt.mmap_advice, "mmap_advice"));
+    cmd.add(make_option(0, opt.mmap_window, "mmap_window"));
+    cmd.add(make_option(0, opt.mmap_window_max, "mmap_window_max"));
+    cmd.add(make_option(0, opt.page_trace, "page_trace"));
+    cmd.add(make_option(0, opt.trace_report, "trace_report"));
+    cmd.add(make_option(0, opt.trace_width, "trace_width"));
+    cmd.add(make_option(0, opt.init_threads, "init_threads"));
+    cmd.add(make_option(0, opt.lazy_catalog, "lazy_catalog"));
+    cmd.add(make_option(0, opt.catalog_cache, "catalog_cache"));
     try {
         if (argc == 1) {
             print_help(argc, argv);
@@ -2924,7 +3512,7 @@ int run_main(int argc, char* argv[])
             return EXIT_SUCCESS;
         }
         cmd.process(argc, argv);
-        if (opt.mdf_file.empty() && opt.export_database.empty()) {
+        if (opt.mdf_file.empty() && opt.export_database.empty() && opt.trace_report.empty()) {
             throw std::string("Missing input file");
         }
     }
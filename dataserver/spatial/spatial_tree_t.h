@@ -36,7 +36,7 @@ private:
     static bool is_data(page_head const *);
     using spatial_datapage = datapage_t<spatial_page_row>; // leaf level
     using unique_datapage = std::unique_ptr<spatial_datapage>;
-    class datapage_access: noncopyable {
+    class datapage_access: noncopyable { // iterator holds scan lock of current page, see database_cfg::scan_unlock
         using state_type = page_head const *;
         spatial_tree_t * const tree;
     public:
@@ -45,8 +45,7 @@ private:
             SDL_ASSERT(tree);
         }
         iterator begin() const {
-            page_head const * p = tree->min_page();
-            return iterator(this, std::move(p));
+            return iterator(this, fwd::scan_lock_page(tree->this_db, tree->min_page()->data.pageId));
         }
         iterator end() const {
             return iterator(this, nullptr);
@@ -56,6 +55,12 @@ private:
         static unique_datapage dereference(state_type p) {
             return std::make_unique<spatial_datapage>(p);
         }
+        bool scan_pin(state_type p) const {
+            return fwd::scan_pin_page(tree->this_db, p);
+        }
+        bool scan_unpin(state_type p) const {
+            return fwd::scan_unlock_page(tree->this_db, p);
+        }
         void load_next(state_type &) const;
         void load_prev(state_type &) const;
         static bool is_end(state_type p) {
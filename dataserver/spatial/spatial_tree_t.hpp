@@ -52,7 +52,7 @@ bool spatial_tree_t<KEY_TYPE>::is_data(page_head const * const h)
 template<typename KEY_TYPE> inline
 void spatial_tree_t<KEY_TYPE>::datapage_access::load_next(state_type & p) const
 {
-    p = fwd::load_next_head(tree->this_db, p);
+    p = fwd::scan_next_head(tree->this_db, p); // cached min_page and max_page stay locked by tree
 }
 
 template<typename KEY_TYPE> inline
@@ -61,10 +61,10 @@ void spatial_tree_t<KEY_TYPE>::datapage_access::load_prev(state_type & p) const
     if (p) {
         SDL_ASSERT(p != tree->min_page());
         SDL_ASSERT(p->data.prevPage);
-        p = fwd::load_prev_head(tree->this_db, p);
+        p = fwd::scan_prev_head(tree->this_db, p);
     }
     else {
-        p = tree->max_page();
+        p = fwd::scan_lock_page(tree->this_db, tree->max_page()->data.pageId);
     }
 }
 
@@ -0,0 +1,371 @@
+// catalog_cache.cpp
+//
+#include "dataserver/system/database.h"
+#include "dataserver/system/database_impl.h"
+#include "dataserver/system/primary_key.h"
+#include <fstream>
+
+namespace sdl { namespace db {
+
+namespace {
+
+#pragma pack(push, 1)
+struct catalog_header { // followed by catalog records
+    enum { magic_value = 0x47544143 }; // "CATG"
+    enum { version_value = 1 };
+    uint32 magic;
+    uint32 version;
+    uint64 filesize;    // database file
+    uint64 identity;    // hash of file header page and boot page
+    uint64 size;        // bytes of records
+};
+#pragma pack(pop)
+
+} // namespace
+
+class database::catalog_cache::writer {
+    sys_index const & m_sys;
+    std::vector<char> m_buf;
+public:
+    explicit writer(sys_index const & s): m_sys(s) {}
+    std::vector<char> const & data() const {
+        return m_buf;
+    }
+    template<class T>
+    void put(T const & value) {
+        static_assert(std::is_pod<T>::value, "");
+        char const * const p = reinterpret_cast<char const *>(&value);
+        m_buf.insert(m_buf.end(), p, p + sizeof(T));
+    }
+    void put_row(void const * const row) { // row of system table
+        recordID id{};
+        if (row) {
+            auto const it = m_sys.location.find(row);
+            throw_error_if_t<catalog_cache>(it == m_sys.location.end(), "row location not found");
+            id = it->second;
+        }
+        put(id);
+    }
+    void put_page(page_head const * const p) {
+        put(p ? p->data.pageId : pageFileID{});
+    }
+};
+
+class database::catalog_cache::reader {
+    database const & m_db;
+    char const * m_pos;
+    char const * const m_end;
+public:
+    reader(database const & db, char const * const first, char const * const last)
+        : m_db(db), m_pos(first), m_end(last) {
+        SDL_ASSERT(m_pos <= m_end);
+    }
+    bool eof() const {
+        return m_pos == m_end;
+    }
+    template<class T>
+    T get() {
+        static_assert(std::is_pod<T>::value, "");
+        throw_error_if_t<catalog_cache>(static_cast<size_t>(m_end - m_pos) < sizeof(T), "unexpected end of file");
+        T value;
+        memcpy(&value, m_pos, sizeof(T));
+        m_pos += sizeof(T);
+        return value;
+    }
+    page_head const * get_page() { // nullptr if null page was saved
+        pageFileID const id = get<pageFileID>();
+        if (id.is_null()) {
+            return nullptr;
+        }
+        throw_error_if_t<catalog_cache>(id.pageId >= m_db.page_count(), "bad page");
+        page_head const * const p = m_db.load_page_head(id);
+        throw_error_if_not_t<catalog_cache>(p && (p->data.pageId == id), "bad page");
+        return p;
+    }
+    template<class row_type>
+    row_type const * get_row() { // nullptr if null row was saved
+        recordID const id = get<recordID>();
+        if (id.id.is_null()) {
+            return nullptr;
+        }
+        throw_error_if_t<catalog_cache>(id.id.pageId >= m_db.page_count(), "bad row page");
+        page_head const * const p = m_db.load_page_head(id.id);
+        throw_error_if_not_t<catalog_cache>(p && p->is_data(), "bad row page");
+        const datapage data(p);
+        throw_error_if_not_t<catalog_cache>(id.slot < data.size(), "bad row slot");
+        row_head const * const row = data[id.slot];
+        throw_error_if_not_t<catalog_cache>(row != nullptr, "bad row");
+        return reinterpret_cast<row_type const *>(row);
+    }
+    template<class row_type>
+    row_type const * get_row_not_null() {
+        row_type const * const row = get_row<row_type>();
+        throw_error_if_not_t<catalog_cache>(row != nullptr, "null row");
+        return row;
+    }
+};
+
+uint64 database::catalog_cache::identity(database const & db)
+{
+    uint64 hash = 14695981039346656037ULL; // FNV-1a
+    for (sysPage const id : { sysPage::file_header, sysPage::boot_page }) {
+        page_head const * const p = db.load_page_head(id);
+        throw_error_if_not_t<catalog_cache>(p != nullptr, "cannot load page");
+        uint8 const * const first = reinterpret_cast<uint8 const *>(p);
+        for (size_t i = 0; i < page_head::page_size; ++i) {
+            hash ^= first[i];
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+// records: catalog ids, user tables, internal tables, values published in catalog entries;
+// cluster indexes and data page access are rebuilt from primary keys and table schemas
+void database::catalog_cache::save(database const & db)
+{
+    std::string const & fname = db.cfg().catalog_cache;
+    SDL_ASSERT(!fname.empty());
+    try {
+        writer out(db.sys());
+        auto const & ids = db.m_data->catalog_ids();
+        out.put(static_cast<uint32>(ids.size()));
+        for (schobj_id const id : ids) {
+            out.put(id);
+        }
+        for (auto const & tables : { db._usertables.tables, db._internals.tables }) {
+            out.put(static_cast<uint32>(tables->size()));
+            for (auto const & table : *tables) {
+                out.put_row(table->schobj);
+                out.put(static_cast<uint32>(table->size()));
+                for (auto const & col : table->schema()) {
+                    out.put_row(col->colpar);
+                    out.put_row(col->scalar);
+                }
+            }
+        }
+        db.m_data->for_each_entry([&out](schobj_id, auto const & e){
+            for (size_t t = 0; t < dataType::size; ++t) {
+                if (auto const p = e.sysalloc[t].get()) {
+                    out.put(uint8(1));
+                    out.put(static_cast<uint32>((*p)->size()));
+                    for (auto const row : **p) {
+                        out.put_row(row);
+                    }
+                }
+                else {
+                    out.put(uint8(0));
+                }
+            }
+            for (size_t t = 0; t < pageType::size; ++t) {
+                if (auto const p = e.index[t].get()) {
+                    out.put(uint8(1));
+                    out.put_page(p->pgroot());
+                    out.put_page(p->pgfirst());
+                }
+                else {
+                    out.put(uint8(0));
+                }
+            }
+            if (auto const p = e.primary.get()) {
+                if (primary_key const * const PK = p->get()) {
+                    out.put(uint8(2));
+                    out.put_page(PK->root);
+                    out.put_row(PK->idxstat);
+                    out.put(static_cast<uint32>(PK->size()));
+                    for (size_t i = 0; i < PK->size(); ++i) {
+                        out.put_row(PK->colpar[i]);
+                        out.put_row(PK->scalar[i]);
+                        out.put(static_cast<uint8>(PK->order[i]));
+                    }
+                }
+                else {
+                    out.put(uint8(1)); // table without primary key
+                }
+            }
+            else {
+                out.put(uint8(0));
+            }
+            if (auto const p = e.spatial_tree.get()) {
+                out.put(uint8(1));
+                out.put_page(p->pgroot);
+                out.put_row(p->idx);
+            }
+            else {
+                out.put(uint8(0));
+            }
+        });
+        const std::string temp = fname + ".tmp";
+        {
+            std::ofstream file(temp, std::ofstream::binary | std::ofstream::trunc);
+            throw_error_if_not_t<catalog_cache>(file.is_open(), "cannot create catalog cache file");
+            catalog_header h {};
+            h.magic = catalog_header::magic_value;
+            h.version = catalog_header::version_value;
+            h.filesize = FileMapping::GetFileSize(db.filename());
+            h.identity = identity(db);
+            h.size = out.data().size();
+            file.write(reinterpret_cast<char const *>(&h), sizeof(h));
+            file.write(out.data().data(), out.data().size());
+            throw_error_if_not_t<catalog_cache>(file.good(), "cannot write catalog cache file");
+        }
+        throw_error_if_t<catalog_cache>(std::rename(temp.c_str(), fname.c_str()) != 0, "cannot rename catalog cache file");
+        SDL_TRACE("catalog cache saved: ", fname);
+    }
+    catch (sdl_exception & e) {
+        SDL_TRACE("save catalog cache failed: ", e.what());
+    }
+}
+
+bool database::catalog_cache::load(database & db)
+{
+    std::string const & fname = db.cfg().catalog_cache;
+    SDL_ASSERT(!fname.empty());
+    SDL_ASSERT(!db.m_data->initialized);
+    if (!std::ifstream(fname, std::ifstream::binary).is_open()) {
+        return false; // saved after open
+    }
+    using table_columns = std::pair<sysschobjs_row const *, usertable::columns>;
+    struct entry_type { // values read from file, published if whole file is valid
+        std::pair<bool, shared_sysallocunits> sysalloc[dataType::size];
+        std::pair<bool, pgroot_pgfirst> index[pageType::size];
+        std::pair<bool, shared_primary_key> primary;
+        std::pair<bool, spatial_tree_idx> spatial_tree;
+    };
+    std::vector<schobj_id> ids;
+    std::vector<table_columns> tables[2]; // user and internal tables
+    std::vector<entry_type> entries;
+    try {
+        FileMapping fmap;
+        char const * const view = static_cast<char const *>(fmap.CreateMapView(fname.c_str()));
+        throw_error_if_not_t<catalog_cache>(view != nullptr, "cannot map file");
+        const uint64 size = fmap.GetFileSize();
+        throw_error_if_t<catalog_cache>(size < sizeof(catalog_header), "bad header");
+        catalog_header const * const h = reinterpret_cast<catalog_header const *>(view);
+        if ((h->magic != catalog_header::magic_value) ||
+            (h->version != catalog_header::version_value) ||
+            (h->size != size - sizeof(catalog_header)) ||
+            (h->filesize != FileMapping::GetFileSize(db.filename())) ||
+            (h->identity != identity(db))) { // database was changed
+            SDL_TRACE("catalog cache ignored: ", fname);
+            return false;
+        }
+        reader in(db, view + sizeof(catalog_header), view + size);
+        ids.resize(in.get<uint32>());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            ids[i] = in.get<schobj_id>();
+            throw_error_if_t<catalog_cache>(i && !(ids[i - 1]._32 < ids[i]._32), "bad catalog id"); // see init_catalog
+        }
+        for (size_t k = 0; k < count_of(tables); ++k) {
+            tables[k].resize(in.get<uint32>());
+            for (auto & t : tables[k]) {
+                t.first = in.get_row_not_null<sysschobjs_row>();
+                throw_error_if_not_t<catalog_cache>(k ? t.first->is_INTERNAL_TABLE() : t.first->is_USER_TABLE(), "bad table");
+                const size_t count = in.get<uint32>();
+                throw_error_if_not_t<catalog_cache>(count, "table without columns");
+                for (size_t i = 0; i < count; ++i) {
+                    auto const colpar = in.get_row_not_null<syscolpars_row>();
+                    auto const scalar = in.get_row_not_null<sysscalartypes_row>();
+                    throw_error_if_not_t<catalog_cache>(colpar->data.id._32 == t.first->data.id._32, "bad column");
+                    throw_error_if_not_t<catalog_cache>(sys_index::key(scalar->data.id) == sys_index::key(colpar->data.utype), "bad column type");
+                    usertable::emplace_back(t.second, colpar, scalar);
+                }
+            }
+        }
+        entries.resize(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            schobj_id const id = ids[i];
+            entry_type & e = entries[i];
+            for (size_t t = 0; t < dataType::size; ++t) {
+                if ((e.sysalloc[t].first = (in.get<uint8>() != 0))) {
+                    e.sysalloc[t].second = std::make_shared<vector_sysallocunits_row>(in.get<uint32>());
+                    for (auto & row : *e.sysalloc[t].second) {
+                        row = in.get_row_not_null<sysallocunits_row>();
+                        throw_error_if_not_t<catalog_cache>(row->data.pgfirstiam &&
+                            (row->data.type == static_cast<dataType::type>(t)), "bad sysallocunits row");
+                    }
+                }
+            }
+            for (size_t t = 0; t < pageType::size; ++t) {
+                if ((e.index[t].first = (in.get<uint8>() != 0))) {
+                    auto const pgroot = in.get_page();
+                    auto const pgfirst = in.get_page();
+                    throw_error_if_t<catalog_cache>(!pgroot != !pgfirst, "bad pgroot_pgfirst");
+                    throw_error_if_t<catalog_cache>(pgfirst && (pgfirst->data.type != static_cast<pageType::type>(t)), "bad pgfirst");
+                    e.index[t].second = pgroot_pgfirst(pgroot, pgfirst);
+                }
+            }
+            const uint8 primary = in.get<uint8>();
+            if ((e.primary.first = (primary != 0)) && (primary > 1)) {
+                auto const root = in.get_page();
+                auto const idxstat = in.get_row_not_null<sysidxstats_row>();
+                throw_error_if_not_t<catalog_cache>(root && (idxstat->data.id._32 == id._32), "bad primary key");
+                const size_t count = in.get<uint32>();
+                throw_error_if_not_t<catalog_cache>(count, "bad primary key");
+                primary_key::colpars idx_col(count);
+                primary_key::scalars idx_scal(count);
+                primary_key::orders idx_ord(count);
+                for (size_t j = 0; j < count; ++j) {
+                    idx_col[j] = in.get_row_not_null<syscolpars_row>();
+                    idx_scal[j] = in.get_row_not_null<sysscalartypes_row>();
+                    const uint8 order = in.get<uint8>();
+                    throw_error_if_not_t<catalog_cache>((idx_col[j]->data.id._32 == id._32) &&
+                        (order <= static_cast<uint8>(sortorder::DESC)), "bad primary key column");
+                    idx_ord[j] = static_cast<sortorder>(order);
+                }
+                reset_new(e.primary.second, root, idxstat,
+                    std::move(idx_col),
+                    std::move(idx_scal),
+                    std::move(idx_ord),
+                    id);
+            }
+            if ((e.spatial_tree.first = (in.get<uint8>() != 0))) {
+                e.spatial_tree.second.pgroot = in.get_page();
+                e.spatial_tree.second.idx = in.get_row<sysidxstats_row>();
+                throw_error_if_t<catalog_cache>(e.spatial_tree.second.idx &&
+                    (e.spatial_tree.second.idx->data.id._32 != id._32), "bad spatial tree");
+            }
+        }
+        throw_error_if_not_t<catalog_cache>(in.eof(), "unexpected data");
+    }
+    catch (sdl_exception & e) {
+        SDL_TRACE("catalog cache ignored: ", fname, " : ", e.what());
+        return false;
+    }
+    shared_data & data = *db.m_data;
+    data.init_catalog(ids);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        schobj_id const id = ids[i];
+        entry_type const & e = entries[i];
+        for (size_t t = 0; t < dataType::size; ++t) {
+            if (e.sysalloc[t].first) {
+                data.set_sysalloc(id, static_cast<dataType::type>(t), e.sysalloc[t].second);
+            }
+        }
+        for (size_t t = 0; t < pageType::size; ++t) {
+            if (e.index[t].first) {
+                data.set_pg_index(id, static_cast<pageType::type>(t), e.index[t].second);
+            }
+        }
+        if (e.primary.first) {
+            data.set_primary_key(id, e.primary.second);
+        }
+        if (e.spatial_tree.first) {
+            data.set_spatial_tree(id, e.spatial_tree.second);
+        }
+    }
+    shared_usertables result[2] = { data.usertable(), data.internal() };
+    for (size_t k = 0; k < count_of(tables); ++k) {
+        SDL_ASSERT(result[k]->empty());
+        result[k]->reserve(tables[k].size());
+        for (auto & t : tables[k]) {
+            primary_key const * const PK = db.get_primary_key(t.first->data.id).get();
+            result[k]->push_back(std::make_shared<usertable>(t.first, std::move(t.second), PK));
+        }
+    }
+    SDL_TRACE("catalog cache loaded: ", fname);
+    return true;
+}
+
+} // db
+} // sdl
@@ -0,0 +1,143 @@
+// column_batch.cpp
+//
+#include "dataserver/system/column_batch.h"
+#include "dataserver/system/database.h"
+
+namespace sdl { namespace db {
+
+column_batch::column_type::column_type(usertable const & ut, size_t const i)
+    : col(ut[i])
+    , index(i)
+    , place(ut.place(i))
+    , offset(ut.fixed_offset(i))
+    , width(ut[i].fixed_size())
+{
+    SDL_ASSERT(width);
+}
+
+column_batch::column_batch(datatable const & table, std::vector<size_t> const & cols)
+    : m_table(table)
+{
+    usertable const & ut = m_table.ut();
+    m_col.reserve(cols.size());
+    for (size_t const i : cols) {
+        throw_error_if_t<column_batch>(i >= ut.size(), "bad column");
+        throw_error_if_not_t<column_batch>(ut[i].is_fixed(), "column is not fixed");
+        m_col.emplace_back(ut, i);
+    }
+}
+
+std::vector<size_t> column_batch::fixed_columns(usertable const & ut)
+{
+    std::vector<size_t> cols;
+    for (size_t i = 0; i < ut.size(); ++i) {
+        if (ut.is_fixed(i)) {
+            cols.push_back(i);
+        }
+    }
+    return cols;
+}
+
+void column_batch::clear()
+{
+    for (column_type & c : m_col) {
+        c.m_data.clear();
+        c.m_null.clear();
+    }
+    m_size = 0;
+}
+
+// same result as datatable::record_type::is_null, columns added after record was written are NULL
+inline bool column_batch::is_null(row_head const * const row, column_type const & c)
+{
+    if (sizeof(row_head) + c.offset + c.width > row->data.fixedlen) {
+        return true;
+    }
+    if (row->has_null()) {
+        const char * const p = row->begin() + row->data.fixedlen; // null_bitmap
+        const size_t count = *reinterpret_cast<uint16 const *>(p);
+        if (c.place >= count) {
+            return true;
+        }
+        return 0 != (p[sizeof(uint16) + (c.place >> 3)] & (1 << (c.place & 7)));
+    }
+    return false;
+}
+
+template<size_t width> // width is known at compile time (= 0 if not) so memcpy is single load/store
+void column_batch::decode_t(column_type & c, size_t const first, std::vector<row_head const *> const & rows)
+{
+    SDL_ASSERT(!width || (c.width == width));
+    const size_t w = width ? width : c.width;
+    char * dest = reinterpret_cast<char *>(c.m_data.data()) + first * w;
+    size_t n = first;
+    for (row_head const * const row : rows) {
+        if (is_null(row, c)) {
+            memset(dest, 0, w);
+            c.m_null[n / word_bits] |= word_type(1) << (n % word_bits);
+        }
+        else {
+            memcpy(dest, row->begin() + sizeof(row_head) + c.offset, w);
+        }
+        dest += w;
+        ++n;
+    }
+}
+
+void column_batch::decode(column_type & c, size_t const first, std::vector<row_head const *> const & rows)
+{
+    switch (c.width) {
+    case 1: return decode_t<1>(c, first, rows);
+    case 2: return decode_t<2>(c, first, rows);
+    case 4: return decode_t<4>(c, first, rows);
+    case 8: return decode_t<8>(c, first, rows);
+    default:
+        return decode_t<0>(c, first, rows);
+    }
+}
+
+size_t column_batch::append(page_head const * const head)
+{
+    SDL_ASSERT(head);
+    if (!head->is_data() || !head->data.slotCnt) {
+        return 0;
+    }
+    m_rows.clear();
+    const datapage page(head);
+    const size_t slot_count = page.size();
+    for (size_t slot = 0; slot < slot_count; ++slot) {
+        row_head const * const row = page[slot];
+        if (row && row->use_record()) {
+            m_rows.push_back(row);
+        }
+    }
+    const size_t count = m_rows.size();
+    if (count) {
+        const size_t rows = m_size + count;
+        for (column_type & c : m_col) { // one column at a time
+            c.m_data.resize((rows * c.width + sizeof(word_type) - 1) / sizeof(word_type));
+            c.m_null.resize((rows + word_bits - 1) / word_bits, 0);
+            decode(c, m_size, m_rows);
+        }
+        m_size = rows;
+    }
+    return count;
+}
+
+size_t column_batch::append(datatable::page_range const & range)
+{
+    size_t count = 0;
+    range.for_page_if([this, &count](pageFileID const & id) {
+        if (page_head const * const head = m_table.db->load_page_head(id)) {
+            count += append(head);
+        }
+        else {
+            SDL_ASSERT(0);
+        }
+        return true;
+    });
+    return count;
+}
+
+} // db
+} // sdl
@@ -0,0 +1,81 @@
+// column_batch.h
+//
+#pragma once
+#ifndef __SDL_SYSTEM_COLUMN_BATCH_H__
+#define __SDL_SYSTEM_COLUMN_BATCH_H__
+
+#include "dataserver/system/datatable.h"
+
+namespace sdl { namespace db {
+
+// Fixed-width columns of data pages decoded into contiguous arrays, one array per column.
+// Rows are appended in slot order of pages, forwarding stubs and ghost records are skipped (see row_head::use_record).
+// Values of NULL columns are zero filled; null bitmap has one bit per row (1 = NULL).
+class column_batch : noncopyable {
+    using batch_error = sdl_exception_t<column_batch>;
+public:
+    using word_type = uint64; // storage unit of values and null bitmap (8-byte aligned)
+    enum { word_bits = sizeof(word_type) * 8 };
+    class column_type {
+        friend column_batch;
+        std::vector<word_type> m_data;
+        std::vector<word_type> m_null;
+    public:
+        usertable::column const & col;
+        size_t const index;     // in usertable
+        size_t const place;     // in null bitmap of record
+        size_t const offset;    // in fixed data of record
+        size_t const width;     // bytes per value
+        column_type(usertable const &, size_t);
+        const char * data() const { // size() * width bytes
+            return reinterpret_cast<const char *>(m_data.data());
+        }
+        template<scalartype::type type>
+        scalartype_t<type> const * values() const {
+            SDL_ASSERT(col.type == type);
+            SDL_ASSERT(sizeof(scalartype_t<type>) == width);
+            return reinterpret_cast<scalartype_t<type> const *>(m_data.data());
+        }
+        word_type const * null_bits() const {
+            return m_null.data();
+        }
+        bool is_null(size_t const row) const {
+            return 0 != (m_null[row / word_bits] & (word_type(1) << (row % word_bits)));
+        }
+    };
+public:
+    column_batch(datatable const &, std::vector<size_t> const &); // throws if column is not fixed
+    static std::vector<size_t> fixed_columns(usertable const &);
+
+    size_t size() const { // # of rows
+        return m_size;
+    }
+    bool empty() const {
+        return 0 == m_size;
+    }
+    size_t column_count() const {
+        return m_col.size();
+    }
+    column_type const & operator[](size_t const i) const {
+        SDL_ASSERT(i < m_col.size());
+        return m_col[i];
+    }
+    void clear(); // memory is kept for next pages
+    size_t append(page_head const *); // returns # of rows added, pages of other types are ignored
+    size_t append(datatable::page_range const &);
+private:
+    static bool is_null(row_head const *, column_type const &);
+    template<size_t width> static
+    void decode_t(column_type &, size_t, std::vector<row_head const *> const &);
+    static void decode(column_type &, size_t, std::vector<row_head const *> const &);
+private:
+    datatable const & m_table;
+    std::vector<column_type> m_col;
+    std::vector<row_head const *> m_rows; // records of current page
+    size_t m_size = 0;
+};
+
+} // db
+} // sdl
+
+#endif // __SDL_SYSTEM_COLUMN_BATCH_H__
@@ -3,35 +3,208 @@
 #include "dataserver/system/database.h"
 #include "dataserver/system/database_fwd.h"
 #include "dataserver/system/database_impl.h"
+#include "dataserver/common/time_util.h"
 
 namespace sdl { namespace db {
 
 database::database(const std::string & fname, database_cfg const & cfg)
     : m_data(std::make_unique<shared_data>(fname, cfg))
 {
+    milliseconds_span total;
     init_database();
+    milliseconds_span pin;
+    init_pin();
+    m_data->open_time.pin = static_cast<size_t>(pin.now());
+    m_data->open_time.total = static_cast<size_t>(total.now());
 }
 
 database::~database()
 {
+    m_data->pin_shutdown = true;
+    m_data->pin_thread.reset(); // join
 }
 
 void database::init_database()
 {
+    open_time_t & time = m_data->open_time;
+    milliseconds_span span;
+    time.cached = !cfg().catalog_cache.empty() && catalog_cache::load(*this);
+    if (!time.cached) {
+        init_catalog();
+    }
+    time.system = static_cast<size_t>(span.now_reset());
+
     _usertables.init(get_usertables());
     _internals.init(get_internals());
-    _datatables.init(get_datatables());
+    m_data->usertable_index.init(*_usertables.tables);
+    m_data->internal_index.init(*_internals.tables);
+    time.usertable = static_cast<size_t>(span.now_reset());
 
-    for (auto const & ut : _usertables) {
-        init_datatable(ut);
+    if (cfg().lazy_catalog) {
+        _datatables.init_lazy(this);
     }
-    for (auto const & ut : _internals) {
-        init_datatable(ut);
+    else {
+        vector_shared_usertable all(_usertables.begin(), _usertables.end());
+        all.insert(all.end(), _internals.begin(), _internals.end());
+        parallel_for(all.size(), [this, &all](size_t const i){
+            this->init_datatable(all[i]);
+        });
+        _datatables.init(get_datatables());
     }
+    time.datatable = static_cast<size_t>(span.now_reset());
     m_data->initialized = true;
+    if (!time.cached && !cfg().catalog_cache.empty()) {
+        catalog_cache::save(*this);
+    }
     SDL_TRACE(__FUNCTION__, ": [", dbi_dbname(), "]");
 }
 
+// fun(i) is called for i in [0, count) by database_cfg::init_threads workers;
+// pages locked by workers are fixed in pool memory as if locked by init thread.
+template<class fun_type>
+void database::parallel_for(size_t const count, fun_type const & fun) const
+{
+    const size_t threads = a_min(cfg().init_threads, count);
+    if (threads < 2) {
+        for (size_t i = 0; i < count; ++i) {
+            fun(i);
+        }
+        return;
+    }
+    std::atomic<size_t> next(0);
+    std::atomic_bool stop(false);
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    auto worker = [this, count, &fun, &next, &stop, &error_mutex, &error]() {
+        try {
+            bpool::page_bpool::fixed_scope const scope(m_data->cpool());
+            size_t i;
+            while (!stop && ((i = next++) < count)) {
+                fun(i);
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+        }
+    };
+    {
+        std::vector<std::unique_ptr<joinable_thread>> pool(threads);
+        for (auto & t : pool) {
+            reset_new(t, worker);
+        }
+    } // join
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+namespace {
+template<class T, class rows_type>
+void load_sys_rows(T const & obj, rows_type & rows) {
+    for (auto & p : obj) {
+        p->for_row([&rows](typename rows_type::value_type row){
+            rows.push_back(row);
+        });
+    }
+}
+template<class T, class map_type>
+void load_sys_location(T const & obj, map_type & location) {
+    for (auto & p : obj) {
+        for (size_t slot = 0; slot < p->size(); ++slot) {
+            location.emplace((*p)[slot], recordID::init(p->head->data.pageId, slot));
+        }
+    }
+}
+} // namespace
+
+void database::init_sys_index() const
+{
+    const bpool::page_bpool::fixed_scope scope(m_data->cpool()); // index keeps row pointers
+    sys_index & index = m_data->sys;
+    sys_index::rows<syscolpars> colpars;
+    sys_index::rows<sysidxstats> idxstats;
+    sys_index::rows<sysallocunits> allocunits;
+    sys_index::rows<sysiscols> iscols;
+    sys_index::rows<sysscalartypes> scalartypes;
+    const std::function<void()> load[] = { // system table pages are read in parallel
+        [this, &index](){ load_sys_rows(_sysschobjs, index.schobjs); },
+        [this, &colpars](){ load_sys_rows(_syscolpars, colpars); },
+        [this, &idxstats](){ load_sys_rows(_sysidxstats, idxstats); },
+        [this, &allocunits](){ load_sys_rows(_sysallocunits, allocunits); },
+        [this, &iscols](){ load_sys_rows(_sysiscols, iscols); },
+        [this, &scalartypes](){ load_sys_rows(_sysscalartypes, scalartypes); },
+    };
+    parallel_for(count_of(load), [&load](size_t const i){
+        load[i]();
+    });
+    for (auto const row : colpars) {
+        index.colpars[sys_index::key(row->data.id)].push_back(row);
+    }
+    for (auto const row : idxstats) {
+        index.idxstats[sys_index::key(row->data.id)].push_back(row);
+    }
+    for (auto const row : allocunits) {
+        if (row->data.pgfirstiam) {
+            index.allocunits[sys_index::key(row->data.ownerid)].push_back(row);
+        }
+    }
+    for (auto const row : iscols) {
+        index.iscols[sys_index::key(row->data.idmajor)].push_back(row);
+    }
+    for (auto const row : scalartypes) {
+        index.scalartypes.emplace(sys_index::key(row->data.id), row); // first row wins
+    }
+    if (!cfg().catalog_cache.empty() && !m_data->open_time.cached) { // rows are saved by location
+        load_sys_location(_sysschobjs, index.location);
+        load_sys_location(_syscolpars, index.location);
+        load_sys_location(_sysidxstats, index.location);
+        load_sys_location(_sysallocunits, index.location);
+        load_sys_location(_sysiscols, index.location);
+        load_sys_location(_sysscalartypes, index.location);
+    }
+}
+
+// objects which can have catalog entries: tables and owners of indexes
+void database::init_catalog()
+{
+    sys_index const & index = sys();
+    std::vector<schobj_id> ids;
+    ids.reserve(index.schobjs.size() + index.idxstats.size());
+    for (auto const row : index.schobjs) {
+        if (row->is_USER_TABLE() || row->is_INTERNAL_TABLE()) {
+            ids.push_back(row->data.id);
+        }
+    }
+    for (auto const & p : index.idxstats) {
+        SDL_ASSERT(!p.second.empty());
+        ids.push_back(p.second[0]->data.id);
+    }
+    std::sort(ids.begin(), ids.end(), [](schobj_id const & x, schobj_id const & y){
+        return x._32 < y._32;
+    });
+    ids.erase(std::unique(ids.begin(), ids.end(), [](schobj_id const & x, schobj_id const & y){
+        return x._32 == y._32;
+    }), ids.end());
+    m_data->init_catalog(ids);
+}
+
+database::sys_index const & database::sys() const
+{
+    std::call_once(m_data->sys_once, [this](){
+        this->init_sys_index();
+    });
+    return m_data->sys;
+}
+
+database::open_time_t database::open_time() const
+{
+    return m_data->open_time;
+}
+
 void database::init_datatable(shared_usertable const & schema)
 {
     SDL_ASSERT(!m_data->initialized);
@@ -63,11 +236,8 @@ void const * database::memory_offset(void const * p) const { // diagnostic
     if (use_page_bpool()) {
         return p;
     }
-    char const * p1 = (char const *)m_data->pmap().start_address();
-    char const * p2 = (char const *)p;
-    SDL_ASSERT(p2 >= p1);
-    void const * offset = reinterpret_cast<void const *>(p2 - p1);    
-    return offset;
+    const uint64 offset = m_data->pmap().memory_offset(p);
+    return reinterpret_cast<void const *>(static_cast<size_t>(offset));
 }
 
 std::string database::dbi_dbname() const
@@ -130,6 +300,67 @@ database::scan_checksum(checksum_fun fun) const
     return break_or_continue::continue_;
 }
 
+break_or_continue
+database::scan_checksum(checksum_fun fun, size_t threads) const
+{
+    SDL_ASSERT(fun);
+    if (!threads) {
+        threads = a_max(size_t(std::thread::hardware_concurrency()), size_t(1));
+    }
+    enum { range_page = bpool::pool_limits::block_page_num * 64 }; // pages of 64 blocks per task
+    const size_t count = page_count();
+    std::atomic<size_t> next_range(0);
+    std::atomic_bool stop(false);
+    std::mutex fun_mutex;
+    std::exception_ptr error;
+    auto worker = [this, &fun, count, &next_range, &stop, &fun_mutex, &error]() {
+        try {
+            scoped_thread_lock const lock(*this);
+            while (!stop) {
+                const size_t first = range_page * (next_range++);
+                if (first >= count) {
+                    break;
+                }
+                const size_t last = a_min(first + range_page, count);
+                pageFileID id = pageFileID::init(static_cast<uint32>(first));
+                for (; (id.pageId < last) && !stop; ++(id.pageId)) {
+                    if (!is_allocated(id)) {
+                        continue;
+                    }
+                    page_head const * const p = load_page_head(id);
+                    if (!p) {
+                        throw_error<database_error>("cannot load page");
+                    }
+                    if (p->data.tornBits && (page_head::checksum(p) != p->data.tornBits)) {
+                        std::lock_guard<std::mutex> fun_lock(fun_mutex);
+                        if (!stop && !fun(p)) {
+                            stop = true;
+                        }
+                    }
+                }
+                unlock_thread(bpool::removef::false_); // scanned blocks can be evicted
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> fun_lock(fun_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+        }
+    };
+    {
+        std::vector<std::unique_ptr<joinable_thread>> pool(a_min(threads, count / range_page + 1));
+        for (auto & t : pool) {
+            reset_new(t, worker);
+        }
+    } // join
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return stop ? break_or_continue::break_ : break_or_continue::continue_;
+}
+
 break_or_continue 
 database::scan_checksum() const {
     return scan_checksum([](page_head const * const){
@@ -243,6 +474,40 @@ size_t database::pool_commited_size() const {
     return 0;
 }
 
+size_t database::pool_read_count() const {
+    if (auto p = m_data->cpool()) {
+        return p->file_stats().read_count;
+    }
+    return 0;
+}
+
+size_t database::pool_hugepage_size() const {
+    if (auto p = m_data->cpool()) {
+        return p->alloc_hugepage_size();
+    }
+    return 0;
+}
+
+bpool::pool_stats_t database::pool_stats() const {
+    if (auto p = m_data->cpool()) {
+        return p->stats();
+    }
+    return {};
+}
+
+std::vector<pageIndex> database::pool_checksum_error() const {
+    if (auto p = m_data->cpool()) {
+        return p->checksum_error_pages();
+    }
+    return {};
+}
+
+void database::pool_save_warm_cache(std::string const & fname) const {
+    if (auto p = m_data->cpool()) {
+        p->save_warm_cache(fname);
+    }
+}
+
 bool database::pool_defragment() const {
     if (auto p = m_data->pool()) {
         return p->defragment();
@@ -250,6 +515,19 @@ bool database::pool_defragment() const {
     return false;
 }
 
+void database::pool_read_ahead(std::vector<pageFileID> const & pages) const {
+    if (auto p = m_data->pool()) {
+        std::vector<pageIndex> index;
+        index.reserve(pages.size());
+        for (auto const & id : pages) {
+            if (id) {
+                index.push_back(id.pageId);
+            }
+        }
+        p->read_ahead(index);
+    }
+}
+
 size_t database::pool_thread_size() const {
     if (auto p = m_data->cpool()) {
         return p->thread_size();
@@ -261,12 +539,184 @@ size_t database::pool_max_thread_size() {
     return bpool::thread_id_t::max_size();
 }
 
+void database::init_pin()
+{
+    database_cfg::pin_policy const & pin = cfg().pin;
+    if (pin.empty() || !use_page_bpool()) {
+        return;
+    }
+    if (pin.background) {
+        reset_new(m_data->pin_thread, [this](){
+            scoped_thread_lock const lock(*this); // unlock pages touched while walking
+            try {
+                this->pin_pages();
+            }
+            catch (sdl_exception & e) {
+                SDL_TRACE("pin_pages failed: ", e.what());
+            }
+        });
+    }
+    else {
+        pin_pages();
+    }
+}
+
+size_t database::pin_pages() const
+{
+    if (!use_page_bpool()) {
+        return 0;
+    }
+    database_cfg::pin_policy const & pin = cfg().pin;
+    size_t count = 0;
+    if (pin.system) {
+        count += pin_system();
+    }
+    if (pin.index || pin.spatial) {
+        for (auto const & table : _datatables) {
+            if (m_data->pin_shutdown) {
+                return count;
+            }
+            schobj_id const id = table->get_id();
+            if (pin.index) {
+                if (auto const cluster = get_cluster_index(id)) {
+                    count += pin_index_levels(cluster->root());
+                }
+            }
+            if (pin.spatial) {
+                if (auto const tree = find_spatial_tree(id)) {
+                    count += pin_index_levels(tree.pgroot);
+                }
+            }
+        }
+    }
+    for (std::string const & name : pin.tables) {
+        if (m_data->pin_shutdown) {
+            return count;
+        }
+        if (auto const table = find_table(name)) {
+            count += pin_table(table->get_id());
+        }
+        else {
+            SDL_TRACE_WARNING("pin table not found: ", name);
+        }
+    }
+    SDL_TRACE(__FUNCTION__, ": pages = ", count, 
+        " fixed_MB = ", pool_stats().fixed_size / megabyte<1>::value);
+    return count;
+}
+
+bool database::pin_page(pageFileID const & id) const
+{
+    if (id && !page_is_fixed(id)) {
+        return lock_page_fixed(id) != nullptr;
+    }
+    return false;
+}
+
+template<class T>
+size_t database::pin_sys_pages(page_access<T> const & obj) const
+{
+    size_t count = 0;
+    for (auto const & p : obj) {
+        if (pin_page(p->head->data.pageId)) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+size_t database::pin_system() const
+{
+    size_t count = 0;
+    if (pin_page(pageFileID::init(static_cast<uint32>(sysPage::boot_page)))) {
+        ++count;
+    }
+    count += pin_sys_pages(_sysallocunits);
+    count += pin_sys_pages(_sysschobjs);
+    count += pin_sys_pages(_syscolpars);
+    count += pin_sys_pages(_sysidxstats);
+    count += pin_sys_pages(_sysscalartypes);
+    count += pin_sys_pages(_sysobjvalues);
+    count += pin_sys_pages(_sysiscols);
+    count += pin_sys_pages(_sysrowsets);
+    count += pin_sys_pages(_pfs_page);
+    return count;
+}
+
+// Walks B-tree level by level: pages of one level are linked by nextPage,
+// the first page of next level is the child of the first row.
+// Leaf level (data pages) is not touched.
+size_t database::pin_index_levels(page_head const * const root) const
+{
+    if (!(root && root->is_index())) {
+        return 0;
+    }
+    size_t count = 0;
+    pageFileID first = root->data.pageId;
+    while (first && !m_data->pin_shutdown) {
+        page_head const * head = lock_page_fixed(first);
+        if (!(head && head->is_index())) {
+            SDL_ASSERT(0);
+            break;
+        }
+        first = {};
+        if (head->data.level > 1) { // children are index pages
+            SDL_ASSERT(head->data.pminlen >= index_row_head_size);
+            const datapage_t<index_page_row_t<char>> page(head);
+            if (!page.empty()) {
+                char const * const row = reinterpret_cast<char const *>(page.front());
+                first = *reinterpret_cast<pageFileID const *>(row + head->data.pminlen - sizeof(pageFileID));
+            }
+        }
+        for (;;) {
+            ++count;
+            pageFileID const next = head->data.nextPage;
+            if (!next) {
+                break;
+            }
+            head = lock_page_fixed(next);
+            if (!(head && head->is_index())) {
+                SDL_ASSERT(0);
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+size_t database::pin_table(schobj_id const id) const
+{
+    size_t count = 0;
+    for_dataType([this, id, &count](dataType::type const t){
+        for (auto const alloc : *find_sysalloc(id, t)) {
+            A_STATIC_CHECK_TYPE(sysallocunits_row const * const, alloc);
+            if (m_data->pin_shutdown || !alloc->data.pgfirstiam) {
+                continue;
+            }
+            for (auto const & iam : iam_access(this, alloc)) {
+                A_STATIC_CHECK_TYPE(shared_iam_page const &, iam);
+                this->pin_page(iam->head->data.pageId);
+                iam->allocated_pages(this, [this, &count](pageFileID const & page) {
+                    this->pin_page(page);
+                    ++count;
+                });
+            }
+        }
+    });
+    return count;
+}
+
 page_head const *
 database::load_page_head(pageIndex const i) const {
-    if (auto p = m_data->pool()) {
-        return p->lock_page(i);
+    page_head const * const head = m_data->pool() ?
+        m_data->pool()->lock_page(i) :
+        m_data->pmap().lock_page(i);
+    if (page_trace * const t = m_data->trace()) {
+        if (head) {
+            t->trace(i.value(), head);
+        }
     }
-    return m_data->pmap().lock_page(i);
+    return head;
 }
 
 database::page_row
@@ -284,24 +734,6 @@ database::load_page_row(recordID const & row) const
     return{};
 }
 
-std::vector<page_head const *>
-database::load_page_list(page_head const * p) const
-{
-    std::vector<page_head const *> vec;
-    if (p) {
-        auto prev = p;
-        while ((prev = load_prev_head(prev)) != nullptr) {
-            vec.push_back(prev);
-        }
-        std::reverse(vec.begin(), vec.end());
-        vec.push_back(p);
-        while ((p = load_next_head(p)) != nullptr) {
-            vec.push_back(p);
-        }
-    }
-    return vec;
-}
-
 pageType database::get_pageType(pageFileID const & id) const
 {
     if (auto p = load_page_head(id)) {
@@ -449,6 +881,115 @@ page_head const * database::load_prev_head(page_head const * const p) const
     return nullptr;
 }
 
+page_head const * database::scan_next_head(page_head const * const p) const
+{
+    if (p) {
+        scan_prefetch(p->data.pageId.pageId, p->data.nextPage.pageId);
+        if (m_data->cfg().scan_unlock) {
+            auto next = this->scan_lock_page(p->data.nextPage);
+            SDL_ASSERT(!next || (next->data.type == p->data.type));
+            this->scan_unlock_page(p); // scan leaves last page of list too
+            return next;
+        }
+    }
+    return this->load_next_head(p);
+}
+
+page_head const * database::scan_lock_page(pageFileID const & id) const
+{
+    if (id && m_data->cfg().scan_unlock) {
+        if (auto p = m_data->pool()) {
+            page_head const * const head = p->lock_page_scan(id.pageId);
+            if (page_trace * const t = m_data->trace()) {
+                if (head) {
+                    t->trace(id.pageId, head);
+                }
+            }
+            return head;
+        }
+    }
+    return this->load_page_head(id);
+}
+
+bool database::scan_pin_page(page_head const * const head) const
+{
+    if (head && m_data->cfg().scan_unlock) {
+        if (auto p = m_data->pool()) {
+            return p->lock_page_scan(head->data.pageId.pageId) != nullptr;
+        }
+    }
+    return false;
+}
+
+bool database::scan_unlock_page(page_head const * const head) const
+{
+    if (head && m_data->cfg().scan_unlock) {
+        if (auto p = m_data->pool()) {
+            return p->unlock_page_scan(head->data.pageId.pageId); // no-op for fixed page
+        }
+    }
+    return false;
+}
+
+// page mapping: when scan enters next window of database_cfg::read_ahead blocks, 
+// the window after it is advised to kernel; after a jump the entered window is advised too
+void database::scan_prefetch(pageIndex const cur, pageIndex const next) const
+{
+    size_t const window = m_data->cfg().read_ahead * bpool::pool_limits::block_page_num;
+    if (!window || m_data->use_page_bpool()) {
+        return;
+    }
+    size_t const w1 = cur.value() / window;
+    size_t const w2 = next.value() / window;
+    if ((w1 != w2) && (next.value() < page_count())) {
+        PageMapping const & pmap = m_data->pmap();
+        if (w2 != w1 + 1) {
+            pmap.prefetch(static_cast<pageIndex::value_type>(w2 * window), window);
+        }
+        if ((w2 + 1) * window < page_count()) {
+            pmap.prefetch(static_cast<pageIndex::value_type>((w2 + 1) * window), window);
+        }
+    }
+}
+
+bool database::prefetch(pageIndex const first, size_t const count) const
+{
+    if (!count || (first.value() >= page_count())) {
+        return false;
+    }
+    if (auto p = m_data->pool()) {
+        const size_t last = a_min(size_t(first.value()) + count, page_count());
+        std::vector<pageIndex> index; // one page per block
+        for (size_t i = first.value(); i < last; i += bpool::pool_limits::block_page_num) {
+            index.push_back(static_cast<pageIndex::value_type>(i));
+        }
+        p->read_ahead(index);
+        return true;
+    }
+    return m_data->pmap().prefetch(first, count);
+}
+
+bool database::advise_pages(pageIndex const first, size_t const count, FileMapping::advice const a) const
+{
+    if (m_data->use_page_bpool() || !count || (first.value() >= page_count())) {
+        return false;
+    }
+    return m_data->pmap().advise(first, count, a);
+}
+
+page_head const * database::scan_prev_head(page_head const * const p) const
+{
+    if (p && m_data->cfg().scan_unlock) {
+        auto prev = this->scan_lock_page(p->data.prevPage);
+        SDL_ASSERT(!prev || (prev->data.type == p->data.type));
+        if (prev) {
+            this->scan_unlock_page(p);
+        }
+        return prev;
+    }
+    return this->load_prev_head(p);
+}
+
 page_head const * database::load_last_head(page_head const * p) const
 {
     page_head const * next;
@@ -511,66 +1052,44 @@ recordID database::load_prev_record(recordID const & r) const
     return{};
 }
 
-template<class fun_type>
-unique_datatable database::find_table_if(fun_type && fun) const
+unique_datatable database::find_table(const std::string & name) const
 {
-    for (auto const & p : _usertables) {
-        const usertable & d = *p.get();
-        if (fun(d)) {
-            return std::make_unique<datatable>(this, p);
-        }
+    SDL_ASSERT(!name.empty());
+    if (auto p = m_data->usertable_index.find(name)) {
+        return std::make_unique<datatable>(this, p);
     }
     return {};
 }
 
-template<class fun_type>
-unique_datatable database::find_internal_if(fun_type && fun) const
+unique_datatable database::find_table(schobj_id const id) const
 {
-    for (auto const & p : _internals) {
-        const usertable & d = *p.get();
-        if (fun(d)) {
-            return std::make_unique<datatable>(this, p);
-        }
+    if (auto p = m_data->usertable_index.find(id)) {
+        return std::make_unique<datatable>(this, p);
     }
     return {};
 }
 
-unique_datatable database::find_table(const std::string & name) const
-{
-    SDL_ASSERT(!name.empty());
-    return find_table_if([&name](const usertable & d) {
-        return d.name() == name;
-    });
-}
-
-unique_datatable database::find_table(schobj_id const id) const
-{
-    return find_table_if([id](const usertable & d) {
-        return d.get_id() == id;
-    });
-}
-
 unique_datatable database::find_internal(const std::string & name) const
 {
     SDL_ASSERT(!name.empty());
-    return find_internal_if([&name](const usertable & d) {
-        return d.name() == name;
-    });
+    if (auto p = m_data->internal_index.find(name)) {
+        return std::make_unique<datatable>(this, p);
+    }
+    return {};
 }
 
 unique_datatable database::find_internal(schobj_id const id) const
 {
-    return find_internal_if([id](const usertable & d) {
-        return d.get_id() == id;
-    });
+    if (auto p = m_data->internal_index.find(id)) {
+        return std::make_unique<datatable>(this, p);
+    }
+    return {};
 }
 
 shared_usertable database::find_table_schema(schobj_id const id) const
 {
-    for (auto const & p : _usertables) {
-        if (p->get_id() == id) {
-            return p;
-        }
+    if (auto p = m_data->usertable_index.find(id)) {
+        return p;
     }
     throw_error<database_error>("cannot find table schema");
     return {};
@@ -578,10 +1097,8 @@ shared_usertable database::find_table_schema(schobj_id const id) const
 
 shared_usertable database::find_internal_schema(schobj_id const id) const
 {
-    for (auto const & p : _internals) {
-        if (p->get_id() == id) {
-            return p;
-        }
+    if (auto p = m_data->internal_index.find(id)) {
+        return p;
     }
     throw_error<database_error>("cannot find internal schema");
     return {};
@@ -609,29 +1126,30 @@ template<class fun_type>
 void database::get_tables(vector_shared_usertable & m_ut, fun_type const & is_table) const
 {
     SDL_ASSERT(m_ut.empty());
-    vector_shared_usertable ret;
-    for_row(_sysschobjs, [&ret, &is_table, this](sysschobjs::const_pointer schobj_row){
+    sys_index const & index = sys();
+    std::vector<sysschobjs::const_pointer> tables;
+    for (auto const schobj_row : index.schobjs) {
         if (is_table(schobj_row)) {
-            const schobj_id table_id = schobj_row->data.id;
-            usertable::columns cols;
-            for_row(_syscolpars, [&cols, table_id, this](syscolpars::const_pointer colpar_row) {
-                if (colpar_row->data.id == table_id) {
-                    const scalartype utype = colpar_row->data.utype;
-                    if (auto scalar_row = find_if(_sysscalartypes, [utype](sysscalartypes::const_pointer p) {
-                        return (p->data.id == utype);
-                    })) {
-                        usertable::emplace_back(cols, colpar_row, scalar_row);
-                    }
-                }
-            });
-            if (!cols.empty()) {
-                primary_key const * const PK = get_primary_key(table_id).get();             
-                auto ut = std::make_shared<usertable>(schobj_row, std::move(cols), PK);
-                SDL_ASSERT(schobj_row->data.id == ut->get_id());
-                ret.push_back(std::move(ut));
+            tables.push_back(schobj_row);
+        }
+    }
+    vector_shared_usertable ret(tables.size());
+    parallel_for(tables.size(), [this, &index, &tables, &ret](size_t const i){
+        sysschobjs::const_pointer const schobj_row = tables[i];
+        const schobj_id table_id = schobj_row->data.id;
+        usertable::columns cols;
+        for (auto const colpar_row : index.find_colpars(table_id)) {
+            if (auto scalar_row = index.find_scalartype(colpar_row->data.utype)) {
+                usertable::emplace_back(cols, colpar_row, scalar_row);
             }
         }
+        if (!cols.empty()) {
+            primary_key const * const PK = get_primary_key(table_id).get();             
+            ret[i] = std::make_shared<usertable>(schobj_row, std::move(cols), PK);
+            SDL_ASSERT(schobj_row->data.id == ret[i]->get_id());
+        }
     });
+    ret.erase(std::remove(ret.begin(), ret.end(), nullptr), ret.end()); // tables without columns
     if (!ret.empty()) {
         using table_type = vector_shared_usertable::value_type;
         std::sort(ret.begin(), ret.end(),
@@ -679,7 +1197,7 @@ database::get_datatables() const
     if (!m_data->empty_datatable()) {
         return m_data->datatable();
     }
-    SDL_ASSERT(!m_data->initialized);
+    SDL_ASSERT(!m_data->initialized || cfg().lazy_catalog);
     auto const ut = this->get_usertables();
     shared_datatables dt(new vector_shared_datatable);
     dt->reserve(ut->size());
@@ -708,28 +1226,22 @@ database::find_sysalloc(schobj_id const id, dataType::type const data_type) cons
     }
     shared_sysallocunits shared_result(new vector_sysallocunits_row);
     auto & result = *shared_result;
-    for_row(_sysidxstats, [this, id, data_type, &result](sysidxstats::const_pointer idx) {
-        if ((idx->data.id == id) && !idx->data.rowset.is_null()) {
-            for_row(_sysallocunits, 
-                [idx, data_type, &result](sysallocunits::const_pointer row) {
-                    if (row->data.pgfirstiam) {
-                        if ((row->data.ownerid == idx->data.rowset) && (row->data.type == data_type)) {
-                            if (!algo::is_find(result, row)) {
-                                result.push_back(row);
-                            }
-                            else {
-                                SDL_ASSERT(!"push unique"); // to be tested
-                            }
-                        }
+    for (auto const idx : sys().find_idxstats(id)) {
+        if (!idx->data.rowset.is_null()) {
+            for (auto const row : sys().find_allocunits(idx->data.rowset)) { // rows with pgfirstiam
+                SDL_ASSERT(row->data.ownerid == idx->data.rowset);
+                if (row->data.type == data_type) {
+                    if (!algo::is_find(result, row)) {
+                        result.push_back(row);
                     }
                     else {
-                        //SDL_TRACE("\nfind_sysalloc id=", idx->data.id._32, " name=", col_name_t(idx));
+                        SDL_ASSERT(!"push unique"); // to be tested
                     }
-            });
+                }
+            }
         }
-    });
-    m_data->set_sysalloc(id, data_type, shared_result);
-    return shared_result;
+    }
+    return m_data->set_sysalloc(id, data_type, shared_result);
 }
 
 database::pgroot_pgfirst 
@@ -741,6 +1253,7 @@ database::load_pg_index(schobj_id const id, pageType::type const page_type) cons
             return found.first;
         }
     }
+    const bpool::page_bpool::fixed_scope scope(m_data->cpool()); // result keeps page pointers (lazy_catalog)
     pgroot_pgfirst result{};
     auto const & sysalloc = find_sysalloc(id, dataType::type::IN_ROW_DATA);
     for (auto const alloc : *sysalloc) {
@@ -769,20 +1282,20 @@ database::load_pg_index(schobj_id const id, pageType::type const page_type) cons
             }
         }
     }
-    m_data->set_pg_index(id, page_type, result);
-    return result;
+    return m_data->set_pg_index(id, page_type, result);
 }
 
 database::shared_page_head_access
 database::find_datapage(schobj_id const id, 
                         dataType::type const data_type,
-                        pageType::type const page_type) const
+                        pageType::type const page_type,
+                        scan_order const order) const
 {
-    using class_clustered_access = page_head_access_t<clustered_access>;
-    using class_forward_access   = page_head_access_t<forward_access>;
-    using class_heap_access      = page_head_access_t<heap_access>;
+    using class_clustered_access  = page_head_access_t<clustered_access>;
+    using class_forward_access    = page_head_access_t<forward_access>;
+    using class_heap_access       = page_head_access_t<heap_access>;
     {
-        auto const found = m_data->find_datapage(id, data_type, page_type);
+        auto const found = m_data->find_datapage(id, data_type, page_type, order);
         if (found.second) {
             return found.first;
         }
@@ -790,7 +1303,7 @@ database::find_datapage(schobj_id const id,
     shared_page_head_access result;
     //TODO: Before we can scan either heaps or indices, we need to know the compression level as that's set at the partition level, and not at the record/page level.
     //TODO: We also need to know whether the partition is using vardecimals.
-    if ((data_type == dataType::type::IN_ROW_DATA) && (page_type == pageType::type::data)) {
+    if ((order == scan_order::table) && (data_type == dataType::type::IN_ROW_DATA) && (page_type == pageType::type::data)) {
         if (auto const index = get_cluster_index(id)) { // use cluster index if possible
             if (index->is_root_index()) {
                 const index_tree tree(this, index);
@@ -798,8 +1311,7 @@ database::find_datapage(schobj_id const id,
                 page_head const * const max_page = load_page_head(tree.max_page());
                 if (min_page && max_page) {
                     reset_shared<class_clustered_access>(result, this, min_page, max_page);
-                    m_data->set_datapage(id, data_type, page_type, result);
-                    return result;
+                    return m_data->set_datapage(id, data_type, page_type, order, result);
                 }
                 SDL_ASSERT(0);
             }
@@ -807,44 +1319,262 @@ database::find_datapage(schobj_id const id,
                 SDL_ASSERT(index->is_root_data());
                 if (page_head const * p = load_pg_index(id, page_type).pgfirst()) {
                     reset_shared<class_forward_access>(result, this, p);
-                    m_data->set_datapage(id, data_type, page_type, result);
-                    return result;
+                    return m_data->set_datapage(id, data_type, page_type, order, result);
                 }
             }
         }
     }
-    // Heap tables won't have root pages
-    vector_page_head heap_pages;
+    // Heap tables won't have root pages, allocation order is used for any table
+    std::vector<shared_iam_page> iam;
     vector_sysallocunits_row const & sysalloc = *find_sysalloc(id, data_type);
     for (auto alloc : sysalloc) {
         A_STATIC_CHECK_TYPE(sysallocunits_row const *, alloc);
         SDL_ASSERT(alloc->data.type == data_type);
         for (auto const & page : iam_access(this, alloc)) {
             A_STATIC_CHECK_TYPE(shared_iam_page const &, page);
-            page->allocated_pages(this, [this, page_type, &heap_pages](pageFileID const & id) {
-                SDL_ASSERT(id);
-                if (auto p = this->load_page_head(id)) {
-                    if (p->data.type == page_type) {
-                        heap_pages.push_back(p);
+            iam.push_back(page);
+        }
+    }
+    reset_shared<class_heap_access>(result, this, page_type, iam);
+    return m_data->set_datapage(id, data_type, page_type, order, result);
+}
+
+// returns first pages of uniform extents; pages of extents are not checked by PFS here
+std::vector<pageFileID>
+database::find_allocated_extents(schobj_id const id, dataType::type const data_type,
+                                 std::vector<pageFileID> & mixed) const
+{
+    std::vector<pageFileID> extents;
+    mixed.clear();
+    for (auto alloc : *find_sysalloc(id, data_type)) {
+        A_STATIC_CHECK_TYPE(sysallocunits_row const *, alloc);
+        for (auto const & iam : iam_access(this, alloc)) {
+            if (iam_page_row const * const row = iam->first()) {
+                for (pageFileID const & page : *row) {
+                    if (page && is_allocated(page)) {
+                        mixed.push_back(page);
                     }
                 }
-                else {
-                    SDL_ASSERT(0);
-                }
+            }
+            iam->allocated_extents([&extents](pageFileID const & start) {
+                extents.push_back(start);
             });
         }
     }
-    if (1) {
-        std::sort(heap_pages.begin(), heap_pages.end(), 
-            [](page_head const * x, page_head const * y){
-            return (x->data.pageId < y->data.pageId);
+    std::sort(mixed.begin(), mixed.end());
+    mixed.erase(std::unique(mixed.begin(), mixed.end()), mixed.end());
+    std::sort(extents.begin(), extents.end());
+    extents.erase(std::unique(extents.begin(), extents.end()), extents.end());
+    return extents;
+}
+
+//---------------------------------------------------------------
+
+namespace {
+
+// first set bit >= i, or size of bitmap in bits
+size_t next_bit(std::vector<uint64> const & bits, size_t const i) {
+    size_t w = i >> 6;
+    if (w >= bits.size()) {
+        return bits.size() << 6;
+    }
+    uint64 x = bits[w] & (~uint64(0) << (i & 63));
+    while (!x) {
+        if (++w == bits.size()) {
+            return bits.size() << 6;
+        }
+        x = bits[w];
+    }
+    size_t b = w << 6;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+} // namespace
+
+database::heap_access::heap_access(database const * const p,
+                                   pageType::type const t,
+                                   vector_iam_page const & iam)
+    : db(p)
+    , page_type(t)
+    , window(p->m_data->cfg().read_ahead * bpool::pool_limits::block_page_num)
+{
+    SDL_ASSERT(db);
+    enum { words = (iam_extent_row::bit_size + word_bits - 1) / word_bits };
+    for (shared_iam_page const & page : iam) {
+        iam_page_row const * const row = page->first();
+        if (!row) {
+            continue;
+        }
+        for (pageFileID const & id : *row) { // single pages of mixed extents
+            if (id && db->is_allocated(id)) {
+                mixed.push_back(id);
+            }
+        }
+        if (page->_extent.empty()) {
+            continue;
+        }
+        pageFileID const start = row->data.start_pg;
+        auto it = std::lower_bound(gam.begin(), gam.end(), start, 
+            [](gam_interval const & x, pageFileID const & y) {
+            return x.start < y;
         });
+        if ((it == gam.end()) || (start < it->start)) {
+            it = gam.insert(it, gam_interval{ start, std::vector<word_type>(words) });
+        }
+        iam_extent_row const & ext = page->_extent.first();
+        const size_t ext_size = ext.size();
+        for (size_t i = 0; i < ext_size; ++i) {
+            if (uint8 const b = ext[i]) {
+                it->extent[i >> 3] |= word_type(b) << ((i & 7) << 3);
+            }
+        }
+    }
+    std::sort(mixed.begin(), mixed.end());
+    mixed.erase(std::unique(mixed.begin(), mixed.end()), mixed.end());
+}
+
+page_head const *
+database::heap_access::next_head(page_head const * const p) const
+{
+    SDL_ASSERT(p);
+    page_head const * const next = load_from(p->data.pageId);
+    db->scan_unlock_page(p); // scan leaves last page too
+    return next;
+}
+
+// returns first page of page_type after prev (null at start of scan)
+page_head const *
+database::heap_access::load_from(pageFileID const & prev) const
+{
+    size_t w1 = (prev && window) ? (prev.pageId / window) : size_t(-1);
+    pageFileID id = prev;
+    while ((id = next_page(id))) {
+        if (window) {
+            size_t const w2 = id.pageId / window;
+            if (w1 != w2) {
+                if ((w1 == size_t(-1)) || (w2 != w1 + 1)) { // start of scan or jump
+                    read_ahead(w2);
+                }
+                read_ahead(w2 + 1);
+                w1 = w2;
+            }
+        }
+        if (page_head const * const head = db->scan_lock_page(id)) {
+            if (head->data.type == page_type) {
+                return head;
+            }
+            db->scan_unlock_page(head);
+        }
+        else {
+            SDL_ASSERT(0);
+        }
+    }
+    return nullptr;
+}
+
+// next allocated page in order of iam_page::allocated_pages
+pageFileID database::heap_access::next_page(pageFileID const & prev) const
+{
+    pageFileID result = next_extent_page(prev);
+    auto const it = std::upper_bound(mixed.begin(), mixed.end(), prev);
+    if ((it != mixed.end()) && (!result || (*it < result))) {
+        result = *it;
     }
-    reset_shared<class_heap_access>(result, this, std::move(heap_pages));
-    m_data->set_datapage(id, data_type, page_type, result);
     return result;
 }
 
+// uniform extent is used if its first page is allocated (checked by PFS once, when scan enters extent)
+pageFileID database::heap_access::next_extent_page(pageFileID const & prev) const
+{
+    auto it = std::upper_bound(gam.begin(), gam.end(), prev,
+        [](pageFileID const & x, gam_interval const & y) {
+        return x < y.start;
+    });
+    if (it != gam.begin()) {
+        --it; // interval which may contain prev
+    }
+    for (; it != gam.end(); ++it) {
+        pageFileID const start = it->start;
+        size_t first = 0; // page offset from start
+        if (!(prev < start)) {
+            if (prev.fileId != start.fileId) {
+                continue;
+            }
+            first = size_t(prev.pageId - start.pageId) + 1;
+        }
+        const size_t end = it->extent.size() * word_bits;
+        size_t e = first >> 3;
+        pageFileID id = start;
+        if (first & 7) { // rest of extent which contains prev
+            if ((e < end) && (it->extent[e / word_bits] & (word_type(1) << (e % word_bits)))) {
+                for (size_t j = first; j < ((e + 1) << 3); ++j) {
+                    id.pageId = static_cast<uint32>(start.pageId + j);
+                    if (db->is_allocated(id)) {
+                        return id;
+                    }
+                }
+            }
+            ++e;
+        }
+        while ((e = next_bit(it->extent, e)) < end) {
+            SDL_ASSERT(start.pageId + (e << 3) < uint32(-1));
+            id.pageId = static_cast<uint32>(start.pageId + (e << 3));
+            if (db->is_allocated(id)) {
+                return id;
+            }
+            ++e;
+        }
+    }
+    return {};
+}
+
+// extents and mixed pages of window w are taken from bitmaps, pages are not checked by PFS
+void database::heap_access::read_ahead(size_t const w) const
+{
+    SDL_ASSERT(window);
+    size_t const first = w * window;
+    size_t const last = a_min((w + 1) * window, db->page_count());
+    if (first >= last) {
+        return;
+    }
+    vector_page_id pages; // first page of extent
+    for (gam_interval const & g : gam) {
+        if ((g.start.pageId >= last) || (g.start.pageId + iam_extent_row::page_size <= first)) {
+            continue;
+        }
+        const size_t end = g.extent.size() * word_bits;
+        size_t e = (first > g.start.pageId) ? ((first - g.start.pageId) >> 3) : 0;
+        while ((e = next_bit(g.extent, e)) < end) {
+            const size_t pg = g.start.pageId + (e << 3);
+            if (pg >= last) {
+                break;
+            }
+            pageFileID id = g.start;
+            id.pageId = static_cast<uint32>(pg);
+            pages.push_back(id);
+            ++e;
+        }
+    }
+    for (auto it = std::lower_bound(mixed.begin(), mixed.end(), pageFileID::init(static_cast<pageFileID::page32>(first)));
+        (it != mixed.end()) && (it->pageId < last); ++it) {
+        pages.push_back(*it);
+    }
+    if (!pages.empty()) {
+        std::sort(pages.begin(), pages.end());
+        if (db->m_data->use_page_bpool()) {
+            db->pool_read_ahead(pages);
+        }
+        else {
+            const size_t end = a_min(size_t(pages.back().pageId) + bpool::pool_limits::block_page_num, last);
+            db->m_data->pmap().prefetch(pages.front().pageId, end - pages.front().pageId);
+        }
+    }
+}
+
 bool database::is_allocated(pageFileID const & id) const
 {
     if (!id.is_null()) {
@@ -883,20 +1613,21 @@ database::make_primary_key(schobj_id const table_id) const
 {
     shared_primary_key result;
     if (auto const pg = load_pg_index(table_id, pageType::type::data)) {
-        sysidxstats_row const * idx = 
-            find_if(_sysidxstats, [table_id](sysidxstats::const_pointer p) {
-                if ((p->data.id == table_id) && p->data.indid.is_clustered()) {
-                    return p->data.status.IsPrimaryKey();
-                }
-                return false;
-            });
+        auto const & table_idx = sys().find_idxstats(table_id);
+        sysidxstats_row const * idx = nullptr;
+        for (auto const p : table_idx) {
+            if (p->data.indid.is_clustered() && p->data.status.IsPrimaryKey()) {
+                idx = p;
+                break;
+            }
+        }
         if (!idx) {
-            idx = find_if(_sysidxstats, [table_id](sysidxstats::const_pointer p) {
-                if ((p->data.id == table_id) && p->data.indid.is_clustered()) {
-                    return p->data.status.IsUnique();
+            for (auto const p : table_idx) {
+                if (p->data.indid.is_clustered() && p->data.status.IsUnique()) {
+                    idx = p;
+                    break;
                 }
-                return false;
-            });
+            }
         }
         if (idx) {
             SDL_ASSERT(idx->data.status.IsPrimaryKey() || idx->data.status.IsUnique());
@@ -904,11 +1635,11 @@ database::make_primary_key(schobj_id const table_id) const
             SDL_ASSERT(idx->data.indid.is_clustered());            
             
             std::vector<sysiscols_row const *> idx_stat;
-            for_row(_sysiscols, [table_id, idx, &idx_stat](sysiscols::const_pointer stat) {
-                if ((stat->data.idmajor == table_id) && (stat->data.idminor == idx->data.indid)) {
+            for (auto const stat : sys().find_iscols(table_id)) {
+                if (stat->data.idminor == idx->data.indid) {
                     idx_stat.push_back(stat);
                 }
-            });
+            }
             if (!idx_stat.empty()) {
                 SDL_ASSERT(idx_stat.size() < 256); // we use sysiscols_row.tinyprop1 (1 byte) to sort columns
                 std::sort(idx_stat.begin(), idx_stat.end(), 
@@ -926,15 +1657,15 @@ database::make_primary_key(schobj_id const table_id) const
                 idx_ord.reserve(idx_stat.size());
                 for (sysiscols_row const * stat : idx_stat) {
                     SDL_ASSERT(stat->data.status.is_index());
-                    if (syscolpars_row const * const col = find_if(_syscolpars, 
-                        [table_id, stat](syscolpars::const_pointer p) {
-                            return (p->data.id == table_id) && (p->data.colid == stat->data.intprop);
-                        }))
+                    auto const & table_col = sys().find_colpars(table_id);
+                    auto const col_it = std::find_if(table_col.begin(), table_col.end(),
+                        [stat](syscolpars::const_pointer p) {
+                            return (p->data.colid == stat->data.intprop);
+                        });
+                    if (col_it != table_col.end())
                     {
-                        const scalartype utype = col->data.utype;
-                        if (auto scal = find_if(_sysscalartypes, [utype](sysscalartypes::const_pointer p) {
-                            return (p->data.id == utype);
-                        })) 
+                        syscolpars_row const * const col = *col_it;
+                        if (auto scal = sys().find_scalartype(col->data.utype)) 
                         {
                             if (usertable::column::is_fixed(col, scal)) {
                                 idx_col.push_back(col);
@@ -979,6 +1710,7 @@ database::get_primary_key(schobj_id const table_id) const
             return found.first;
         }
     }
+    const bpool::page_bpool::fixed_scope scope(m_data->cpool()); // result keeps page pointers (lazy_catalog)
     if (shared_primary_key result = make_primary_key(table_id)) {
         sysidxstats_row const * const idxstat = result->idxstat;
         SDL_ASSERT(idxstat->is_clustered());
@@ -987,12 +1719,10 @@ database::get_primary_key(schobj_id const table_id) const
         if (idxstat->is_clustered() && 
             idxstat->IsUnique() && 
             idxstat->IsPrimaryKey()) {
-            m_data->set_primary_key(table_id, result);
-            return result;
+            return m_data->set_primary_key(table_id, result);
         }
     }
-    m_data->set_primary_key(table_id, shared_primary_key());
-    return {};
+    return m_data->set_primary_key(table_id, shared_primary_key());
 }
 
 shared_cluster_index
@@ -1031,17 +1761,14 @@ database::get_cluster_index(shared_usertable const & schema) const
         }
         SDL_ASSERT(result);
     }
-    m_data->set_cluster_index(schema_id, result);
-    return result;
+    return m_data->set_cluster_index(schema_id, result);
 }
 
 shared_cluster_index
 database::get_cluster_index(schobj_id const id) const  
 {
-    for (auto & p : _usertables) {
-        if (p->get_id() == id) {
-            return get_cluster_index(p);
-        }
+    if (auto p = m_data->usertable_index.find(id)) {
+        return get_cluster_index(p);
     }
     return{};
 }
@@ -1150,8 +1877,8 @@ database::index_for_table(schobj_id const id) const
 {
     using T = vector_sysidxstats_row;
     T result;
-    for_row(_sysidxstats, [id, &result](sysidxstats::const_pointer idx) {
-        if ((idx->data.id == id) && idx->data.indid.is_index()) {
+    for (auto const idx : sys().find_idxstats(id)) {
+        if (idx->data.indid.is_index()) {
             switch (idx->data.type) {
             case idxtype::clustered:
             case idxtype::nonclustered:
@@ -1162,7 +1889,7 @@ database::index_for_table(schobj_id const id) const
                 break; // _WA_Sys_00000002_182C9B23 (used for statistics)
             }
         }
-    });
+    }
     std::sort(result.begin(), result.end(),
         [](T::value_type const & x, T::value_type const & y){
         return x->data.indid < y->data.indid;
@@ -1207,16 +1934,11 @@ database::find_spatial_alloc(const std::string & index_name) const
 
 sysidxstats_row const * database::find_spatial_idx(schobj_id const table_id) const
 {
-    sysidxstats_row const * const idx = 
-    find_if(_sysidxstats, [table_id](sysidxstats::const_pointer idx) {
-        if ((idx->data.type == idxtype::spatial) && (idx->data.id == table_id)) {
-            return true;
+    for (auto const idx : sys().find_idxstats(table_id)) {
+        if (idx->data.type == idxtype::spatial) {
+            SDL_ASSERT(idx->data.id == table_id);
+            return idx;
         }
-        return false;
-    });
-    if (idx) {
-        SDL_ASSERT(idx->data.id == table_id);
-        return idx;
     }
     return nullptr;
 }
@@ -1243,6 +1965,7 @@ database::find_spatial_tree(schobj_id const table_id) const
             return found.first;
         }
     }
+    const bpool::page_bpool::fixed_scope scope(m_data->cpool()); // result keeps page pointers (lazy_catalog)
     spatial_tree_idx result{};
     auto const sroot = find_spatial_root(table_id);
     if (sroot.first) {
@@ -1260,8 +1983,7 @@ database::find_spatial_tree(schobj_id const table_id) const
                         if (auto const pgroot = load_page_head(root->data.pgroot)) {
                             result.pgroot = pgroot;
                             result.idx = sroot.second;
-                            m_data->set_spatial_tree(table_id, result);
-                            return result;
+                            return m_data->set_spatial_tree(table_id, result);
                         }
                     }
                     else {
@@ -1292,6 +2014,21 @@ page_head const * fwd::load_next_head(database const * d, page_head const * p) {
 page_head const * fwd::load_prev_head(database const * d,page_head const * p) {
     return d->load_prev_head(p);
 }
+page_head const * fwd::scan_next_head(database const * d, page_head const * p) {
+    return d->scan_next_head(p);
+}
+page_head const * fwd::scan_prev_head(database const * d, page_head const * p) {
+    return d->scan_prev_head(p);
+}
+page_head const * fwd::scan_lock_page(database const * d, pageFileID const & it) {
+    return d->scan_lock_page(it);
+}
+bool fwd::scan_pin_page(database const * d, page_head const * p) {
+    return d->scan_pin_page(p);
+}
+bool fwd::scan_unlock_page(database const * d, page_head const * p) {
+    return d->scan_unlock_page(p);
+}
 recordID fwd::load_next_record(database const * d, recordID const & it) {
     return d->load_next_record(it);
 }
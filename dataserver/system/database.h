@@ -8,6 +8,8 @@
 #include "dataserver/system/overflow.h"
 #include "dataserver/system/database_cfg.h"
 #include "dataserver/bpool/flag_type.h"
+#include "dataserver/bpool/pool_stats.h"
+#include "dataserver/filesys/file_map.h"
 
 namespace sdl { namespace db {
 
@@ -41,6 +43,7 @@ public:
     using vector_sysallocunits_row = std::vector<sysallocunits_row const *>;
     using vector_page_head = std::vector<page_head const *>;
     using page_head_access = datatable::page_head_access;
+    using scan_order = datatable::scan_order;
     using shared_sysallocunits = std::shared_ptr<vector_sysallocunits_row>;
     using shared_page_head_access = std::shared_ptr<page_head_access>;
     using shared_usertables = std::shared_ptr<vector_shared_usertable>;
@@ -126,18 +129,32 @@ private:
     };
     class datatable_access : noncopyable {
         friend class database;
-        shared_datatables tables;
+        database const * db = nullptr; // see database_cfg::lazy_catalog
+        mutable std::once_flag lazy_init;
+        mutable shared_datatables tables;
         void init(shared_datatables const & value) {
             tables = value;
             SDL_ASSERT(tables);
         }
+        void init_lazy(database const * p) {
+            db = p;
+        }
+        vector_shared_datatable const & get() const {
+            if (db) {
+                std::call_once(lazy_init, [this](){
+                    tables = db->get_datatables();
+                });
+            }
+            SDL_ASSERT(tables);
+            return *tables;
+        }
     public:
         using iterator = vector_shared_datatable::const_iterator;
         iterator begin() const {
-            return tables->begin();
+            return get().begin();
         }
         iterator end() const {
-            return tables->end();
+            return get().end();
         }
     };
     class iam_access {
@@ -159,31 +176,41 @@ private:
         }
     };
 private:
-    class clustered_access: noncopyable {
+    // iterators of clustered_access, forward_access and heap_access hold scan lock of current page:
+    // each copy of iterator keeps its page locked until it moves or is destroyed, see database_cfg::scan_unlock
+    class clustered_access: noncopyable { // pages are reloaded by id, see database_cfg::scan_unlock
         database const * const db;
-        page_head const * const min_page;
-        page_head const * const max_page;
+        pageFileID const min_page;
+        pageFileID const max_page;
     public:
         using iterator = page_iterator<clustered_access const, page_head const *>;
         clustered_access(database const * p, page_head const * _min, page_head const * _max)
-            : db(p), min_page(_min), max_page(_max) {
+            : db(p), min_page(_min->data.pageId), max_page(_max->data.pageId) {
             SDL_ASSERT(db && min_page && max_page);
-            SDL_ASSERT(!min_page->data.prevPage);
-            SDL_ASSERT(!max_page->data.nextPage);
-            SDL_ASSERT(min_page->data.type == pageType::type::data);
-            SDL_ASSERT(max_page->data.type == pageType::type::data);
+            SDL_ASSERT(!_min->data.prevPage);
+            SDL_ASSERT(!_max->data.nextPage);
+            SDL_ASSERT(_min->data.type == pageType::type::data);
+            SDL_ASSERT(_max->data.type == pageType::type::data);
         }
         iterator begin() const {
-            page_head const * p = min_page;
-            return iterator(this, std::move(p));
+            return iterator(this, first_head());
         }
         iterator end() const {
             return iterator(this);
         }
+        page_head const * first_head() const { // scan locked
+            return db->scan_lock_page(min_page);
+        }
         template<class page_pos>
         page_head const * load_next_head(page_pos const & p) const {
             A_STATIC_CHECK_TYPE(page_head const *, p.first);
-            return db->load_next_head(p.first);
+            return db->scan_next_head(p.first);
+        }
+        bool scan_pin(page_head const * p) const {
+            return db->scan_pin_page(p);
+        }
+        bool scan_unpin(page_head const * p) const {
+            return db->scan_unlock_page(p);
         }
     private:
         friend iterator;
@@ -192,36 +219,44 @@ private:
         }
         void load_next(page_head const * & p) const {
             SDL_ASSERT(p);
-            p = db->load_next_head(p);
+            p = db->scan_next_head(p);
         }
         void load_prev(page_head const * & p) const {
-            p = p ? db->load_prev_head(p) : max_page;
+            p = p ? db->scan_prev_head(p) : db->scan_lock_page(max_page);
         }
         static bool is_end(page_head const * const p) {
             return nullptr == p;
         }
     };
-    class forward_access: noncopyable {
+    class forward_access: noncopyable { // first page is reloaded by id, see database_cfg::scan_unlock
         database const * const db;
-        page_head const * const head;
+        pageFileID const head;
     public:
         using iterator = forward_iterator<forward_access const, page_head const *>;
-        forward_access(database const * p, page_head const * h): db(p), head(h) {
+        forward_access(database const * p, page_head const * h): db(p), head(h->data.pageId) {
             SDL_ASSERT(db && head);
-            SDL_ASSERT(!head->data.prevPage);
-            SDL_ASSERT(head->data.type == pageType::type::data);
+            SDL_ASSERT(!h->data.prevPage);
+            SDL_ASSERT(h->data.type == pageType::type::data);
         }
         iterator begin() const {
-            page_head const * p = head;
-            return iterator(this, std::move(p));
+            return iterator(this, first_head());
         }
         iterator end() const {
             return iterator(this);
         }
+        page_head const * first_head() const { // scan locked
+            return db->scan_lock_page(head);
+        }
         template<class page_pos>
         page_head const * load_next_head(page_pos const & p) const {
             A_STATIC_CHECK_TYPE(page_head const *, p.first);
-            return db->load_next_head(p.first);
+            return db->scan_next_head(p.first);
+        }
+        bool scan_pin(page_head const * p) const {
+            return db->scan_pin_page(p);
+        }
+        bool scan_unpin(page_head const * p) const {
+            return db->scan_unlock_page(p);
         }
     private:
         friend iterator;
@@ -230,36 +265,72 @@ private:
         }
         void load_next(page_head const * & p) const {
             SDL_ASSERT(p);
-            p = db->load_next_head(p);
+            p = db->scan_next_head(p);
         }
         static bool is_end(page_head const * const p) {
             return nullptr == p;
         }
     };
+    // pages of IAM chains are loaded in file order and filtered by type, scan keeps only its position;
+    // extent bitmaps of IAM pages are merged once per GAM interval, so next page is found by bit search from 
+    // current page without reloading IAM pages; when scan enters next window of database_cfg::read_ahead blocks,
+    // allocated extents of the window after it are read ahead
     class heap_access: noncopyable {
-        vector_page_head const data;
+        using vector_page_id = std::vector<pageFileID>;
+        using vector_iam_page = std::vector<shared_iam_page>;
+        using word_type = uint64;
+        enum { word_bits = sizeof(word_type) * 8 };
+        struct gam_interval {
+            pageFileID start; // start_pg of IAM pages
+            std::vector<word_type> extent; // bit per uniform extent
+        };
+        database const * const db;
+        pageType::type const page_type;
+        size_t const window; // pages
+        vector_page_id mixed; // allocated single pages of mixed extents, sorted
+        std::vector<gam_interval> gam; // sorted by start
     public:
-        using iterator = vector_page_head::const_iterator;
-        heap_access(database const *, vector_page_head && v): data(std::move(v)) {}
+        using iterator = forward_iterator<heap_access const, page_head const *>;
+        heap_access(database const *, pageType::type, vector_iam_page const &);
         iterator begin() const {
-            return data.begin();
+            return iterator(this, first_head());
         }
         iterator end() const {
-            return data.end();
+            return iterator(this);
+        }
+        page_head const * first_head() const { // scan locked
+            return load_from(pageFileID());
         }
         template<class page_pos>
         page_head const * load_next_head(page_pos const & p) const {
-            A_STATIC_CHECK_TYPE(size_t, p.second);
-            size_t const i = p.second + 1;
-            SDL_ASSERT(i <= data.size());
-            if (i < data.size()) {
-                return data[i];
-            }
-            return nullptr; 
+            A_STATIC_CHECK_TYPE(page_head const *, p.first);
+            return next_head(p.first);
+        }
+        bool scan_pin(page_head const * p) const {
+            return db->scan_pin_page(p);
+        }
+        bool scan_unpin(page_head const * p) const {
+            return db->scan_unlock_page(p);
         }
+    private:
+        friend iterator;
+        static page_head const * dereference(page_head const * p) {
+            return p;
+        }
+        void load_next(page_head const * & p) const {
+            p = next_head(p);
+        }
+        static bool is_end(page_head const * const p) {
+            return nullptr == p;
+        }
+        page_head const * next_head(page_head const *) const;
+        page_head const * load_from(pageFileID const &) const;
+        pageFileID next_page(pageFileID const &) const;
+        pageFileID next_extent_page(pageFileID const &) const;
+        void read_ahead(size_t) const;
     };
 private:
-    template<class T> // T = clustered_access | heap_access
+    template<class T> // T = clustered_access | forward_access | heap_access
     class page_head_access_t final : public page_head_access {
         T _access;
     public:
@@ -267,12 +338,17 @@ private:
         page_head_access_t(Ts&&... params): _access(std::forward<Ts>(params)...) {}
     private:
         page_pos begin_page() const override {
-            auto it = _access.begin();
-            if (it != _access.end()) {
-                return { *it, 0 };
+            if (page_head const * const p = _access.first_head()) {
+                return { p, 0 };
             }
             return {};
         }
+        bool scan_pin_page(page_head const * p) const override {
+            return _access.scan_pin(p);
+        }
+        bool scan_unpin_page(page_head const * p) const override {
+            return _access.scan_unpin(p);
+        }
         void load_next(page_pos & p) const override {
             if ((p.first = _access.load_next_head(p)) != nullptr) {
                 ++(p.second);
@@ -283,6 +359,7 @@ private:
         }
     };
 private:
+    void scan_prefetch(pageIndex cur, pageIndex next) const; // see database_cfg::read_ahead
     page_head const * sysallocunits_head() const;
     page_head const * load_sys_obj(sysObj) const;
 
@@ -303,8 +380,6 @@ private:
         }
         return nullptr;
     }   
-    template<class fun_type> unique_datatable find_table_if(fun_type &&) const;
-    template<class fun_type> unique_datatable find_internal_if(fun_type &&) const;
 private:
     class pgroot_pgfirst {
         page_head const * m_pgroot = nullptr;  // root page of the index tree
@@ -346,7 +421,7 @@ public:
         }
     };
     std::thread::id init_thread_id() const;
-    size_t unlock_thread(std::thread::id, bpool::removef) const; // returns blocks number
+    size_t unlock_thread(std::thread::id, bpool::removef) const; // current thread only, returns blocks number
     size_t unlock_thread(bpool::removef) const; // returns blocks number
     size_t free_unlocked(bpool::decommitf) const; // returns blocks number
 
@@ -367,9 +442,26 @@ public:
     size_t pool_unused_size() const;
     size_t pool_free_size() const;
     size_t pool_commited_size() const;
+    size_t pool_read_count() const; // number of file reads
+    size_t pool_hugepage_size() const; // commited pool memory backed by huge pages
+    bpool::pool_stats_t pool_stats() const; // empty if page_bpool is not used
+    std::vector<pageIndex> pool_checksum_error() const; // pages with bad checksum found on load, see database_cfg::checksum
+    void pool_save_warm_cache(std::string const &) const; // resident blocks to reload on startup, see database_cfg::warm_cache
     bool pool_defragment() const;
+    void pool_read_ahead(std::vector<pageFileID> const &) const; // hint: pages (e.g. IAM extents) will be read in this order
     size_t pool_thread_size() const;
     static size_t pool_max_thread_size();
+    size_t pin_pages() const; // fixes pages of database_cfg::pin in pool memory, returns number of pages
+public:
+    struct open_time_t { // milliseconds spent in constructor
+        size_t system = 0;      // rows of system tables
+        size_t usertable = 0;   // table schemas
+        size_t datatable = 0;   // indexes, primary and cluster keys (see database_cfg::lazy_catalog)
+        size_t pin = 0;         // see database_cfg::pin
+        size_t total = 0;
+        bool cached = false;    // catalog was loaded from database_cfg::catalog_cache
+    };
+    open_time_t open_time() const;
 public:
     page_head const * load_page_head(pageIndex) const;
     page_head const * load_page_head(pageFileID const &) const;
@@ -377,6 +469,17 @@ public:
     page_head const * load_next_head(page_head const *) const;
     page_head const * load_prev_head(page_head const *) const;
 
+    // scan locks are counted per thread (database_cfg::scan_unlock); page pointer is valid while its scan lock is held,
+    // so page or row pointer taken from scan iterator must not be used after the iterator and its copies move on
+    page_head const * scan_next_head(page_head const *) const; // unlocks page it leaves, also last page at end of list
+    page_head const * scan_prev_head(page_head const *) const; // unlocks page it leaves (not first page of list)
+    page_head const * scan_lock_page(pageFileID const &) const; // counted lock of page_bpool if database_cfg::scan_unlock
+    bool scan_pin_page(page_head const *) const; // one more scan lock of page, e.g. for copy of iterator
+    bool scan_unlock_page(page_head const *) const; // page is unlocked when last scan leaves it
+
+    bool prefetch(pageIndex first, size_t count) const; // hint: pages will be read soon (madvise or pool read-ahead)
+    bool advise_pages(pageIndex first, size_t count, FileMapping::advice) const; // page mapping only
+
     page_head const * load_first_head(page_head const *) const; // first of page list 
     page_head const * load_last_head(page_head const *) const; // last of page list
 
@@ -435,7 +538,8 @@ public:
     page_head const * get_cluster_root(schobj_id) const; 
     
     shared_sysallocunits find_sysalloc(schobj_id, dataType::type) const;
-    shared_page_head_access find_datapage(schobj_id, dataType::type, pageType::type) const;
+    shared_page_head_access find_datapage(schobj_id, dataType::type, pageType::type, scan_order = scan_order::table) const;
+    std::vector<pageFileID> find_allocated_extents(schobj_id, dataType::type, std::vector<pageFileID> & mixed) const; // uniform extents of IAM chains in file order, allocated pages of mixed extents
     vector_mem_range_t var_data(row_head const *, size_t, scalartype::type) const;
     template<scalartype::type col_type>
     vector_mem_range_t var_data_t(row_head const *, size_t) const;
@@ -485,6 +589,7 @@ public:
     using checksum_fun = std::function<bool(page_head const *)>; // called if checksum not valid
     break_or_continue scan_checksum(checksum_fun) const;
     break_or_continue scan_checksum() const;
+    break_or_continue scan_checksum(checksum_fun, size_t threads) const; // ranges of blocks are scanned by worker threads, checksum_fun is serialized
 private:
     template<class fun_type> void for_USER_TABLE(fun_type const &) const;
     template<class fun_type> void for_INTERNAL_TABLE(fun_type const &) const;
@@ -495,15 +600,28 @@ private:
     shared_datatables get_datatables() const;
 
     page_head const * load_page_head(sysPage) const;
-    std::vector<page_head const *> load_page_list(page_head const *) const;
 
     sysidxstats_row const * find_spatial_type(const std::string & index_name, idxtype::type) const;
     sysidxstats_row const * find_spatial_idx(schobj_id) const;
     sysallocunits_row const * find_spatial_alloc(const std::string & index_name) const;
 
     shared_primary_key make_primary_key(schobj_id) const;
+private:
+    bool pin_page(pageFileID const &) const;
+    size_t pin_system() const;
+    size_t pin_index_levels(page_head const * root) const; // non-leaf levels of B-tree
+    size_t pin_table(schobj_id) const;
+    template<class T> size_t pin_sys_pages(page_access<T> const &) const;
+private:
+    class sys_index;
+    class catalog_cache; // see database_cfg::catalog_cache
+    sys_index const & sys() const;
+    template<class fun_type> void parallel_for(size_t count, fun_type const &) const; // see database_cfg::init_threads
 private:
     void init_database();
+    void init_sys_index() const;
+    void init_catalog();
+    void init_pin();
     void init_datatable(shared_usertable const &);
     using database_error = sdl_exception_t<database>;
     class shared_data;
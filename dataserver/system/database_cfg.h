@@ -15,6 +15,41 @@ struct database_cfg {
     size_t max_memory = 0;
     size_t pool_period = default_period; // used to decommit free blocks
     size_t pool_defrag = default_defrag; // used to defragment pool memory (= 0 to disable)
+    size_t read_ahead = 0; // read-ahead window in blocks of 64 KB (= 0 to disable), page mapping: advised ahead of page scans; allocation order scans read ahead allocated pages (page_bpool or page mapping)
+    enum class replacement_policy { lru, two_queue };
+    replacement_policy replacement = replacement_policy::lru; // eviction order of unlocked blocks
+    enum class hugepage_policy { none, transparent, hugetlb };
+    hugepage_policy hugepage = hugepage_policy::none; // huge pages for pool memory (unix)
+    bool prefault = false; // pre-fault commited pool memory
+    bool direct_io = false; // read file bypassing OS page cache (O_DIRECT), pool memory is not cached twice; ignored on Windows
+    enum class checksum_policy { off, first_load, always };
+    checksum_policy checksum = checksum_policy::off; // verify page checksums of blocks read from file
+    // page scans unlock the page they leave, last page included (page_bpool); scan locks are counted per thread,
+    // so nested scans and pages loaded by lookups stay locked; each copy of scan iterator holds its page until it
+    // moves or is destroyed, but page and row pointers taken from iterator must not be kept after that
+    bool scan_unlock = false;
+    std::string warm_cache; // side file of resident blocks: reloaded in background on startup, saved on shutdown (empty to disable)
+    struct pin_policy { // pages fixed in pool memory on open, not counted in max_memory
+        bool system = false;    // system catalog pages
+        bool index = false;     // non-leaf levels of clustered indexes
+        bool spatial = false;   // non-leaf levels of spatial indexes
+        std::vector<std::string> tables; // tables to preload entirely
+        bool background = false; // pin pages in background thread
+        bool empty() const {
+            return !(system || index || spatial || !tables.empty());
+        }
+    };
+    pin_policy pin;
+    enum class mmap_preload { none, populate, lock };
+    mmap_preload preload = mmap_preload::none; // page mapping: pre-fault or lock whole file in memory (small hot files)
+    enum class mmap_advice { normal, sequential, random };
+    mmap_advice advice = mmap_advice::normal; // page mapping: access pattern of whole file
+    size_t mmap_window = 0; // page mapping: file is mapped by windows of this size on first touch (= 0 to map whole file)
+    size_t mmap_window_max = 0; // page mapping: resident windows, memory of cold windows is released (= 0 unlimited); limits resident memory, not mapped address space
+    size_t init_threads = 0; // threads to read system tables and build table schemas on open (= 0 to use init thread only)
+    bool lazy_catalog = false; // indexes, primary and cluster keys of tables are loaded on first use, not on open
+    std::string catalog_cache; // side file of resolved catalog: used on open if it matches database file, otherwise saved after open (empty to disable)
+    std::string page_trace; // binary file of page accesses recorded by database::load_page_head (empty to disable)
     bool use_page_bpool = false;
     database_cfg() = default;
     explicit database_cfg(bool b) noexcept : use_page_bpool(b) {}
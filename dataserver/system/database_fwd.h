@@ -15,6 +15,11 @@ struct fwd : is_static {
     static page_head const * load_page_head(database const *, pageFileID const &);
     static page_head const * load_next_head(database const *, page_head const *);
     static page_head const * load_prev_head(database const *,page_head const *);
+    static page_head const * scan_next_head(database const *, page_head const *);
+    static page_head const * scan_prev_head(database const *, page_head const *);
+    static page_head const * scan_lock_page(database const *, pageFileID const &);
+    static bool scan_pin_page(database const *, page_head const *);
+    static bool scan_unlock_page(database const *, page_head const *);
     static recordID load_next_record(database const *, recordID const &);
     static recordID load_prev_record(database const *, recordID const &);
     static pageFileID nextPageID(database const *, pageFileID const &);
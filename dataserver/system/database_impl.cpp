@@ -12,7 +12,21 @@ database_PageMapping::database_PageMapping(const std::string & fname, database_c
         reset_new(m_pool, fname, cfg);
     }
     else {
-        reset_new(m_pmap, fname);
+        using preload = PageMapping::preload;
+        using advice = PageMapping::advice;
+        reset_new(m_pmap, fname, 
+            (cfg.preload == database_cfg::mmap_preload::populate) ? preload::populate :
+            (cfg.preload == database_cfg::mmap_preload::lock) ? preload::lock : preload::none,
+            cfg.mmap_window, cfg.mmap_window_max);
+        if (cfg.advice == database_cfg::mmap_advice::sequential) {
+            m_pmap->advise(advice::sequential);
+        }
+        else if (cfg.advice == database_cfg::mmap_advice::random) {
+            m_pmap->advise(advice::random);
+        }
+    }
+    if (!cfg.page_trace.empty() && is_open()) {
+        reset_new(m_trace, cfg.page_trace, page_count());
     }
 }
 
@@ -4,10 +4,10 @@
 #ifndef __SDL_SYSTEM_DATABASE_IMPL_H__
 #define __SDL_SYSTEM_DATABASE_IMPL_H__
 
-#include "dataserver/common/map_enum.h"
-#include "dataserver/common/compact_map.h"
 #include "dataserver/system/page_map.h"
 #include "dataserver/bpool/page_bpool.h"
+#include "dataserver/system/page_trace.h"
+#include <unordered_map>
 
 namespace sdl { namespace db {
 
@@ -32,6 +32,9 @@ public:
         SDL_ASSERT(m_pmap && !m_pool);
         return * m_pmap.get();
     }
+    page_trace * trace() const { // can be nullptr
+        return m_trace.get();
+    }
     bool is_open() const;
     size_t page_count() const;
     std::thread::id init_thread_id() const;
@@ -39,140 +42,292 @@ private:
     database_cfg const m_cfg;
     std::unique_ptr<bpool::page_bpool> m_pool;
     std::unique_ptr<PageMapping const> m_pmap;
+    std::unique_ptr<page_trace> m_trace;
+};
+
+class database::sys_index : noncopyable { // rows of system tables grouped by key, read-only after database open
+public:
+    template<class T> using rows = std::vector<typename T::const_pointer>;
+    template<class T> using map_rows = std::unordered_map<uint64, rows<T>>;
+    rows<sysschobjs> schobjs;
+    map_rows<syscolpars> colpars;       // by syscolpars.id
+    map_rows<sysidxstats> idxstats;     // by sysidxstats.id
+    map_rows<sysallocunits> allocunits; // by sysallocunits.ownerid, rows with pgfirstiam
+    map_rows<sysiscols> iscols;         // by sysiscols.idmajor
+    std::unordered_map<uint64, sysscalartypes::const_pointer> scalartypes; // by sysscalartypes.id
+    std::unordered_map<void const *, recordID> location; // rows by address, filled for database_cfg::catalog_cache
+public:
+    static uint64 key(schobj_id const id) {
+        return static_cast<uint32>(id._32);
+    }
+    static uint64 key(auid_t const id) {
+        return id._64;
+    }
+    static uint64 key(scalartype const id) {
+        return id._32;
+    }
+    template<class map_type, class key_type>
+    static typename map_type::mapped_type const & find(map_type const & m, key_type const id) {
+        static const typename map_type::mapped_type empty;
+        auto const it = m.find(key(id));
+        return (it != m.end()) ? it->second : empty;
+    }
+    rows<syscolpars> const & find_colpars(schobj_id const id) const {
+        return find(colpars, id);
+    }
+    rows<sysidxstats> const & find_idxstats(schobj_id const id) const {
+        return find(idxstats, id);
+    }
+    rows<sysallocunits> const & find_allocunits(auid_t const id) const {
+        return find(allocunits, id);
+    }
+    rows<sysiscols> const & find_iscols(schobj_id const id) const {
+        return find(iscols, id);
+    }
+    sysscalartypes::const_pointer find_scalartype(scalartype const id) const {
+        auto const it = scalartypes.find(key(id));
+        return (it != scalartypes.end()) ? it->second : nullptr;
+    }
+};
+
+// resolved catalog saved to side file (see database_cfg::catalog_cache);
+// rows and pages are stored by location and validated against database on load
+class database::catalog_cache {
+    using catalog_cache_error = sdl_exception_t<catalog_cache>;
+public:
+    static bool load(database &); // called by init thread, returns false if file is missing or does not match database
+    static void save(database const &); // errors are traced
+private:
+    class writer;
+    class reader;
+    static uint64 identity(database const &);
+};
+
+// value is written once (writers are serialized by caller), readers do not lock
+template<class T>
+class publish_once : noncopyable {
+    std::atomic_bool m_ready;
+    T m_value;
+public:
+    publish_once(): m_ready(false), m_value() {}
+    T const * get() const {
+        return m_ready.load(std::memory_order_acquire) ? &m_value : nullptr;
+    }
+    T const & set(T const & value) { // returns published value, first value wins
+        if (!m_ready.load(std::memory_order_relaxed)) {
+            m_value = value;
+            m_ready.store(true, std::memory_order_release);
+        }
+        return m_value;
+    }
 };
 
 class database::shared_data final : public database_PageMapping {
-    using map_sysalloc = compact_map<schobj_id, shared_sysallocunits>;
-    using map_datapage = compact_map<schobj_id, shared_page_head_access>;
-    using map_index = compact_map<schobj_id, pgroot_pgfirst>;
-    using map_primary = compact_map<schobj_id, shared_primary_key>;
-    using map_cluster = compact_map<schobj_id, shared_cluster_index>;
-    using map_spatial_tree = compact_map<schobj_id, spatial_tree_idx>;
-    struct data_type {
-        shared_usertables usertable;
-        shared_usertables internal;
-        shared_datatables datatable;
-        map_enum_1<map_sysalloc, dataType> sysalloc;
-        map_enum_2<map_datapage, dataType, pageType> datapage; // not preloaded in init_database()
-        map_enum_1<map_index, pageType> index;
-        map_primary primary;
-        map_cluster cluster;
-        map_spatial_tree spatial_tree;
-        data_type()
-            : usertable(std::make_shared<vector_shared_usertable>())
-            , internal(std::make_shared<vector_shared_usertable>())
-            , datatable(std::make_shared<vector_shared_datatable>())
-        {}
+    struct datapage_table {
+        publish_once<shared_page_head_access> value[datatable::scan_order_size][dataType::size][pageType::size];
+    };
+    struct catalog_entry { // cached values of one object
+        publish_once<shared_sysallocunits> sysalloc[dataType::size];
+        publish_once<pgroot_pgfirst> index[pageType::size];
+        publish_once<shared_primary_key> primary;
+        publish_once<shared_cluster_index> cluster;
+        publish_once<spatial_tree_idx> spatial_tree;
+        std::atomic<datapage_table *> datapage; // allocated on first use
+        catalog_entry(): datapage(nullptr) {}
+        ~catalog_entry() {
+            delete datapage.load();
+        }
+    };
+    class table_index { // read-only after database open
+        std::unordered_map<std::string, shared_usertable> m_name;
+        std::unordered_map<uint64, shared_usertable> m_id;
+    public:
+        void init(vector_shared_usertable const & tables) {
+            SDL_ASSERT(m_name.empty() && m_id.empty());
+            m_name.reserve(tables.size());
+            m_id.reserve(tables.size());
+            for (auto const & p : tables) { // first table wins as in linear search
+                m_name.emplace(p->name(), p);
+                m_id.emplace(sys_index::key(p->get_id()), p);
+            }
+        }
+        shared_usertable find(std::string const & name) const {
+            auto const it = m_name.find(name);
+            return (it != m_name.end()) ? it->second : shared_usertable();
+        }
+        shared_usertable find(schobj_id const id) const {
+            auto const it = m_id.find(sys_index::key(id));
+            return (it != m_id.end()) ? it->second : shared_usertable();
+        }
     };
 public:
     bool initialized = false;
     const std::string filename;
+    std::once_flag sys_once;
+    sys_index sys; // built on first use by database::sys()
+    open_time_t open_time;
+    table_index usertable_index; // built by init_database
+    table_index internal_index; // built by init_database
+    std::atomic_bool pin_shutdown{ false }; // stops pin_thread
+    std::unique_ptr<joinable_thread> pin_thread; // see database_cfg::pin_policy::background
     shared_data(const std::string & fname, database_cfg const & cfg)
         : database_PageMapping(fname, cfg)
         , filename(fname)
+        , m_usertable(std::make_shared<vector_shared_usertable>())
+        , m_internal(std::make_shared<vector_shared_usertable>())
+        , m_datatable(std::make_shared<vector_shared_datatable>())
     {}
+    void init_catalog(std::vector<schobj_id> const & ids) { // keys are fixed before readers start
+        SDL_ASSERT(!initialized && m_catalog_key.empty());
+        m_catalog.reset(new catalog_entry[ids.size()]);
+        m_catalog_id = ids;
+        m_catalog_key.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            m_catalog_key.emplace(sys_index::key(ids[i]), i);
+        }
+    }
+    std::vector<schobj_id> const & catalog_ids() const {
+        return m_catalog_id;
+    }
+    template<class fun_type>
+    void for_each_entry(fun_type && fun) const { // fun(schobj_id, catalog_entry const &)
+        for (size_t i = 0; i < m_catalog_id.size(); ++i) {
+            fun(m_catalog_id[i], m_catalog[i]);
+        }
+    }
     shared_usertables & usertable() { // get/set shared_ptr only
-        return m_data.usertable;
+        return m_usertable;
     } 
     shared_usertables & internal() {
-        return m_data.internal;
+        return m_internal;
     }
     shared_datatables & datatable() {
-        return m_data.datatable;
+        return m_datatable;
     }
     bool empty_usertable() {
         lock_guard lock(m_mutex);
-        return m_data.usertable->empty();
+        return m_usertable->empty();
     }
     bool empty_internal() {
         lock_guard lock(m_mutex);
-        return m_data.internal->empty();
+        return m_internal->empty();
     }
     bool empty_datatable() {
         lock_guard lock(m_mutex);
-        return m_data.datatable->empty();
+        return m_datatable->empty();
     }
+    // find_xxx do not lock; set_xxx publish value and return the one published first,
+    // value of object not found in catalog is returned as is (not cached)
     std::pair<shared_sysallocunits, bool> 
-    find_sysalloc(schobj_id const id, dataType::type const data_type) {
-        lock_guard lock(m_mutex);
-        if (auto found = m_data.sysalloc.find(id, data_type)) {
-            return { *found, true };
-        }
-        return{};
+    find_sysalloc(schobj_id const id, dataType::type const data_type) const {
+        return find_value(id, [data_type](catalog_entry const & e) {
+            return &e.sysalloc[static_cast<int>(data_type)];
+        });
     }
-    void set_sysalloc(schobj_id const id, dataType::type const data_type,
-                      shared_sysallocunits const & value) {
-        lock_guard lock(m_mutex);
-        m_data.sysalloc(id, data_type) = value;
+    shared_sysallocunits set_sysalloc(schobj_id const id, dataType::type const data_type,
+                                      shared_sysallocunits const & value) {
+        return set_value(id, value, [data_type](catalog_entry & e) {
+            return &e.sysalloc[static_cast<int>(data_type)];
+        });
     }
     std::pair<shared_page_head_access, bool>
-    find_datapage(schobj_id const id, dataType::type const data_type, pageType::type const page_type) {
-        lock_guard lock(m_mutex);
-        if (auto found = m_data.datapage.find(id, data_type, page_type)) {
-            return { *found, true };
+    find_datapage(schobj_id const id, dataType::type const data_type, pageType::type const page_type,
+                  scan_order const order) const {
+        if (catalog_entry const * const e = find_entry(id)) {
+            if (datapage_table const * const t = e->datapage.load(std::memory_order_acquire)) {
+                if (auto const p = t->value[static_cast<int>(order)][static_cast<int>(data_type)][static_cast<int>(page_type)].get()) {
+                    return { *p, true };
+                }
+            }
         }
         return{};
     }
-    void set_datapage(schobj_id const id, 
+    shared_page_head_access set_datapage(schobj_id const id, 
                       dataType::type const data_type,
                       pageType::type const page_type,
+                      scan_order const order,
                       shared_page_head_access const & value) {
-        lock_guard lock(m_mutex);
-        m_data.datapage(id, data_type, page_type) = value;
+        return set_value(id, value, [data_type, page_type, order](catalog_entry & e) {
+            datapage_table * t = e.datapage.load(std::memory_order_relaxed);
+            if (!t) {
+                t = new datapage_table;
+                e.datapage.store(t, std::memory_order_release);
+            }
+            return &(t->value[static_cast<int>(order)][static_cast<int>(data_type)][static_cast<int>(page_type)]);
+        });
     }
-    std::pair<pgroot_pgfirst, bool> load_pg_index(schobj_id const id, pageType::type const page_type) {
-        lock_guard lock(m_mutex);
-        if (auto found = m_data.index.find(id, page_type)) {
-            return { *found, true };
-        }
-        return{};
+    std::pair<pgroot_pgfirst, bool> load_pg_index(schobj_id const id, pageType::type const page_type) const {
+        return find_value(id, [page_type](catalog_entry const & e) {
+            return &e.index[static_cast<int>(page_type)];
+        });
     }
-    void set_pg_index(schobj_id const id, pageType::type const page_type, pgroot_pgfirst const & value) {
-        lock_guard lock(m_mutex);
-        m_data.index(id, page_type) = value;
+    pgroot_pgfirst set_pg_index(schobj_id const id, pageType::type const page_type, pgroot_pgfirst const & value) {
+        return set_value(id, value, [page_type](catalog_entry & e) {
+            return &e.index[static_cast<int>(page_type)];
+        });
     }
-    std::pair<shared_primary_key, bool> get_primary_key(schobj_id const table_id) {
-        lock_guard lock(m_mutex);
-        auto const found = m_data.primary.find(table_id);
-        if (found != m_data.primary.end()) {
-            return { found->second, true };
-        }
-        return{};
+    std::pair<shared_primary_key, bool> get_primary_key(schobj_id const table_id) const {
+        return find_value(table_id, [](catalog_entry const & e) {
+            return &e.primary;
+        });
     }
-    void set_primary_key(schobj_id const table_id, shared_primary_key const & value) {
-        lock_guard lock(m_mutex);
-        m_data.primary[table_id] = value;
+    shared_primary_key set_primary_key(schobj_id const table_id, shared_primary_key const & value) {
+        return set_value(table_id, value, [](catalog_entry & e) {
+            return &e.primary;
+        });
     }
-    std::pair<shared_cluster_index, bool> get_cluster_index(schobj_id const id) {
-        lock_guard lock(m_mutex);
-        auto const found = m_data.cluster.find(id);
-        if (found != m_data.cluster.end()) {
-            return { found->second, true };
-        }
-        return{};
+    std::pair<shared_cluster_index, bool> get_cluster_index(schobj_id const id) const {
+        return find_value(id, [](catalog_entry const & e) {
+            return &e.cluster;
+        });
     }
-    void set_cluster_index(schobj_id const id, shared_cluster_index const & value) {
-        lock_guard lock(m_mutex);
-        m_data.cluster[id] = value;
+    shared_cluster_index set_cluster_index(schobj_id const id, shared_cluster_index const & value) {
+        return set_value(id, value, [](catalog_entry & e) {
+            return &e.cluster;
+        });
     }
-    std::pair<spatial_tree_idx, bool> find_spatial_tree(schobj_id const table_id) {
-        lock_guard lock(m_mutex);
-        auto const found = m_data.spatial_tree.find(table_id);
-        if (found != m_data.spatial_tree.end()) {
-            return { found->second, true };
+    std::pair<spatial_tree_idx, bool> find_spatial_tree(schobj_id const table_id) const {
+        return find_value(table_id, [](catalog_entry const & e) {
+            return &e.spatial_tree;
+        });
+    }
+    spatial_tree_idx set_spatial_tree(schobj_id const table_id, spatial_tree_idx const & value) {
+        return set_value(table_id, value, [](catalog_entry & e) {
+            return &e.spatial_tree;
+        });
+    }
+private:
+    catalog_entry * find_entry(schobj_id const id) const {
+        auto const it = m_catalog_key.find(sys_index::key(id));
+        return (it != m_catalog_key.end()) ? &m_catalog[it->second] : nullptr;
+    }
+    template<class fun_type>
+    auto find_value(schobj_id const id, fun_type && get) const
+        -> std::pair<typename std::decay<decltype(*get(std::declval<catalog_entry const &>())->get())>::type, bool> {
+        if (catalog_entry const * const e = find_entry(id)) {
+            if (auto const p = get(*e)->get()) {
+                return { *p, true };
+            }
         }
         return{};
     }
-    void set_spatial_tree(schobj_id const table_id, spatial_tree_idx const & value) {
-        lock_guard lock(m_mutex);
-        m_data.spatial_tree[table_id] = value;
+    template<class T, class fun_type>
+    T set_value(schobj_id const id, T const & value, fun_type && get) {
+        if (catalog_entry * const e = find_entry(id)) {
+            lock_guard lock(m_mutex);
+            return get(*e)->set(value);
+        }
+        return value;
     }
 private:
-    data_type const & const_data() const { return m_data; }
-    data_type & data() { return m_data; }
     using lock_guard = std::lock_guard<std::mutex>;
-    std::mutex m_mutex;
-    data_type m_data; //FIXME: preload all and use read-only ?
+    std::mutex m_mutex; // serializes writers
+    shared_usertables m_usertable;
+    shared_usertables m_internal;
+    shared_datatables m_datatable;
+    std::vector<schobj_id> m_catalog_id; // read-only after init_catalog
+    std::unordered_map<uint64, size_t> m_catalog_key; // read-only after init_catalog
+    std::unique_ptr<catalog_entry[]> m_catalog;
 };
 
 } // db
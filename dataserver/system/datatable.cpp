@@ -5,6 +5,8 @@
 #include "dataserver/system/page_info.h"
 #include "dataserver/system/index_tree_t.h"
 #include "dataserver/utils/conv.h"
+#include "dataserver/common/thread.h"
+#include <condition_variable>
 
 namespace sdl { namespace db {
 
@@ -23,9 +25,9 @@ datatable::datatable(database const * const p, shared_usertable const & t)
     }
 }
 
-datatable::head_access::head_access(base_datatable const * p)
+datatable::head_access::head_access(base_datatable const * p, scan_order const order)
     : table(p)
-    , _datarow(p, dataType::type::IN_ROW_DATA, pageType::type::data)
+    , _datarow(p, dataType::type::IN_ROW_DATA, pageType::type::data, order)
 {
     SDL_ASSERT(table);
 }
@@ -48,7 +50,7 @@ datatable::page_head_access::make_iterator(datatable const * const tab, pageFile
 {
     SDL_ASSERT(tab && id);
     SDL_ASSERT_DEBUG_2(tab->db->find_datapage(tab->get_id(), dataType::type::IN_ROW_DATA, pageType::type::data).get() == this);
-    if (page_head const * h = tab->db->load_page_head(id)) {
+    if (page_head const * h = tab->db->scan_lock_page(id)) {
         return iterator(this, page_pos(h, 0));
     }
     SDL_ASSERT(0);
@@ -75,6 +77,182 @@ datatable::head_access::make_iterator(datatable const * p, recordID const & rec)
     return iterator(this, std::move(it));
 }
 
+// unordered ranges are built from IAM extents: a range takes whole extents (range_pages / 8 of them),
+// so two tasks never share an extent (pool block); pages of extents are checked by PFS in tasks
+std::vector<datatable::page_range>
+datatable::scan_ranges(parallel_scan_cfg const & cfg) const
+{
+    const size_t range_pages = a_max(cfg.range_pages, size_t(1));
+    std::vector<page_range> ranges;
+    if (!cfg.ordered) {
+        std::vector<pageFileID> mixed;
+        const std::vector<pageFileID> extents = db->find_allocated_extents(this->get_id(), dataType::type::IN_ROW_DATA, mixed);
+        const size_t range_extents = a_max(range_pages / 8, size_t(1));
+        ranges.reserve((extents.size() + range_extents - 1) / range_extents + 1);
+        if (!mixed.empty()) {
+            ranges.emplace_back(this, ranges.size(), std::move(mixed));
+        }
+        for (size_t first = 0; first < extents.size(); first += range_extents) {
+            const size_t last = a_min(first + range_extents, extents.size());
+            ranges.emplace_back(this, ranges.size(), std::vector<pageFileID>(), 
+                std::vector<pageFileID>(extents.begin() + first, extents.begin() + last));
+        }
+        return ranges;
+    }
+    std::vector<pageFileID> pages;
+    if (m_index_tree) { // lowest index level refers to data pages in key order
+        for (auto const & row : m_index_tree->_rows) {
+            pages.push_back(row.second);
+        }
+    }
+    else { // page chain of small clustered table or heap pages
+        for (page_head const * const p : datapage_access(this, dataType::type::IN_ROW_DATA, pageType::type::data)) {
+            pages.push_back(p->data.pageId);
+        }
+    }
+    ranges.reserve((pages.size() + range_pages - 1) / range_pages);
+    for (size_t first = 0; first < pages.size(); first += range_pages) {
+        const size_t last = a_min(first + range_pages, pages.size());
+        ranges.emplace_back(this, ranges.size(), std::vector<pageFileID>(pages.begin() + first, pages.begin() + last));
+    }
+    return ranges;
+}
+
+size_t datatable::parallel_scan_threads(parallel_scan_cfg const & cfg, size_t const count)
+{
+    const size_t threads = cfg.threads ? cfg.threads : size_t(std::thread::hardware_concurrency());
+    return a_min(a_max(threads, size_t(1)), a_max(count, size_t(1)));
+}
+
+// tasks are taken in range order by workers; task takes free result slot when it starts,
+// slot is returned after merge, so tasks started and not merged are bounded by window in both orders
+void datatable::parallel_scan_ranges(std::vector<page_range> const & ranges,
+                                     parallel_scan_cfg const & cfg,
+                                     std::function<bool(page_range const &, size_t)> const & scan,
+                                     std::function<bool(size_t)> const & merge) const
+{
+    const size_t count = ranges.size();
+    const size_t threads = parallel_scan_threads(cfg, count);
+    const size_t window = threads * parallel_scan_slots;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next = 0;        // next task to start
+    size_t merged = 0;      // number of merged tasks
+    size_t active = threads;
+    bool stop = false;
+    std::vector<char> done(count, 0);
+    std::vector<size_t> ready; // done and not merged (unordered)
+    std::vector<size_t> slot(count); // result slot of started task
+    std::vector<size_t> free_slot(window);
+    for (size_t i = 0; i < window; ++i) {
+        free_slot[i] = window - 1 - i;
+    }
+    std::exception_ptr error;
+    auto worker = [this, &ranges, &scan, count,
+        &mutex, &cv, &next, &active, &stop, &done, &ready, &slot, &free_slot, &cfg, &error]() {
+        try {
+            database::scoped_thread_lock const lock(*db);
+            for (;;) {
+                size_t i;
+                {
+                    std::unique_lock<std::mutex> guard(mutex);
+                    cv.wait(guard, [&next, &stop, &free_slot, count]() {
+                        return stop || (next >= count) || !free_slot.empty();
+                    });
+                    if (stop || (next >= count)) {
+                        break;
+                    }
+                    i = next++;
+                    slot[i] = free_slot.back();
+                    free_slot.pop_back();
+                }
+                const bool more = scan(ranges[i], slot[i]);
+                db->unlock_thread(bpool::removef::false_); // scanned blocks can be evicted
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    done[i] = 1;
+                    if (!cfg.ordered) {
+                        ready.push_back(i);
+                    }
+                    if (!more) {
+                        stop = true;
+                    }
+                }
+                cv.notify_all();
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> guard(mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            stop = true;
+        }
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            --active;
+        }
+        cv.notify_all();
+    };
+    {
+        std::vector<std::unique_ptr<joinable_thread>> pool(threads);
+        for (auto & t : pool) {
+            reset_new(t, worker);
+        }
+        auto mergeable = [&cfg, &merged, &done, &ready, &error, count]() {
+            if (error) {
+                return false;
+            }
+            return cfg.ordered ? ((merged < count) && done[merged]) : !ready.empty();
+        };
+        std::unique_lock<std::mutex> guard(mutex);
+        for (;;) { // results of finished tasks are merged even if scan is stopped
+            cv.wait(guard, [&mergeable, &active]() {
+                return mergeable() || !active;
+            });
+            if (!mergeable()) {
+                break;
+            }
+            size_t i;
+            if (cfg.ordered) {
+                i = merged;
+            }
+            else {
+                i = ready.back();
+                ready.pop_back();
+            }
+            ++merged;
+            const size_t s = slot[i];
+            guard.unlock();
+            bool more = false;
+            try {
+                more = merge(s);
+            }
+            catch (...) {
+                guard.lock();
+                if (!error) {
+                    error = std::current_exception();
+                }
+                stop = true;
+                break;
+            }
+            guard.lock();
+            if (!more) {
+                stop = true;
+                break;
+            }
+            free_slot.push_back(s);
+            cv.notify_all(); // merge position moved, slot is free
+        }
+        SDL_ASSERT(guard.owns_lock());
+        guard.unlock();
+        cv.notify_all();
+    } // join
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
 #if 0 // reserved
 void datatable::datarow_access::load_prev(page_slot & p)
 {
@@ -474,8 +652,8 @@ datatable::sysalloc_access::sysalloc_access(base_datatable const * p, dataType::
 //--------------------------------------------------------------------------
 
 datatable::datapage_access::datapage_access(base_datatable const * p, 
-    dataType::type const t1, pageType::type const t2)
-    : page_access(p->db->find_datapage(p->get_id(), t1, t2))
+    dataType::type const t1, pageType::type const t2, scan_order const order)
+    : page_access(p->db->find_datapage(p->get_id(), t1, t2, order))
 {
     SDL_ASSERT(t1 != dataType::type::null);
     SDL_ASSERT(t2 != pageType::type::null);
@@ -42,6 +42,12 @@ class datatable final : public base_datatable {
 public:
     using column_order = std::pair<usertable::column const *, sortorder>;
     using key_mem = index_tree::key_mem;
+    enum class scan_order { 
+        table,          // page chain (clustered index order) or heap pages
+        allocation,     // allocated pages of IAM chains in file order, for consumers which do not need key order
+        _end
+    };
+    enum { scan_order_size = int(scan_order::_end) };
 public:
     class sysalloc_access { // copyable
         using vector_data = vector_sysallocunits_row;
@@ -85,13 +91,21 @@ public:
             SDL_ASSERT(p.first || !p.second);
             return (nullptr == p.first);
         }
+        bool scan_pin(page_pos const & p) const { // copy of iterator holds its page, see database_cfg::scan_unlock
+            return scan_pin_page(p.first);
+        }
+        bool scan_unpin(page_pos const & p) const {
+            return scan_unpin_page(p.first);
+        }
+        virtual bool scan_pin_page(page_head const *) const = 0;
+        virtual bool scan_unpin_page(page_head const *) const = 0;
     };
 //------------------------------------------------------------------
     class datapage_access {
         using shared_data = std::shared_ptr<page_head_access>;
         shared_data page_access;
     public:
-        datapage_access(base_datatable const *, dataType::type, pageType::type);
+        datapage_access(base_datatable const *, dataType::type, pageType::type, scan_order = scan_order::table);
         using iterator = page_head_access::iterator;
         iterator begin() const {
             return page_access->begin();
@@ -109,8 +123,9 @@ public:
         using iterator = forward_iterator<datarow_access const, page_slot>;
         explicit datarow_access(base_datatable const * p, 
             dataType::type t1 = dataType::type::IN_ROW_DATA, 
-            pageType::type t2 = pageType::type::data)
-            : _datapage(p, t1, t2) {
+            pageType::type t2 = pageType::type::data,
+            scan_order t3 = scan_order::table)
+            : _datapage(p, t1, t2, t3) {
         }
         iterator begin() const;
         iterator end() const;
@@ -202,7 +217,7 @@ public:
         using datarow_iterator = datarow_access::iterator;
     public:
         using iterator = forward_iterator<head_access const, datarow_iterator>;
-        explicit head_access(base_datatable const *);
+        explicit head_access(base_datatable const *, scan_order = scan_order::table);
         iterator begin() const;
         iterator end() const;
         iterator make_iterator(datatable const *, recordID const &) const;
@@ -338,6 +353,36 @@ public:
     }
     template<class T, class fun_type> static
     void for_datarow(T && data, fun_type && fun);
+    template<class fun_type> // fun(row_head const *) for records in use, false to stop
+    break_or_continue scan_head_if(scan_order, fun_type &&) const;
+public:
+    struct parallel_scan_cfg {
+        size_t threads = 0;         // worker threads (= 0 to use hardware concurrency)
+        size_t range_pages = 256;   // data pages per task (whole extents of 8 pages if not ordered)
+        bool ordered = false;       // ranges follow table order and are merged in this order,
+                                    // otherwise ranges are IAM extents in file order merged as tasks complete
+    };
+    class page_range { // data pages scanned by one task of parallel_scan
+        datatable const * const table;
+    public:
+        size_t const index; // position of range in scan order
+        std::vector<pageFileID> const pages; // single pages
+        std::vector<pageFileID> const extents; // first pages of uniform extents, pages are checked by PFS in task
+        page_range(datatable const * p, size_t i, std::vector<pageFileID> && v, std::vector<pageFileID> && e = {})
+            : table(p), index(i), pages(std::move(v)), extents(std::move(e)) {
+            SDL_ASSERT(table && !(pages.empty() && extents.empty()));
+        }
+        template<class fun_type>
+        break_or_continue for_page_if(fun_type &&) const; // fun(pageFileID const &) for pages, then allocated pages of extents
+        template<class fun_type>
+        break_or_continue scan_if(fun_type &&) const; // fun(row_head const *) for records in use, false to stop
+    };
+    // scan(page_range const &, T &) -> bool is called by worker threads, each range has own T() constructed
+    // when its task starts and destroyed after merge (at most threads * parallel_scan_slots results live);
+    // merge(T &&) -> bool is called by this thread, in range order if parallel_scan_cfg::ordered;
+    // false returned by scan or merge stops the scan. T must not keep rows (pages are unlocked after task).
+    template<class T, class scan_fun, class merge_fun>
+    void parallel_scan(scan_fun &&, merge_fun &&, parallel_scan_cfg const & = {}) const;
 
     row_head_range select_STIntersects(spatial_rect const &) const;
     row_head_range select_STDistance(spatial_point const &, Meters) const;
@@ -349,6 +394,12 @@ public:
 private:
     template<class ret_type, class fun_type>
     ret_type find_row_head_impl(key_mem const &, fun_type const &) const;
+    std::vector<page_range> scan_ranges(parallel_scan_cfg const &) const;
+    enum { parallel_scan_slots = 4 }; // tasks started and not merged, per thread
+    static size_t parallel_scan_threads(parallel_scan_cfg const &, size_t count);
+    void parallel_scan_ranges(std::vector<page_range> const &, parallel_scan_cfg const &,
+        std::function<bool(page_range const &, size_t slot)> const & scan,
+        std::function<bool(size_t slot)> const & merge) const;
     spatial_tree_idx find_spatial_tree() const;
     record_iterator scan_table_with_record_key(key_mem const &) const;
     template<scalartype::type type> static scalartype_t<type> const *
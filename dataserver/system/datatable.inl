@@ -231,6 +231,85 @@ void datatable::for_datarow(T && data, fun_type && fun) {
     }
 }
 
+template<class fun_type>
+break_or_continue datatable::scan_head_if(scan_order const order, fun_type && fun) const {
+    head_access const access(this, order);
+    for (row_head const * const row : access) {
+        if (!fun(row)) {
+            return bc::break_;
+        }
+    }
+    return bc::continue_;
+}
+
+//----------------------------------------------------------------------
+
+template<class fun_type>
+break_or_continue datatable::page_range::for_page_if(fun_type && fun) const
+{
+    for (pageFileID const & id : this->pages) {
+        if (is_break(fun(id))) {
+            return bc::break_;
+        }
+    }
+    for (pageFileID const & start : this->extents) {
+        SDL_ASSERT(!(start.pageId % 8));
+        for (uint32 i = 0; i < 8; ++i) { // Eight consecutive pages form an extent
+            pageFileID id = start;
+            A_STATIC_SAME_TYPE(i, id.pageId);
+            id.pageId += i;
+            if (fwd::is_allocated(table->db, id)) {
+                if (is_break(fun(id))) {
+                    return bc::break_;
+                }
+            }
+        }
+    }
+    return bc::continue_;
+}
+
+template<class fun_type>
+break_or_continue datatable::page_range::scan_if(fun_type && fun) const
+{
+    return for_page_if([this, &fun](pageFileID const & id) {
+        page_head const * const head = fwd::load_page_head(table->db, id);
+        if (head && head->is_data()) { // IAM extents have index pages of clustered table
+            const datapage page(head);
+            const size_t size = page.size();
+            for (size_t slot = 0; slot < size; ++slot) {
+                row_head const * const row = page[slot];
+                if (row && row->use_record()) {
+                    if (!fun(row)) {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    });
+}
+
+template<class T, class scan_fun, class merge_fun>
+void datatable::parallel_scan(scan_fun && scan, merge_fun && merge, parallel_scan_cfg const & cfg) const
+{
+    const std::vector<page_range> ranges = scan_ranges(cfg);
+    if (ranges.empty()) {
+        return;
+    }
+    // slot is owned by one task from its start until merge
+    std::vector<std::unique_ptr<T>> result(parallel_scan_threads(cfg, ranges.size()) * parallel_scan_slots);
+    parallel_scan_ranges(ranges, cfg, 
+        [&scan, &result](page_range const & range, size_t const slot) {
+            result[slot] = std::make_unique<T>();
+            return scan(range, *result[slot]);
+        },
+        [&merge, &result](size_t const slot) {
+            T value(std::move(*result[slot]));
+            result[slot].reset();
+            return merge(std::move(value));
+        });
+}
+
 //----------------------------------------------------------------------
 
 } // db
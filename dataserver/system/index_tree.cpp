@@ -71,7 +71,7 @@ void index_tree::load_prev_row(index_page & p) const
         --p.slot;
     }
     else {
-        if (auto next = this_db->load_prev_head(p.head)) {
+        if (auto next = this_db->scan_prev_head(p.head)) {
             SDL_ASSERT(next->is_index());
             p.head = next;
             p.slot = slot_array::size(next)-1;
@@ -85,8 +85,8 @@ void index_tree::load_prev_row(index_page & p) const
 void index_tree::load_next_row(index_page & p) const
 {
     SDL_ASSERT(!is_end_index(p));
-    if (++p.slot == p.size()) {
-        if (auto next = this_db->load_next_head(p.head)) {
+    if ((++p.slot == p.size()) && p.head->data.nextPage) { // end of index keeps last page
+        if (auto next = this_db->scan_next_head(p.head)) {
             SDL_ASSERT(next->is_index());
             p.head = next;
             p.slot = 0;
@@ -98,11 +98,15 @@ void index_tree::load_next_page(index_page & p) const
 {
     SDL_ASSERT(!is_end_index(p));
     SDL_ASSERT(!p.slot);
-    if (auto next = this_db->load_next_head(p.head)) {
+    if (!p.head->data.nextPage) { // end of index keeps last page
+        p.slot = p.size();
+    }
+    else if (auto next = this_db->scan_next_head(p.head)) {
         p.head = next;
         p.slot = 0;
     }
     else {
+        SDL_ASSERT(0);
         p.slot = p.size();
     }
 }
@@ -111,7 +115,7 @@ void index_tree::load_prev_page(index_page & p) const
 {
     SDL_ASSERT(!is_begin_index(p));
     if (!p.slot) {
-        if (auto next = this_db->load_prev_head(p.head)) {
+        if (auto next = this_db->scan_prev_head(p.head)) {
             p.head = next;
             p.slot = 0;
         }
@@ -125,6 +129,26 @@ void index_tree::load_prev_page(index_page & p) const
     }
 }
 
+bool index_tree::row_access::scan_pin(index_page const & p) const
+{
+    return tree->this_db->scan_pin_page(p.head);
+}
+
+bool index_tree::row_access::scan_unpin(index_page const & p) const
+{
+    return tree->this_db->scan_unlock_page(p.head);
+}
+
+bool index_tree::page_access::scan_pin(index_page const & p) const
+{
+    return tree->this_db->scan_pin_page(p.head);
+}
+
+bool index_tree::page_access::scan_unpin(index_page const & p) const
+{
+    return tree->this_db->scan_unlock_page(p.head);
+}
+
 //----------------------------------------------------------------------
 
 namespace {
@@ -99,6 +99,8 @@ private:
         bool is_end(index_page const & p) const {
            return tree->is_end_index(p);
         }
+        bool scan_pin(index_page const &) const; // copy of iterator holds its page, see database_cfg::scan_unlock
+        bool scan_unpin(index_page const &) const;
     };
 private:
     class page_access: noncopyable {
@@ -117,6 +119,8 @@ private:
         void load_next(index_page &) const;
         void load_prev(index_page &) const;
         bool is_end(index_page const &) const;
+        bool scan_pin(index_page const &) const;
+        bool scan_unpin(index_page const &) const;
     };
     int sub_key_compare(size_t, key_mem const &, key_mem const &) const;
 public:
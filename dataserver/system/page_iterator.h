@@ -39,6 +39,22 @@ public:
 template<typename T, typename X> 
 using is_end_delegate = identity<decltype(is_end_delegate_::test<T, X>())>;
 
+//------------------------------------------------------------------
+
+struct scan_pin_delegate_ {
+private:
+    template<typename T, typename X>
+    static auto check(T * p, X && x) -> decltype(p->scan_pin(x));
+    template<typename T> static void check(...);
+    template<typename X> static X && make();
+public:
+    template<typename T, typename X> 
+    static auto test() -> decltype(check<T>(nullptr, make<X>()));
+};
+
+template<typename T, typename X> 
+using scan_pin_delegate = identity<decltype(scan_pin_delegate_::test<T, X>())>;
+
 } // page_iterator_
 
 //------------------------------------------------------------------
@@ -53,7 +69,7 @@ private:
     state_type current; // must allow iterator assignment
 
     friend T;
-    page_iterator(T * p, state_type && v): parent(p), current(std::move(v)) {
+    page_iterator(T * p, state_type && v): parent(p), current(std::move(v)) { // takes scan pin of v
         SDL_ASSERT(parent);
     }
     explicit page_iterator(T * p): parent(p), current() {
@@ -77,8 +93,38 @@ private:
     bool is_same(const state_type& it) const {
         return is_same(it, page_iterator_::is_same_delegate<T, state_type>());
     }
+    // T::scan_pin/scan_unpin: each copy of iterator holds its own counted lock of current page, 
+    // see database_cfg::scan_unlock
+    using scan_pin_delegate = page_iterator_::scan_pin_delegate<T, state_type>;
+    static void scan_pin(identity<void>) {}
+    static void scan_unpin(identity<void>) {}
+    void scan_pin(identity<bool>) const {
+        if (parent) {
+            parent->scan_pin(current);
+        }
+    }
+    void scan_unpin(identity<bool>) const {
+        if (parent) {
+            parent->scan_unpin(current);
+        }
+    }
 public:
     page_iterator() : parent(nullptr), current{} {}
+    page_iterator(const page_iterator & it): parent(it.parent), current(it.current) {
+        scan_pin(scan_pin_delegate());
+    }
+    ~page_iterator() {
+        scan_unpin(scan_pin_delegate());
+    }
+    page_iterator & operator=(const page_iterator & it) {
+        if (this != &it) {
+            it.scan_pin(scan_pin_delegate());
+            scan_unpin(scan_pin_delegate());
+            parent = it.parent;
+            current = it.current;
+        }
+        return *this;
+    }
 
     page_iterator & operator++() { // preincrement
         SDL_ASSERT(!is_end());
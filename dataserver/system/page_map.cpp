@@ -1,20 +1,40 @@
 // page_map.cpp
 //
 #include "dataserver/system/page_map.h"
+#include "dataserver/filesys/file_map_detail.h"
 
 namespace sdl { namespace db {
 
-PageMapping::PageMapping(const std::string & fname)
+PageMapping::PageMapping(const std::string & fname, preload const pre,
+                         size_t const window_size, size_t const window_max)
     : init_thread_id(std::this_thread::get_id())
+    , m_fname(fname)
+    , m_preload(pre)
+    , m_window_max(window_max)
 {
     static_assert(page_size == 8 * 1024, "");
     static_assert(page_size == (1 << 13), ""); // 8192 = 2^13
-    if (m_fmap.CreateMapView(fname.c_str())) {
+    static_assert(page_shift == 13, "");
+    const uint64 fsize = FileMapping::GetFileSize(fname);
+    if (window_size && (window_size < fsize)) { // map by windows on first touch
+        throw_error_if<PageMapping_error>((fsize % page_size)!=0, "bad file size");
+        m_window_shift = power_of<megabyte<1>::value>::value; // min window, multiple of mmap granularity
+        while ((size_t(1) << m_window_shift) < window_size) {
+            ++m_window_shift;
+        }
+        m_fileSize = fsize;
+        m_pageCount = static_cast<size_t>(fsize / page_size);
+        m_window_count = static_cast<size_t>((fsize + (uint64(1) << m_window_shift) - 1) >> m_window_shift);
+        m_window.reset(new window_t[m_window_count]);
+        SDL_TRACE("PageMapping window = ", (size_t(1) << m_window_shift), " count = ", m_window_count);
+    }
+    else if (m_fmap.CreateMapView(fname.c_str(), pre)) {
         const uint64 sz = m_fmap.GetFileSize();
         const uint64 pp = sz / page_size;
         SDL_ASSERT(!(sz % page_size));
         SDL_ASSERT(pp < size_t(-1));
         throw_error_if<PageMapping_error>((sz % page_size)!=0, "bad file size");
+        m_fileSize = sz;
         m_pageCount = static_cast<size_t>(pp);
     }
     else {
@@ -24,5 +44,168 @@ PageMapping::PageMapping(const std::string & fname)
     throw_error_if<PageMapping_error>(!m_pageCount, "empty file");
 }
 
+PageMapping::~PageMapping()
+{
+    for (size_t i = 0; i < m_window_count; ++i) {
+        if (char const * const base = m_window[i].base.load()) {
+            file_map_detail::unmap_view_of_file(const_cast<char *>(base), 
+                uint64(i) << m_window_shift, window_bytes(i));
+        }
+    }
+}
+
+size_t PageMapping::window_bytes(size_t const i) const
+{
+    SDL_ASSERT(i < m_window_count);
+    const uint64 offset = uint64(i) << m_window_shift;
+    return static_cast<size_t>(a_min(uint64(1) << m_window_shift, m_fileSize - offset));
+}
+
+size_t PageMapping::window_mapped() const
+{
+    std::lock_guard<std::mutex> lock(m_window_mutex);
+    return m_mapped;
+}
+
+size_t PageMapping::window_resident() const
+{
+    std::lock_guard<std::mutex> lock(m_window_mutex);
+    return m_resident;
+}
+
+char const * PageMapping::map_window(size_t const i) const
+{
+    window_t & x = m_window[i];
+    SDL_ASSERT(!x.base.load());
+    const size_t size = window_bytes(i);
+    void * const p = file_map_detail::map_view_of_file(m_fname.c_str(),
+        uint64(i) << m_window_shift, size, m_preload == preload::populate);
+    throw_error_if_not<PageMapping_error>(p != nullptr, "map window failed");
+    if (m_preload == preload::lock) {
+        if (!file_map_detail::lock_view_of_file(p, size)) {
+            SDL_TRACE("lock_view_of_file failed, window = ", i);
+        }
+    }
+    if (m_window_advice != advice::normal) {
+        file_map_detail::advise_view_of_file(p, 0, size, m_window_advice);
+    }
+    char const * const base = static_cast<char const *>(p);
+    x.base.store(base, std::memory_order_release);
+    ++m_mapped;
+    return base;
+}
+
+char const * PageMapping::touch_window(size_t const i) const
+{
+    SDL_ASSERT(i < m_window_count);
+    std::lock_guard<std::mutex> lock(m_window_mutex);
+    window_t & x = m_window[i];
+    char const * base = x.base.load(std::memory_order_relaxed);
+    if (!base) {
+        base = map_window(i);
+    }
+    else if (!x.resident && (m_preload == preload::lock)) { // window was released by clock sweep
+        if (!file_map_detail::lock_view_of_file(const_cast<char *>(base), window_bytes(i))) {
+            SDL_TRACE("lock_view_of_file failed, window = ", i);
+        }
+    }
+    x.touched.store(true, std::memory_order_relaxed);
+    if (!x.resident) {
+        x.resident = true;
+        ++m_resident;
+        if (m_window_max && (m_resident > m_window_max)) {
+            release_cold(i);
+        }
+    }
+    return base;
+}
+
+// clock sweep: touched window gets second chance, cold window stays mapped 
+// but its physical memory is released (pages are read again from file on next access);
+// locked window (preload::lock) is unlocked first, window which cannot be released stays resident
+void PageMapping::release_cold(size_t const current) const
+{
+    for (size_t n = 0; (m_resident > m_window_max) && (n < 2 * m_window_count); ++n) {
+        const size_t i = m_clock;
+        m_clock = (m_clock + 1) % m_window_count;
+        window_t & x = m_window[i];
+        if ((i == current) || !x.resident) {
+            continue;
+        }
+        if (x.touched.exchange(false, std::memory_order_relaxed)) {
+            continue;
+        }
+        char * const base = const_cast<char *>(x.base.load());
+        if (m_preload == preload::lock) {
+            file_map_detail::unlock_view_of_file(base, window_bytes(i)); // MADV_DONTNEED fails on locked pages
+        }
+        if (file_map_detail::advise_view_of_file(base, 0, window_bytes(i), advice::dontneed)) {
+            x.resident = false;
+            --m_resident;
+        }
+        else {
+            SDL_TRACE("release window failed = ", i);
+        }
+    }
+}
+
+bool PageMapping::advise(advice const a) const
+{
+    if (m_window) {
+        std::lock_guard<std::mutex> lock(m_window_mutex);
+        m_window_advice = a;
+        for (size_t i = 0; i < m_window_count; ++i) {
+            if (char const * const base = m_window[i].base.load()) {
+                file_map_detail::advise_view_of_file(const_cast<char *>(base), 0, window_bytes(i), a);
+            }
+        }
+        return true;
+    }
+    return m_fmap.Advise(0, file_size(), a);
+}
+
+bool PageMapping::advise(pageIndex const first, size_t const count, advice const a) const
+{
+    SDL_ASSERT(first.value() < m_pageCount);
+    uint64 offset = uint64(first.value()) * page_size;
+    uint64 const last = a_min(offset + uint64(count) * page_size, m_fileSize);
+    if (!m_window) {
+        return (offset < last) && m_fmap.Advise(offset, last - offset, a);
+    }
+    bool result = false;
+    while (offset < last) {
+        const size_t i = static_cast<size_t>(offset >> m_window_shift);
+        const uint64 window_end = a_min((uint64(i) + 1) << m_window_shift, last);
+        char const * base = m_window[i].base.load(std::memory_order_acquire);
+        if (!base && (a == advice::willneed)) {
+            base = touch_window(i);
+        }
+        if (base) {
+            const uint64 pos = offset - (uint64(i) << m_window_shift);
+            result |= file_map_detail::advise_view_of_file(const_cast<char *>(base), pos, window_end - offset, a);
+        }
+        offset = window_end;
+    }
+    return result;
+}
+
+uint64 PageMapping::memory_offset(void const * const p) const
+{
+    char const * const ptr = static_cast<char const *>(p);
+    if (m_window) {
+        for (size_t i = 0; i < m_window_count; ++i) {
+            char const * const base = m_window[i].base.load();
+            if (base && (ptr >= base) && (ptr < base + window_bytes(i))) {
+                return (uint64(i) << m_window_shift) + (ptr - base);
+            }
+        }
+        SDL_ASSERT(0);
+        return 0;
+    }
+    char const * const base = static_cast<char const *>(start_address());
+    SDL_ASSERT(ptr >= base);
+    return static_cast<uint64>(ptr - base);
+}
+
 } // db
 } // sdl
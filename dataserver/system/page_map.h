@@ -7,39 +7,94 @@
 #include "dataserver/system/page_head.h"
 #include "dataserver/filesys/file_map.h"
 #include <thread>
+#include <atomic>
+#include <mutex>
 
 namespace sdl { namespace db {
 
+// Maps whole file in one view, or by windows mapped on first touch (window_size != 0).
+// Windows are never unmapped while PageMapping is alive (page pointers stay valid),
+// window_max limits resident windows: physical memory of cold windows is released (clock order),
+// mapped address space is not limited (it grows up to file size).
 class PageMapping : noncopyable {
     enum { page_size = page_head::page_size };
+    enum { page_shift = power_of<page_size>::value };
     using thread_id = std::thread::id;
 public:
+    using preload = FileMapping::preload;
+    using advice = FileMapping::advice;
     const thread_id init_thread_id;
-    explicit PageMapping(const std::string & fname);
+    explicit PageMapping(const std::string & fname, preload = preload::none,
+        size_t window_size = 0, size_t window_max = 0);
+    ~PageMapping();
     bool is_open() const {
-        return m_fmap.IsFileMapped();
+        return m_window ? (m_pageCount != 0) : m_fmap.IsFileMapped();
     }
-    void const * start_address() const {
+    void const * start_address() const { // nullptr if file is mapped by windows
         return m_fmap.GetFileView();
     }
     uint64 file_size() const {
-        return m_fmap.GetFileSize();
+        return m_fileSize;
     }
     size_t page_count() const {
         return m_pageCount;
     }
+    size_t window_size() const { // 0 if whole file is mapped
+        return m_window ? (size_t(1) << m_window_shift) : 0;
+    }
+    size_t window_mapped() const; // number of mapped windows
+    size_t window_resident() const; // number of windows not released
     page_head const * lock_page(pageIndex) const; // load_page
     bool unlock_page(pageIndex) const;
+    bool advise(advice) const; // access pattern of whole file
+    bool advise(pageIndex first, size_t count, advice) const; // access pattern of page range
+    bool prefetch(pageIndex const first, size_t const count) const { // pages will be read soon
+        return advise(first, count, advice::willneed);
+    }
+    uint64 memory_offset(void const *) const; // file offset of mapped address (diagnostic)
+private:
+    struct window_t {
+        std::atomic<char const *> base; // mapped on first touch
+        std::atomic_bool touched; // cleared by clock sweep
+        bool resident; // guarded by m_window_mutex
+        window_t(): base(nullptr), touched(false), resident(false) {}
+    };
+    char const * touch_window(size_t) const; // slow path
+    char const * map_window(size_t) const; // m_window_mutex must be locked
+    void release_cold(size_t) const; // m_window_mutex must be locked
+    size_t window_bytes(size_t) const;
 private:
     using PageMapping_error = sdl_exception_t<PageMapping>;
+    const std::string m_fname;
+    const preload m_preload;
     size_t m_pageCount = 0;
+    uint64 m_fileSize = 0;
     FileMapping m_fmap;
+    size_t m_window_shift = 0;
+    size_t m_window_count = 0;
+    size_t const m_window_max;
+    std::unique_ptr<window_t[]> m_window; // nullptr if whole file is mapped
+    mutable std::mutex m_window_mutex;
+    mutable advice m_window_advice = advice::normal; // applied to windows mapped later
+    mutable size_t m_mapped = 0;
+    mutable size_t m_resident = 0;
+    mutable size_t m_clock = 0;
 };
 
 inline page_head const *
 PageMapping::lock_page(pageIndex const i) const {
     const size_t page = i.value(); // uint32 => size_t
     if (page < m_pageCount) {
+        if (m_window) {
+            const size_t w = page >> (m_window_shift - page_shift);
+            window_t const & x = m_window[w];
+            char const * base = x.base.load(std::memory_order_acquire);
+            if (!(base && x.touched.load(std::memory_order_relaxed))) {
+                base = touch_window(w);
+            }
+            const size_t mask = (size_t(1) << (m_window_shift - page_shift)) - 1;
+            return reinterpret_cast<page_head const *>(base + ((page & mask) << page_shift));
+        }
         const char * const data = static_cast<const char *>(start_address());
         return reinterpret_cast<page_head const *>(data + page * page_size);
     }
@@ -0,0 +1,433 @@
+// page_trace.cpp
+//
+#include "dataserver/system/page_trace.h"
+#include "dataserver/system/page_info.h"
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+
+namespace sdl { namespace db {
+
+class page_trace::ring_type : noncopyable { // single producer, single consumer
+    enum { cache_line = 64 };
+    enum { mask = ring_size - 1 };
+public:
+    const std::thread::id owner;
+    std::atomic_bool released; // owner thread exited or switched to other tracer
+    explicit ring_type(std::thread::id const id)
+        : owner(id), released(false), m_data(ring_size), m_head(0), m_tail(0), m_dropped(0)
+    {}
+    bool push(record_type const & r) { // owner thread, returns true if ring became half full
+        const size_t h = m_head.load(std::memory_order_relaxed);
+        const size_t used = h - m_tail.load(std::memory_order_acquire);
+        if (used < ring_size) {
+            m_data[h & mask] = r;
+            m_head.store(h + 1, std::memory_order_release);
+            return used == ring_size / 2;
+        }
+        m_dropped.store(m_dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return false;
+    }
+    size_t pop(std::vector<record_type> & dest) { // flush thread
+        const size_t t = m_tail.load(std::memory_order_relaxed);
+        const size_t h = m_head.load(std::memory_order_acquire);
+        for (size_t i = t; i != h; ++i) {
+            dest.push_back(m_data[i & mask]);
+        }
+        m_tail.store(h, std::memory_order_release);
+        return h - t;
+    }
+    size_t dropped() const {
+        return m_dropped.load(std::memory_order_relaxed);
+    }
+private:
+    std::vector<record_type> m_data;
+    std::atomic<size_t> m_head; // written by owner thread
+    char padding1[cache_line - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_tail; // written by flush thread
+    char padding2[cache_line - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> m_dropped;
+};
+
+class page_trace::ring_owner : noncopyable { // ring of this thread
+public:
+    size_t id = 0; // tracer
+    shared_ring ring;
+    ring_owner() = default;
+    ~ring_owner() {
+        release();
+    }
+    void reset(size_t const i, shared_ring && p) {
+        release();
+        id = i;
+        ring = std::move(p);
+    }
+private:
+    void release() {
+        if (ring) {
+            ring->released = true;
+            ring.reset();
+        }
+    }
+};
+
+thread_local page_trace::ring_owner page_trace::t_ring;
+
+namespace {
+
+std::atomic<size_t> s_trace_id(0);
+
+} // namespace
+
+page_trace::page_trace(std::string const & fname, size_t const page_count)
+    : m_id(++s_trace_id)
+    , m_start(clock_type::now())
+    , m_out(fname, std::ofstream::binary | std::ofstream::trunc)
+    , m_wake(false)
+    , m_recorded(0)
+{
+    throw_error_if_not_t<page_trace>(m_out.is_open(), "cannot create page trace file");
+    header_type h {};
+    h.magic = header_type::magic_value;
+    h.version = header_type::version_value;
+    h.record_size = sizeof(record_type);
+    h.tick_us = tick_us;
+    h.page_count = page_count;
+    m_out.write(reinterpret_cast<char const *>(&h), sizeof(h));
+    throw_error_if_not_t<page_trace>(m_out.good(), "cannot write page trace file");
+    m_thread.reset(new joinable_thread([this](){
+        this->run_thread();
+    }));
+}
+
+page_trace::~page_trace()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_cv.notify_one();
+    m_thread.reset(); // join
+    flush();
+    SDL_TRACE("page_trace: ", m_recorded.load(), " recorded, ", dropped(), " dropped");
+}
+
+page_trace::shared_ring
+page_trace::add_ring()
+{
+    const std::thread::id id = std::this_thread::get_id();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto const & p : m_ring) {
+        if ((p->owner == id) && p->released) { // thread switched between tracers, ring is not freed yet
+            p->released = false;
+            return p;
+        }
+    }
+    m_ring.push_back(std::make_shared<ring_type>(id));
+    return m_ring.back();
+}
+
+inline page_trace::ring_type *
+page_trace::this_ring()
+{
+    if (t_ring.id != m_id) {
+        t_ring.reset(m_id, add_ring());
+    }
+    return t_ring.ring.get();
+}
+
+void page_trace::trace(pageFileID::page32 const pageId, page_head const * const p)
+{
+    SDL_ASSERT(p);
+    using namespace std::chrono;
+    record_type r;
+    r.time = static_cast<uint32>(duration_cast<microseconds>(clock_type::now() - m_start).count() / tick_us);
+    r.pageId = pageId;
+    r.objId = p->data.objId;
+    r.indexId = p->data.indexId;
+    r.type = p->data.type.value;
+    r.level = p->data.level;
+    if (this_ring()->push(r)) { // flush before ring is full
+        m_wake = true;
+        m_cv.notify_one();
+    }
+}
+
+size_t page_trace::dropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t count = m_dropped;
+    for (auto const & p : m_ring) {
+        count += p->dropped();
+    }
+    return count;
+}
+
+size_t page_trace::flush() // flush thread or destructor
+{
+    m_buf.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_ring.begin(); it != m_ring.end();) {
+            ring_type & r = **it;
+            const bool released = r.released; // before pop, released ring gets no more records
+            r.pop(m_buf);
+            if (released) {
+                m_dropped += r.dropped();
+                it = m_ring.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+    if (!m_buf.empty() && m_out.good()) {
+        m_out.write(reinterpret_cast<char const *>(m_buf.data()), m_buf.size() * sizeof(record_type));
+        m_out.flush();
+        if (m_out.good()) {
+            m_recorded += m_buf.size();
+        }
+        else {
+            SDL_TRACE("page_trace: cannot write file");
+        }
+    }
+    return m_buf.size();
+}
+
+void page_trace::run_thread()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_shutdown) {
+        m_cv.wait_for(lock, std::chrono::milliseconds(flush_ms), [this](){
+            return m_shutdown || m_wake;
+        });
+        m_wake = false;
+        lock.unlock();
+        flush();
+        lock.lock();
+    }
+}
+
+//----------------------------------------------------------------
+
+namespace {
+
+struct trace_stat {
+    size_t access = 0;
+    size_t pages = 0; // distinct
+};
+
+inline uint64 auid_key(page_trace::record_type const & r) {
+    return (static_cast<uint64>(r.objId) << 16) | r.indexId;
+}
+
+// allocation_unit_id as in sys.allocation_units
+inline uint64 allocation_unit_id(uint64 const key) {
+    return ((key & 0xFFFF) << 48) | ((key >> 16) << 16);
+}
+
+std::ostream & percent(std::ostream & out, size_t const part, size_t const total) {
+    const double v = total ? (100.0 * part / total) : 0;
+    return out << std::fixed << std::setprecision(1) << std::setw(6) << v << "%";
+}
+
+std::string page_size_mb(size_t const pages) {
+    std::ostringstream ss;
+    ss << std::fixed << std::setprecision(1) << (double(pages) * page_head::page_size / megabyte<1>::value) << " MB";
+    return ss.str();
+}
+
+template<class key_fun>
+std::vector<std::pair<uint64, trace_stat>>
+group_by(std::vector<page_trace::record_type> const & data, key_fun && get_key)
+{
+    std::vector<std::pair<uint64, uint32>> keys; // (key, pageId)
+    keys.reserve(data.size());
+    for (auto const & r : data) {
+        keys.emplace_back(get_key(r), r.pageId);
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<std::pair<uint64, trace_stat>> result;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (result.empty() || (result.back().first != keys[i].first)) {
+            result.emplace_back(keys[i].first, trace_stat{});
+        }
+        trace_stat & s = result.back().second;
+        ++s.access;
+        if (!i || (keys[i - 1] != keys[i])) {
+            ++s.pages;
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+void page_trace::report(std::string const & fname, std::ostream & out, report_cfg const & cfg)
+{
+    SDL_ASSERT(cfg.width && cfg.rows);
+    std::ifstream in(fname, std::ifstream::binary);
+    throw_error_if_not_t<page_trace>(in.is_open(), "cannot open page trace file");
+    header_type h {};
+    in.read(reinterpret_cast<char *>(&h), sizeof(h));
+    throw_error_if_not_t<page_trace>(in.good() &&
+        (h.magic == header_type::magic_value) &&
+        (h.version == header_type::version_value) &&
+        (h.record_size == sizeof(record_type)) && h.tick_us,
+        "bad page trace file");
+    std::vector<record_type> data;
+    {
+        in.seekg(0, std::ios::end);
+        const size_t body = static_cast<size_t>(in.tellg()) - sizeof(h);
+        in.seekg(sizeof(h), std::ios::beg);
+        data.resize(body / sizeof(record_type)); // tail of last unfinished write is ignored
+        if (!data.empty()) {
+            in.read(reinterpret_cast<char *>(data.data()), data.size() * sizeof(record_type));
+            throw_error_if_not_t<page_trace>(in.good(), "cannot read page trace file");
+        }
+    }
+    std::stable_sort(data.begin(), data.end(), [](record_type const & x, record_type const & y){
+        return x.time < y.time;
+    });
+    const size_t total = data.size();
+    const uint32 max_time = data.empty() ? 0 : data.back().time;
+    const size_t page_count = a_max(static_cast<size_t>(h.page_count), size_t(1));
+    const auto all_pages = group_by(data, [](record_type const &){ return 0; });
+    const size_t distinct = all_pages.empty() ? 0 : all_pages[0].second.pages;
+    out << "\npage_trace = " << fname
+        << "\npage_count = " << h.page_count
+        << "\naccesses = " << total
+        << "\ndistinct_pages = " << distinct << " (" << page_size_mb(distinct) << ")"
+        << "\nduration_ms = " << (uint64(max_time) * h.tick_us / 1000)
+        << std::endl;
+    if (data.empty()) {
+        return;
+    }
+    { // allocation units
+        auto stat = group_by(data, auid_key);
+        std::sort(stat.begin(), stat.end(), [](std::pair<uint64, trace_stat> const & x, std::pair<uint64, trace_stat> const & y){
+            return x.second.access > y.second.access;
+        });
+        out << "\nby allocation unit (top " << a_min(cfg.top, stat.size()) << " of " << stat.size() << "):"
+            << "\n  allocation_unit_id   objId  indexId   accesses    share    pages";
+        for (size_t i = 0; i < a_min(cfg.top, stat.size()); ++i) {
+            auto const & s = stat[i];
+            out << "\n" << std::setw(20) << allocation_unit_id(s.first)
+                << std::setw(8) << (s.first >> 16)
+                << std::setw(9) << (s.first & 0xFFFF)
+                << std::setw(11) << s.second.access << "  ";
+            percent(out, s.second.access, total) << std::setw(9) << s.second.pages;
+        }
+        out << std::endl;
+    }
+    { // page types
+        const auto stat = group_by(data, [](record_type const & r){ return r.type; });
+        out << "\nby page type:";
+        for (auto const & s : stat) {
+            const char * const name = (s.first < pageType::size) ?
+                to_string::type_name(static_cast<pageType::type>(s.first)) : "?";
+            out << "\n  " << std::left << std::setw(14) << name << std::right
+                << std::setw(11) << s.second.access << "  ";
+            percent(out, s.second.access, total) << std::setw(9) << s.second.pages << " pages";
+        }
+        out << std::endl;
+    }
+    { // index levels
+        const auto stat = group_by(data, [](record_type const & r){ return r.level; });
+        out << "\nby index level:";
+        for (auto const & s : stat) {
+            out << "\n  level " << std::setw(3) << s.first
+                << std::setw(11) << s.second.access << "  ";
+            percent(out, s.second.access, total) << std::setw(9) << s.second.pages << " pages";
+        }
+        out << std::endl;
+    }
+    const size_t rows = cfg.rows;
+    const size_t width = cfg.width;
+    auto const row_of = [max_time, rows](record_type const & r) {
+        return static_cast<size_t>(uint64(r.time) * rows / (uint64(max_time) + 1));
+    };
+    { // heatmap: rows = time, columns = file offset
+        std::vector<size_t> cell(rows * width);
+        for (auto const & r : data) {
+            const size_t col = a_min(static_cast<size_t>(uint64(r.pageId) * width / page_count), width - 1);
+            ++cell[row_of(r) * width + col];
+        }
+        const size_t max_cell = *std::max_element(cell.begin(), cell.end());
+        static const char ramp[] = " .:-=+*#%@";
+        enum { ramp_max = sizeof(ramp) - 2 };
+        const double scale = std::log(double(max_cell) + 1);
+        out << "\nheatmap (time down, file offset right, "
+            << page_size_mb((page_count + width - 1) / width) << " per column, log scale):\n";
+        out << "  +" << std::string(width, '-') << "+\n";
+        for (size_t y = 0; y < rows; ++y) {
+            out << "  |";
+            for (size_t x = 0; x < width; ++x) {
+                const size_t n = cell[y * width + x];
+                size_t i = n ? static_cast<size_t>(ramp_max * std::log(double(n) + 1) / scale + 0.5) : 0;
+                if (n && !i) i = 1;
+                out << ramp[i];
+            }
+            out << "|\n";
+        }
+        out << "  +" << std::string(width, '-') << "+" << std::endl;
+    }
+    { // working set: distinct pages touched within interval, and cumulative footprint
+        std::vector<size_t> access(rows), window(rows), first(rows);
+        std::vector<uint64> keys;
+        keys.reserve(data.size());
+        for (auto const & r : data) {
+            ++access[row_of(r)];
+            keys.push_back((uint64(row_of(r)) << 32) | r.pageId);
+        }
+        std::sort(keys.begin(), keys.end());
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!i || (keys[i - 1] != keys[i])) {
+                ++window[static_cast<size_t>(keys[i] >> 32)];
+            }
+        }
+        keys.clear();
+        for (auto const & r : data) { // data is sorted by time, first key of page is first touch
+            keys.push_back((uint64(r.pageId) << 32) | row_of(r));
+        }
+        std::stable_sort(keys.begin(), keys.end(), [](uint64 x, uint64 y){
+            return (x >> 32) < (y >> 32);
+        });
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (!i || ((keys[i - 1] >> 32) != (keys[i] >> 32))) {
+                ++first[static_cast<size_t>(keys[i] & 0xFFFFFFFF)];
+            }
+        }
+        const double interval_ms = (double(max_time) + 1) * h.tick_us / 1000 / rows;
+        out << "\nworking set (" << std::fixed << std::setprecision(1) << interval_ms << " ms intervals):"
+            << "\n     time_ms   accesses  window_pages   window_size   total_pages    total_size";
+        size_t cumulative = 0;
+        for (size_t y = 0; y < rows; ++y) {
+            cumulative += first[y];
+            out << "\n" << std::setw(12) << std::setprecision(1) << (interval_ms * (y + 1))
+                << std::setw(11) << access[y]
+                << std::setw(14) << window[y]
+                << std::setw(14) << page_size_mb(window[y])
+                << std::setw(14) << cumulative
+                << std::setw(14) << page_size_mb(cumulative);
+        }
+        out << std::endl;
+    }
+}
+
+#if SDL_DEBUG
+namespace {
+    class unit_test {
+    public:
+        unit_test() {
+            static_assert(sizeof(page_trace::header_type) == 24, "");
+            static_assert(sizeof(page_trace::record_type) == 16, "");
+            static_assert(is_power_2<page_trace::ring_size>::value, "");
+        }
+    };
+    static unit_test s_test;
+}
+#endif //#if SDL_DEBUG
+
+} // db
+} // sdl
@@ -0,0 +1,85 @@
+// page_trace.h
+//
+#pragma once
+#ifndef __SDL_SYSTEM_PAGE_TRACE_H__
+#define __SDL_SYSTEM_PAGE_TRACE_H__
+
+#include "dataserver/system/page_head.h"
+#include "dataserver/common/thread.h"
+#include <condition_variable>
+#include <fstream>
+
+namespace sdl { namespace db {
+
+// Page access tracer (see database_cfg::page_trace).
+// database::load_page_head appends records to ring buffer of calling thread (single producer, no locks);
+// background thread drains rings to binary trace file. Records are dropped while ring is full.
+// Ring is released at thread exit and freed after it is drained.
+class page_trace : noncopyable {
+public:
+    enum { ring_power = 16 }; // 65536 records (1 MB) per thread
+    enum { ring_size = 1 << ring_power };
+    enum { flush_ms = 20 };
+    enum { tick_us = 16 }; // time resolution, uint32 ticks cover 19 hours
+#pragma pack(push, 1)
+    struct header_type { // followed by record_type array up to end of file
+        enum { magic_value = 0x43525450 }; // "PTRC"
+        enum { version_value = 1 };
+        uint32 magic;
+        uint32 version;
+        uint32 record_size;
+        uint32 tick_us;
+        uint64 page_count; // database file
+    };
+    struct record_type {
+        uint32 time;        // ticks since trace started
+        uint32 pageId;
+        uint32 objId;       // page_head::objId (AllocUnitId.idObj)
+        uint16 indexId;     // page_head::indexId (AllocUnitId.idInd)
+        uint8 type;         // pageType::type
+        uint8 level;        // index level, 0 = leaf
+    };
+#pragma pack(pop)
+    page_trace(std::string const & fname, size_t page_count); // throws if file cannot be created
+    ~page_trace();
+    void trace(pageFileID::page32, page_head const *);
+    size_t recorded() const { // written to file
+        return m_recorded;
+    }
+    size_t dropped() const;
+public:
+    struct report_cfg {
+        size_t top = 20;        // allocation units with most accesses
+        size_t width = 64;      // heatmap columns (file offset)
+        size_t rows = 16;       // heatmap rows and points of working set curve (time)
+    };
+    static void report(std::string const & fname, std::ostream &, report_cfg const &); // may throw
+private:
+    class ring_type;
+    class ring_owner;
+    using shared_ring = std::shared_ptr<ring_type>;
+    static thread_local ring_owner t_ring;
+    ring_type * this_ring();
+    shared_ring add_ring();
+    size_t flush();
+    void run_thread();
+private:
+    using clock_type = std::chrono::steady_clock;
+    const size_t m_id; // distinguishes tracers in thread local cache
+    const clock_type::time_point m_start;
+    std::ofstream m_out;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_shutdown = false;
+    std::atomic_bool m_wake; // ring is half full
+    std::vector<shared_ring> m_ring; // guarded by m_mutex, one per thread
+    size_t m_dropped = 0; // guarded by m_mutex, records dropped by freed rings
+    std::vector<record_type> m_buf; // used by flush()
+    std::atomic<size_t> m_recorded;
+    std::unique_ptr<joinable_thread> m_thread;
+};
+
+} // db
+} // sdl
+
+#endif // __SDL_SYSTEM_PAGE_TRACE_H__